@@ -263,6 +263,7 @@ void getIntPoint(MeshElement* e, int order, int point, Vector3& param)
   IntegrationPoint const* p = 
     getIntegration(e->getType())->getAccurate(order)->getPoint(point);
   param = p->param;
+  e->setIntPoint(order,point,param);
 }
 
 double getIntWeight(MeshElement* e, int order, int point)
@@ -318,7 +319,7 @@ void getMatrixNodes(Element* e, NewArray<Matrix3x3>& values)
 void getShapeValues(Element* e, Vector3 const& local,
     NewArray<double>& values)
 {
-  e->getShape()->getValues(local,values);
+  e->getShapeValues(local,values);
 }
 
 void getShapeGrads(Element* e, Vector3 const& local,
@@ -378,6 +378,76 @@ class Integrator
     int order;
 };
 
+/** \brief A block of same-type elements handed to a BlockIntegrator.
+  *
+  * \details All elements share one integration rule, so the
+  * parametric points and weights are given once. The differential
+  * volumes are stored point by point: dV[p * count + i] belongs
+  * to point p of elements[i].
+  */
+struct IntegrationBlock
+{
+  /** \brief the element type, from apf::Mesh::Type */
+  int type;
+  /** \brief the number of elements in this block */
+  int count;
+  /** \brief the number of integration points per element */
+  int points;
+  /** \brief the elements of this block */
+  MeshEntity* const* elements;
+  /** \brief the parametric coordinates of each point */
+  Vector3 const* params;
+  /** \brief the integration weight of each point */
+  double const* weights;
+  /** \brief the differential volume at each point of each element */
+  double const* dV;
+};
+
+/** \brief Integrates over blocks of elements, possibly with threads.
+  *
+  * \details This is the batched counterpart of apf::Integrator.
+  * The owned elements are grouped by type into blocks. The Jacobian
+  * determinants at all points of a block are computed at once from
+  * its gathered coordinates, and the block is then handed to atBlock.
+  * Blocks are spread over PCU_Work_Run workers, so atBlock must only
+  * read the mesh and fields, and should accumulate into storage
+  * indexed by its thread argument, sized in inProcess.
+  * parallelReduce then runs on the calling thread. It should first
+  * combine the per-thread values, then reduce across processes.
+  */
+class BlockIntegrator
+{
+  public:
+    /** \brief Construct given an order of accuracy.
+      \details the thread count starts at the value given
+      to apf::setIntegrationThreads */
+    BlockIntegrator(int o);
+    virtual ~BlockIntegrator();
+    /** \brief Run over the owned elements of the local Mesh. */
+    void process(Mesh* m);
+    /** \brief User callback: integrate over one block.
+      \param thread in [0, countThreads()) */
+    virtual void atBlock(IntegrationBlock const& b, int thread) = 0;
+    /** \brief User callback: called by process before any atBlock.
+      \details countThreads() does not change until parallelReduce,
+      so per-thread storage can be sized here. */
+    virtual void inProcess();
+    /** \brief User callback: thread and parallel reduction. */
+    virtual void parallelReduce();
+    /** \brief Change the number of threads used by process. */
+    void setThreads(int n);
+    /** \brief Return the number of threads used by process. */
+    int countThreads() {return threads;}
+  protected:
+    int order;
+    int threads;
+};
+
+/** \brief Set the default number of threads of new BlockIntegrators.
+  \details the default is 1. MPI is never called from the
+  extra threads. */
+void setIntegrationThreads(int n);
+
 /** \brief Measures the volume, area, or length of a Mesh Element.
   *
   * \details By integrating the differential volume over the element,
@@ -452,13 +522,33 @@ for (t::iterator (i) = (w).begin(); \
 for (t::const_iterator (i) = (w).begin(); \
      (i) != (w).end(); ++(i))
 
+/** \brief Encodings of the data arrays in VTK files */
+enum VtkFormat
+{
+  /** \brief human-readable text */
+  VTK_ASCII,
+  /** \brief base64-encoded binary inside each DataArray */
+  VTK_BINARY,
+  /** \brief raw binary appended after the XML, the smallest and fastest */
+  VTK_APPENDED
+};
+
 /** \brief Write a set of parallel VTK Unstructured Mesh files from an apf::Mesh
+  \param format one of apf::VtkFormat
+  \param compress zlib-compress the binary formats,
+                  this requires building with APF_ZLIB=ON
   */
-void writeVtkFiles(const char* prefix, Mesh* m);
+void writeVtkFiles(const char* prefix, Mesh* m,
+    VtkFormat format = VTK_ASCII, bool compress = false);
 /** \brief Output just the .vtu file for this part.
   \details this function is useful for debugging large parallel meshes.
   */
-void writeOneVtkFile(const char* prefix, Mesh* m);
+void writeOneVtkFile(const char* prefix, Mesh* m,
+    VtkFormat format = VTK_ASCII, bool compress = false);
+/** \brief Set the number of threads compressing VTK arrays.
+  \details the zlib blocks of each array are spread over this many
+  PCU_Work_Run workers. The default is 1. */
+void setVtkThreads(int n);
 
 /** \brief Return the location of a gaussian integration point.
   \param type the element type, from apf::Mesh::getType
@@ -498,6 +588,43 @@ void synchronize(Field* f, Sharing* shr = 0);
   */
 void accumulate(Field* f, Sharing* shr = 0);
 
+/** \brief A reusable record of who exchanges which nodes.
+  \details A SharingPlan lists, for every peer part, the shared
+  entities with nodes whose values this part owns and those
+  it only holds copies of, in an order both sides agree on.
+  Exchanges through a plan send only the values, one message
+  per peer, without walking the mesh again.
+  Since the plan knows its peers, these exchanges switch PCU
+  to its neighborhood transport (see PCU_Comm_Set_Neighbors)
+  and then restore whatever neighbors were set before.
+  The plan is only valid until the mesh or its partition changes. */
+class SharingPlan;
+
+/** \brief Build a SharingPlan for fields of this shape.
+  \details This costs about as much as one apf::synchronize.
+  The Sharing object (apf::getSharing by default) is
+  deleted by this call, as in apf::synchronize. */
+SharingPlan* makeSharingPlan(Mesh* m, FieldShape* s, Sharing* shr = 0);
+
+/** \brief Destroy a SharingPlan. */
+void destroySharingPlan(SharingPlan* plan);
+
+/** \brief Synchronize a field using a SharingPlan.
+  \details The field must use the plan's mesh and shape,
+  and have values on all of its owned shared nodes. */
+void synchronize(SharingPlan* plan, Field* f);
+
+/** \brief Synchronize several fields in one exchange.
+  \details The fields may have different numbers of components
+  but must all use the plan's mesh and shape. */
+void synchronize(SharingPlan* plan, Field** fields, int count);
+
+/** \brief Accumulate a field using a SharingPlan. */
+void accumulate(SharingPlan* plan, Field* f);
+
+/** \brief Accumulate several fields in one exchange per direction. */
+void accumulate(SharingPlan* plan, Field** fields, int count);
+
 /** \brief Declare failure of code inside APF.
   \details This function prints the string as an APF
   failure to stderr and then calls abort.
@@ -522,6 +649,20 @@ bool isFrozen(Field* f);
  */
 double* getArrayData(Field* f);
 
+/** \brief Return the frozen values stored for one entity.
+  \details this points at the components of all nodes
+  of (e), node by node, and sets (size) to their count.
+  Returns zero if the field is not frozen. */
+double* getArrayData(Field* f, MeshEntity* e, int& size);
+
+/** \brief Return the frozen values stored for one dimension.
+  \details the array of a frozen field holds one block per
+  dimension, with entities in iteration order, so a
+  higher-order field can be copied a dimension at a time.
+  (size) is set to the number of values in the block.
+  Returns zero if the field is not frozen. */
+double* getArrayData(Field* f, int dimension, long& size);
+
 /** \brief Initialize all nodal values with all-zero components */
 void zeroField(Field* f);
 
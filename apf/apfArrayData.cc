@@ -1,6 +1,8 @@
 #include "apfArrayData.h"
 #include "apfNumbering.h"
 #include "apfTagData.h"
+#include <algorithm>
+#include <vector>
 
 namespace apf {
 
@@ -13,15 +15,56 @@ class ArrayDataOf : public FieldDataOf<T>
       /* this class inherits a variable (field),
          lets initialize it */
       this->field = f;
-      /* this has to set up the array */
+      mesh = f->getMesh();
       FieldShape* s = f->getShape();
-      const char* name = s->getName();
-      Numbering* n = f->getMesh()->findNumbering(name);
-      if (n==NULL)
-        num_var = numberOverlapNodes(f->getMesh(),name,s);
-      else
-        num_var = n;
-      arraySize = f->countComponents()*countNodes(num_var);
+      /* meshes with dense entity indices are addressed directly,
+         others go through an overlap numbering of the nodes */
+      dense = mesh->hasDenseIndices();
+      num_var = 0;
+      if (!dense) {
+        const char* name = s->getName();
+        num_var = mesh->findNumbering(name);
+        if (num_var==NULL)
+          num_var = numberOverlapNodes(mesh,name,s);
+      }
+      /* values are laid out one dimension after another,
+         entities in iteration order, the same order
+         as the overlap numbering */
+      arraySize = 0;
+      for (int d=0; d < 4; ++d) {
+        first[d] = arraySize;
+        stride[d] = 0;
+        if ( ! s->hasNodesIn(d))
+          continue;
+        std::vector<long>& o = offsets[d];
+        bool uniform = true;
+        int size = -1;
+        MeshIterator* it = mesh->begin(d);
+        MeshEntity* e;
+        while ((e = mesh->iterate(it))) {
+          int n = f->countValuesOn(e);
+          if (size == -1)
+            size = n;
+          else if (n != size)
+            uniform = false;
+          if (dense)
+            o.push_back(arraySize);
+          arraySize += n;
+        }
+        mesh->end(it);
+        /* mixed meshes may carry different node counts per
+           entity of one dimension, those keep an offset table */
+        if (uniform) {
+          stride[d] = std::max(size, 0);
+          std::vector<long>().swap(o);
+        } else {
+          stride[d] = -1;
+          o.push_back(arraySize);
+        }
+      }
+      first[4] = arraySize;
+      if (!dense)
+        arraySize = long(f->countComponents())*countNodes(num_var);
       dataArray = new T[arraySize];
     }
     virtual ~ArrayDataOf()
@@ -29,11 +72,11 @@ class ArrayDataOf : public FieldDataOf<T>
       /* this has to destroy the array */
       delete [] dataArray;
     }
-    virtual bool hasEntity(MeshEntity*)
+    virtual bool hasEntity(MeshEntity* e)
     {
-      /* this should get a bit more complex:
-         return true if the field has nodes on (e) */
-      return true;
+      /* mixed meshes may have element types without nodes,
+         copying those into tags would find no tag to set */
+      return this->field->countValuesOn(e) != 0;
     }
     virtual void removeEntity(MeshEntity*)
     {
@@ -44,24 +87,18 @@ class ArrayDataOf : public FieldDataOf<T>
     virtual void get(MeshEntity* e, T* data)
     {
       /* this retrieves all the data associated with (e) */
-      int first_node_index = getNumber(this->num_var,e,0,0);
-      int num_nodes = this->field->countNodesOn(e);
-      int num_components = this->field->countComponents();
-      int start = first_node_index*num_components;
-      for (int i=0; i<num_nodes*num_components; i++) {
-         data[i] = this->dataArray[start+i];
-      }
+      int n;
+      T const* values = getEntityArray(e, n);
+      for (int i=0; i < n; ++i)
+        data[i] = values[i];
     }
     virtual void set(MeshEntity* e, T const* data)
     {
       /* this stores all the data associated with (e) */
-      int first_node_index = getNumber(this->num_var,e,0,0);
-      int num_nodes = this->field->countNodesOn(e);
-      int num_components = this->field->countComponents();
-      int start = first_node_index*num_components;
-      for (int i=0; i<num_nodes*num_components; i++) {
-          this->dataArray[start+i] = data[i];
-      }
+      int n;
+      T* values = getEntityArray(e, n);
+      for (int i=0; i < n; ++i)
+        values[i] = data[i];
     }
 
     virtual bool isFrozen() {
@@ -72,10 +109,44 @@ class ArrayDataOf : public FieldDataOf<T>
       return this->dataArray;
     }
 
+    T* getEntityArray(MeshEntity* e, int& n)
+    {
+      if (!dense) {
+        n = this->field->countValuesOn(e);
+        if (!n)
+          return dataArray;
+        long first_node_index = getNumber(num_var,e,0,0);
+        return dataArray + first_node_index*this->field->countComponents();
+      }
+      int d = getDimension(mesh, e);
+      long i = mesh->getDenseIndex(e);
+      if (stride[d] >= 0) {
+        n = stride[d];
+        return dataArray + first[d] + i*stride[d];
+      }
+      std::vector<long> const& o = offsets[d];
+      n = o[i + 1] - o[i];
+      return dataArray + o[i];
+    }
+
+    T* getDimensionArray(int d, long& n)
+    {
+      n = first[d + 1] - first[d];
+      return dataArray + first[d];
+    }
+
   private:
     /* data variables go here */
-    Numbering* num_var; 
-    int arraySize;
+    Mesh* mesh;
+    bool dense;
+    Numbering* num_var;
+    /* per dimension: where its values start, how many values
+       each entity holds (-1 if that varies), and the per-entity
+       offsets when it does */
+    long first[5];
+    int stride[4];
+    std::vector<long> offsets[4];
+    long arraySize;
     T* dataArray;
 };
 
@@ -124,4 +195,24 @@ double* getArrayData(Field* f) {
   }
 }
 
+double* getArrayData(Field* f, MeshEntity* e, int& size) {
+  if (!isFrozen(f)) {
+    size = 0;
+    return 0;
+  }
+  FieldDataOf<double>* p = f->getData();
+  ArrayDataOf<double>* a = static_cast<ArrayDataOf<double>* > (p);
+  return a->getEntityArray(e, size);
+}
+
+double* getArrayData(Field* f, int dimension, long& size) {
+  if (!isFrozen(f)) {
+    size = 0;
+    return 0;
+  }
+  FieldDataOf<double>* p = f->getData();
+  ArrayDataOf<double>* a = static_cast<ArrayDataOf<double>* > (p);
+  return a->getDimensionArray(dimension, size);
+}
+
 }
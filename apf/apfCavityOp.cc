@@ -9,9 +9,18 @@
 #include "apfCavityOp.h"
 #include "apf.h"
 #include "apfMesh2.h"
+#include <climits>
+#include <algorithm>
 
 namespace apf {
 
+static int cavityThreads = 1;
+
+void setCavityThreads(int n)
+{
+  cavityThreads = n;
+}
+
 CavityOp::CavityOp(Mesh* m, bool cm):
   mesh(m),
   isRequesting(false),
@@ -91,8 +100,159 @@ void CavityOp::applyLocallyWithoutModification(int d)
   mesh->end(entities);
 }
 
+typedef std::vector<MeshEntity*> Cavities;
+
+static void getColorVerts(Mesh* m, MeshEntity* e, bool cavity,
+    Cavities& verts)
+{
+  verts.clear();
+  if ( ! cavity) {
+    Downward down;
+    int nd = m->getDownward(e, 0, down);
+    verts.assign(down, down + nd);
+    return;
+  }
+  Adjacent elements;
+  m->getAdjacent(e, m->getDimension(), elements);
+  for (size_t i = 0; i < elements.getSize(); ++i) {
+    Downward down;
+    int nd = m->getDownward(elements[i], 0, down);
+    verts.insert(verts.end(), down, down + nd);
+  }
+  std::sort(verts.begin(), verts.end());
+  verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+}
+
+/* greedy coloring such that no two cavities of one color
+   share a vertex. each vertex holds a bit mask of the
+   colors around it, so one round handles as many colors
+   as there are bits in a long, and the cavities that don't
+   fit are colored in the next round. */
+static void colorEntities(
+    Mesh* m,
+    Cavities& entities,
+    bool cavity,
+    std::vector<Cavities>& colors)
+{
+  int const bits = sizeof(long) * CHAR_BIT;
+  MeshTag* tag = m->createLongTag("apf_cavity_colors", 2);
+  Cavities left;
+  Cavities verts;
+  std::vector<unsigned long> masks;
+  for (long round = 0; ! entities.empty(); ++round) {
+    for (size_t i = 0; i < entities.size(); ++i) {
+      MeshEntity* e = entities[i];
+      getColorVerts(m, e, cavity, verts);
+      masks.assign(verts.size(), 0);
+      unsigned long used = 0;
+      for (size_t j = 0; j < verts.size(); ++j) {
+        long mask[2];
+        if ( ! m->hasTag(verts[j], tag))
+          continue;
+        m->getLongTag(verts[j], tag, mask);
+        if (mask[0] == round)
+          masks[j] = static_cast<unsigned long>(mask[1]);
+        used |= masks[j];
+      }
+      if ( ! (~used)) {
+        left.push_back(e);
+        continue;
+      }
+      int c = 0;
+      while (used & (1UL << c))
+        ++c;
+      for (size_t j = 0; j < verts.size(); ++j) {
+        long mask[2];
+        mask[0] = round;
+        mask[1] = static_cast<long>(masks[j] | (1UL << c));
+        m->setLongTag(verts[j], tag, mask);
+      }
+      size_t color = round * bits + c;
+      if (colors.size() <= color)
+        colors.resize(color + 1);
+      colors[color].push_back(e);
+    }
+    entities.swap(left);
+    left.clear();
+  }
+  removeTagFromDimension(m, tag, 0);
+  m->destroyTag(tag);
+}
+
+void colorByVertices(
+    Mesh* m,
+    std::vector<MeshEntity*> const& entities,
+    std::vector<std::vector<MeshEntity*> >& colors)
+{
+  Cavities left(entities);
+  colorEntities(m, left, false, colors);
+}
+
+void colorCavities(
+    Mesh* m,
+    std::vector<MeshEntity*> const& entities,
+    std::vector<std::vector<MeshEntity*> >& colors)
+{
+  Cavities left(entities);
+  colorEntities(m, left, true, colors);
+}
+
+struct CavityWork
+{
+  std::vector<CavityOp*>* ops;
+  Cavities* cavities;
+};
+
+static void applyCavities(int thread, void* data)
+{
+  CavityWork* w = static_cast<CavityWork*>(data);
+  CavityOp* op = (*w->ops)[thread];
+  Cavities& cavities = *(w->cavities);
+  size_t n = w->ops->size();
+  for (size_t i = thread; i < cavities.size(); i += n)
+    if (op->setEntity(cavities[i]) == CavityOp::OK)
+      op->apply();
+}
+
+void CavityOp::applyLocallyInThreads(int d, std::vector<CavityOp*>& ops)
+{
+  Cavities entities;
+  MeshIterator* it = mesh->begin(d);
+  MeshEntity* e;
+  while ((e = mesh->iterate(it)))
+    if (mesh->isOwned(e))
+      entities.push_back(e);
+  mesh->end(it);
+  std::vector<Cavities> colors;
+  colorEntities(mesh, entities, true, colors);
+  for (size_t i = 0; i < ops.size(); ++i)
+    ops[i]->isRequesting = true;
+  CavityWork w;
+  w.ops = &ops;
+  for (size_t i = 0; i < colors.size(); ++i) {
+    w.cavities = &colors[i];
+    PCU_Work_Run(ops.size(), applyCavities, &w);
+  }
+  /* each copy collected its own requests */
+  for (size_t i = 1; i < ops.size(); ++i) {
+    Requests& r = ops[i]->requests;
+    requests.insert(requests.end(), r.begin(), r.end());
+    r.clear();
+  }
+}
+
 void CavityOp::applyToDimension(int d)
 {
+  std::vector<CavityOp*> ops;
+  if (( ! this->canModify) && (cavityThreads > 1)) {
+    CavityOp* copy = clone();
+    if (copy) {
+      ops.push_back(this);
+      ops.push_back(copy);
+      for (int i = 2; i < cavityThreads; ++i)
+        ops.push_back(clone());
+    }
+  }
   /* the iteration count of this loop is hard to predict,
    * but typical cavity definitions should cause a small
    * constant number of iterations that does not grow
@@ -103,6 +263,8 @@ void CavityOp::applyToDimension(int d)
        and request missing cavity elements */
     if (this->canModify)
       this->applyLocallyWithModification(d);
+    else if (ops.size())
+      this->applyLocallyInThreads(d, ops);
     else
       this->applyLocallyWithoutModification(d);
     /* this is the exit of the loop:
@@ -111,6 +273,8 @@ void CavityOp::applyToDimension(int d)
        that all mesh entities that needed to be operated
        on have been. */
   } while (tryToPull());
+  for (size_t i = 1; i < ops.size(); ++i)
+    delete ops[i];
 }
 
 bool CavityOp::requestLocality(MeshEntity** entities, int count)
@@ -63,6 +63,19 @@ namespace apf {
    mesh modifying operators should call preDeletion(e) before
    actually deleting an entity to prevent a crash due to
    iterator invalidation.
+
+   Operators that do not modify the mesh can be applied by
+   several threads per process (see apf::setCavityThreads)
+   if they implement clone().
+   In that case, all owned entities of the dimension are
+   first grouped by a greedy coloring into sets whose cavities,
+   the closures of their adjacent elements, share no vertices.
+   Each set is then applied by all threads at once, with
+   each thread calling setEntity and apply on its own copy
+   of the operator, so SKIP decisions are made in the threads.
+   Threaded operators may write to the closure of the
+   elements adjacent to the entity, and setEntity should
+   not depend on what apply writes for other entities.
 */
 
 /** \brief user-defined mesh cavity operator */
@@ -73,6 +86,7 @@ class CavityOp
       \param canModify true iff the operator can create or
                        destroy mesh entities */
     CavityOp(Mesh* m, bool canModify = false);
+    virtual ~CavityOp() {}
     /** \brief outcome of a setEntity call */
     enum Outcome {
       /** \brief skip the given entity */
@@ -85,6 +99,10 @@ class CavityOp
     virtual Outcome setEntity(MeshEntity* e) = 0;
     /** \brief apply the operator on the (now local) cavity */
     virtual void apply() = 0;
+    /** \brief make a copy of this operator for another thread
+      \details the default returns zero, which means the
+      operator will not be threaded. */
+    virtual CavityOp* clone() {return 0;}
     /** \brief parallel collective operation over entities of one dimension */
     void applyToDimension(int d);
     /** \brief within setEntity, require that entities be made local */
@@ -102,11 +120,40 @@ class CavityOp
     bool tryToPull();
     void applyLocallyWithModification(int d);
     void applyLocallyWithoutModification(int d);
+    void applyLocallyInThreads(int d, std::vector<CavityOp*>& copies);
     bool canModify;
     bool movedByDeletion;
     MeshIterator* iterator;
 };
 
+/** \brief set the number of threads that apply cavity operators
+  \details this affects operators that do not modify the mesh
+  and implement apf::CavityOp::clone.
+  The default is one thread.
+  If PCU was built without threads, cavities are still
+  grouped as if threaded but are applied serially. */
+void setCavityThreads(int n);
+
+/** \brief group entities into sets that share no vertices
+  \details this is the greedy coloring used to thread
+  cavity operators, applied to the closures of the given
+  entities instead of their cavities. Threads can then
+  modify the closures of all entities in one set at once.
+  The entities of each set keep their order in \a entities. */
+void colorByVertices(
+    Mesh* m,
+    std::vector<MeshEntity*> const& entities,
+    std::vector<std::vector<MeshEntity*> >& colors);
+
+/** \brief group entities into sets whose cavities share no vertices
+  \details the cavity of an entity is the set of elements adjacent
+  to it. This is the grouping threaded cavity operators
+  apply one set at a time. */
+void colorCavities(
+    Mesh* m,
+    std::vector<MeshEntity*> const& entities,
+    std::vector<std::vector<MeshEntity*> >& colors);
+
 } //namespace apf
 
 #endif
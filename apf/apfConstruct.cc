@@ -4,31 +4,30 @@
 #include "apf.h"
 #include "apfNumbering.h"
 #include <map>
+#include <cassert>
 
 namespace apf {
 
-typedef int Gid;
-
 static void constructVerts(
-    Mesh2* m, Gid* conn, int nelem, int etype,
+    Mesh2* m, const Gid* conn, long nelem, int etype,
     GlobalToVert& result)
 {
   ModelEntity* interior = m->findModelEntity(m->getDimension(), 0);
-  int end = nelem * apf::Mesh::adjacentCount[etype][0];
-  for (int i = 0; i < end; ++i)
+  long end = nelem * apf::Mesh::adjacentCount[etype][0];
+  for (long i = 0; i < end; ++i)
     if ( ! result.count(conn[i]))
       result[conn[i]] = m->createVert_(interior);
 }
 
 static void constructElements(
-    Mesh2* m, Gid* conn, int nelem, int etype,
+    Mesh2* m, const Gid* conn, long nelem, int etype,
     GlobalToVert& globalToVert)
 {
   ModelEntity* interior = m->findModelEntity(m->getDimension(), 0);
   int nev = apf::Mesh::adjacentCount[etype][0];
-  for (int i = 0; i < nelem; ++i) {
+  for (long i = 0; i < nelem; ++i) {
     Downward verts;
-    int offset = i * nev;
+    long offset = i * nev;
     for (int j = 0; j < nev; ++j)
       verts[j] = globalToVert[conn[j + offset]];
     buildElement(m, interior, etype, verts);
@@ -40,7 +39,7 @@ static Gid getMax(const GlobalToVert& globalToVert)
   Gid max = -1;
   APF_CONST_ITERATE(GlobalToVert, globalToVert, it)
     max = std::max(max, it->first);
-  PCU_Max_Ints(&max, 1); // this is type-dependent
+  PCU_Max_Longs(&max, 1); // this is type-dependent
   return max;
 }
 
@@ -55,9 +54,9 @@ static void constructResidence(Mesh2* m, GlobalToVert& globalToVert)
   Gid max = getMax(globalToVert);
   Gid total = max + 1;
   int peers = PCU_Comm_Peers();
-  int quotient = total / peers;
-  int remainder = total % peers;
-  int mySize = quotient;
+  Gid quotient = total / peers;
+  Gid remainder = total % peers;
+  Gid mySize = quotient;
   int self = PCU_Comm_Self();
   if (self == (peers - 1))
     mySize += remainder;
@@ -67,16 +66,16 @@ static void constructResidence(Mesh2* m, GlobalToVert& globalToVert)
      broker for that global id */
   PCU_Comm_Begin();
   APF_ITERATE(GlobalToVert, globalToVert, it) {
-    int gid = it->first;
-    int to = std::min(peers - 1, gid / quotient);
+    Gid gid = it->first;
+    int to = std::min(Gid(peers - 1), gid / quotient);
     PCU_COMM_PACK(to, gid);
   }
   PCU_Comm_Send();
-  int myOffset = self * quotient;
+  Gid myOffset = self * quotient;
   /* brokers store all the part ids that sent messages
      for each global id */
   while (PCU_Comm_Receive()) {
-    int gid;
+    Gid gid;
     PCU_COMM_UNPACK(gid);
     int from = PCU_Comm_Sender();
     tmpParts.at(gid - myOffset).push_back(from);
@@ -84,11 +83,11 @@ static void constructResidence(Mesh2* m, GlobalToVert& globalToVert)
   /* for each global id, send all associated part ids
      to all associated parts */
   PCU_Comm_Begin();
-  for (int i = 0; i < mySize; ++i) {
+  for (Gid i = 0; i < mySize; ++i) {
     std::vector<int>& parts = tmpParts[i];
     for (size_t j = 0; j < parts.size(); ++j) {
       int to = parts[j];
-      int gid = i + myOffset;
+      Gid gid = i + myOffset;
       int nparts = parts.size();
       PCU_COMM_PACK(to, gid);
       PCU_COMM_PACK(to, nparts);
@@ -101,7 +100,7 @@ static void constructResidence(Mesh2* m, GlobalToVert& globalToVert)
      lookup the vertex and classify it on the partition
      model entity for that set of parts */
   while (PCU_Comm_Receive()) {
-    int gid;
+    Gid gid;
     PCU_COMM_UNPACK(gid);
     int nparts;
     PCU_COMM_UNPACK(nparts);
@@ -124,7 +123,7 @@ static void constructRemotes(Mesh2* m, GlobalToVert& globalToVert)
   int self = PCU_Comm_Self();
   PCU_Comm_Begin();
   APF_ITERATE(GlobalToVert, globalToVert, it) {
-    int gid = it->first;
+    Gid gid = it->first;
     MeshEntity* vert = it->second;
     Parts residence;
     m->getResidence(vert, residence);
@@ -136,7 +135,7 @@ static void constructRemotes(Mesh2* m, GlobalToVert& globalToVert)
   }
   PCU_Comm_Send();
   while (PCU_Comm_Receive()) {
-    int gid;
+    Gid gid;
     PCU_COMM_UNPACK(gid);
     MeshEntity* remote;
     PCU_COMM_UNPACK(remote);
@@ -146,7 +145,7 @@ static void constructRemotes(Mesh2* m, GlobalToVert& globalToVert)
   }
 }
 
-void construct(Mesh2* m, int* conn, int nelem, int etype,
+void construct(Mesh2* m, const Gid* conn, long nelem, int etype,
     GlobalToVert& globalToVert)
 {
   constructVerts(m, conn, nelem, etype, globalToVert);
@@ -157,30 +156,38 @@ void construct(Mesh2* m, int* conn, int nelem, int etype,
   m->acceptChanges();
 }
 
+void construct(Mesh2* m, const int* conn, int nelem, int etype,
+    GlobalToVert& globalToVert)
+{
+  long size = long(nelem) * apf::Mesh::adjacentCount[etype][0];
+  std::vector<Gid> wide(conn, conn + size);
+  construct(m, &wide[0], nelem, etype, globalToVert);
+}
+
 void setCoords(Mesh2* m, const double* coords, int nverts,
     GlobalToVert& globalToVert)
 {
   Gid max = getMax(globalToVert);
   Gid total = max + 1;
   int peers = PCU_Comm_Peers();
-  int quotient = total / peers;
-  int remainder = total % peers;
-  int mySize = quotient;
+  Gid quotient = total / peers;
+  Gid remainder = total % peers;
+  Gid mySize = quotient;
   int self = PCU_Comm_Self();
   if (self == (peers - 1))
     mySize += remainder;
-  int myOffset = self * quotient;
+  Gid myOffset = self * quotient;
 
   /* Force each peer to have exactly mySize verts.
      This means we might need to send and recv some coords */
   double* c = new double[mySize*3];
 
-  int start = nverts;
-  PCU_Exscan_Ints(&start, 1);
+  Gid start = nverts;
+  PCU_Exscan_Longs(&start, 1);
 
   PCU_Comm_Begin();
-  int to = std::min(peers - 1, start / quotient);
-  int n = std::min((to+1)*quotient-start, nverts);
+  int to = std::min(Gid(peers - 1), start / quotient);
+  int n = std::min((to+1)*quotient-start, Gid(nverts));
   while (nverts > 0) {
     PCU_COMM_PACK(to, start);
     PCU_COMM_PACK(to, n);
@@ -190,7 +197,7 @@ void setCoords(Mesh2* m, const double* coords, int nverts,
     start += n;
     coords += n*3;
     to = std::min(peers - 1, to + 1);
-    n = std::min(quotient, nverts);
+    n = std::min(quotient, Gid(nverts));
   }
   PCU_Comm_Send();
   while (PCU_Comm_Receive()) {
@@ -204,13 +211,13 @@ void setCoords(Mesh2* m, const double* coords, int nverts,
   TmpParts tmpParts(mySize);
   PCU_Comm_Begin();
   APF_CONST_ITERATE(GlobalToVert, globalToVert, it) {
-    int gid = it->first;
-    int to = std::min(peers - 1, gid / quotient);
+    Gid gid = it->first;
+    int to = std::min(Gid(peers - 1), gid / quotient);
     PCU_COMM_PACK(to, gid);
   }
   PCU_Comm_Send();
   while (PCU_Comm_Receive()) {
-    int gid;
+    Gid gid;
     PCU_COMM_UNPACK(gid);
     int from = PCU_Comm_Sender();
     tmpParts.at(gid - myOffset).push_back(from);
@@ -218,18 +225,18 @@ void setCoords(Mesh2* m, const double* coords, int nverts,
   
   /* Send the coords to everybody who want them */
   PCU_Comm_Begin();
-  for (int i = 0; i < mySize; ++i) {
+  for (Gid i = 0; i < mySize; ++i) {
     std::vector<int>& parts = tmpParts[i];
     for (size_t j = 0; j < parts.size(); ++j) {
       int to = parts[j];
-      int gid = i + myOffset;
+      Gid gid = i + myOffset;
       PCU_COMM_PACK(to, gid);
       PCU_Comm_Pack(to, &c[i*3], 3*sizeof(double));
     }
   }
   PCU_Comm_Send();
   while (PCU_Comm_Receive()) {
-    int gid;
+    Gid gid;
     PCU_COMM_UNPACK(gid);
     double v[3];
     PCU_Comm_Unpack(v, sizeof(v));
@@ -240,7 +247,7 @@ void setCoords(Mesh2* m, const double* coords, int nverts,
   delete [] c;
 }
 
-void destruct(Mesh2* m, int*& conn, int& nelem, int &etype)
+void destruct(Mesh2* m, Gid*& conn, long& nelem, int &etype)
 {
   int dim = m->getDimension();
   nelem = m->count(dim);
@@ -249,7 +256,7 @@ void destruct(Mesh2* m, int*& conn, int& nelem, int &etype)
   synchronize(global);
   MeshIterator* it = m->begin(dim);
   MeshEntity* e;
-  int i = 0;
+  long i = 0;
   while ((e = m->iterate(it))) {
     etype = m->getType(e);
     Downward verts;
@@ -263,6 +270,21 @@ void destruct(Mesh2* m, int*& conn, int& nelem, int &etype)
   destroyGlobalNumbering(global);
 }
 
+void destruct(Mesh2* m, int*& conn, int& nelem, int &etype)
+{
+  Gid* wide;
+  long n;
+  destruct(m, wide, n, etype);
+  nelem = n;
+  long size = n * apf::Mesh::adjacentCount[etype][0];
+  conn = new int[size];
+  for (long i = 0; i < size; ++i) {
+    conn[i] = wide[i];
+    assert(conn[i] == wide[i]);
+  }
+  delete [] wide;
+}
+
 void extractCoords(Mesh2* m, double*& coords, int& nverts)
 {
   nverts = countOwned(m, 0);
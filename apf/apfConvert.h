@@ -27,8 +27,12 @@ class MeshEntity;
   tool. */
 void convert(Mesh *in, Mesh2 *out);
 
+/** \brief a global vertex id, wide enough for meshes
+  with more than 2^31 vertices */
+typedef long Gid;
+
 /** \brief a map from global ids to vertex objects */
-typedef std::map<int, MeshEntity*> GlobalToVert;
+typedef std::map<Gid, MeshEntity*> GlobalToVert;
 
 /** \brief construct a mesh from just a connectivity array
   \details this function is here to interface with very
@@ -44,7 +48,12 @@ typedef std::map<int, MeshEntity*> GlobalToVert;
 
   Note that all vertices will have zero coordinates, so
   it is often good to use apf::setCoords after this. */
-void construct(Mesh2* m, int* conn, int nelem, int etype,
+void construct(Mesh2* m, const Gid* conn, long nelem, int etype,
+    GlobalToVert& globalToVert);
+
+/** \brief construct a mesh from a 32-bit connectivity array
+  \details see the apf::Gid version of apf::construct */
+void construct(Mesh2* m, const int* conn, int nelem, int etype,
     GlobalToVert& globalToVert);
 
 /** \brief Assign coordinates to the mesh
@@ -60,6 +69,10 @@ void setCoords(Mesh2* m, const double* coords, int nverts,
 
 /** \brief convert an apf::Mesh2 object into a connectivity array
   \details this is useful for debugging the apf::convert function */
+void destruct(Mesh2* m, Gid*& conn, long& nelem, int &etype);
+
+/** \brief convert an apf::Mesh2 object into a 32-bit connectivity array
+  \details this fails if any global vertex id does not fit in an int */
 void destruct(Mesh2* m, int*& conn, int& nelem, int &etype);
 
 /** \brief get a contiguous set of global vertex coordinates
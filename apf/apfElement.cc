@@ -9,9 +9,108 @@
 #include "apfShape.h"
 #include "apfMesh.h"
 #include "apfVectorElement.h"
+#include "apfIntegrate.h"
+#include <PCU.h>
+#include <map>
 
 namespace apf {
 
+/* shape function values and local gradients of one EntityShape
+   at every point of one integration rule. there is one EntityShape
+   per field shape and element type, so these are computed once
+   per (field shape, element type, integration order) */
+struct ShapeTable
+{
+  ShapeTable(EntityShape* s, Integration const* i):
+    shape(s),
+    integration(i),
+    nodes(s->countNodes()),
+    points(i->countPoints()),
+    hasGradients(false)
+  {
+    values.allocate(nodes * points);
+    NewArray<double> v;
+    for (int p = 0; p < points; ++p)
+    {
+      shape->getValues(integration->getPoint(p)->param, v);
+      for (int n = 0; n < nodes; ++n)
+        values[p * nodes + n] = v[n];
+    }
+  }
+  /* some shapes have no gradients, so these wait until asked for */
+  void tabulateGradients()
+  {
+    gradients.allocate(nodes * points);
+    NewArray<Vector3> g;
+    for (int q = 0; q < points; ++q)
+    {
+      shape->getLocalGradients(integration->getPoint(q)->param, g);
+      for (int n = 0; n < nodes; ++n)
+        gradients[q * nodes + n] = g[n];
+    }
+    hasGradients = true;
+  }
+  Vector3 const* getGradients(int p)
+  {
+    return &(gradients[p * nodes]);
+  }
+  double const* getValues(int p)
+  {
+    return &(values[p * nodes]);
+  }
+  EntityShape* shape;
+  Integration const* integration;
+  int nodes;
+  int points;
+  bool hasGradients;
+  NewArray<double> values;
+  NewArray<Vector3> gradients;
+};
+
+/* elements may be evaluated by several PCU_Work_Run workers,
+   so the tables are only built or extended under the PCU worker
+   lock, which costs nothing when PCU has no threads.
+   elements remember what they got and don't come back */
+class ShapeTables
+{
+  public:
+    ~ShapeTables()
+    {
+      APF_ITERATE(Tables,tables,it)
+        delete it->second;
+    }
+    ShapeTable* get(EntityShape* s, int type, int order)
+    {
+      PCU_Work_Lock();
+      Key k(s,order);
+      Tables::iterator it = tables.find(k);
+      ShapeTable* t;
+      if (it != tables.end())
+        t = it->second;
+      else
+      {
+        Integration const* i = getIntegration(type)->getAccurate(order);
+        t = i ? new ShapeTable(s,i) : 0;
+        tables[k] = t;
+      }
+      PCU_Work_Unlock();
+      return t;
+    }
+    void needGradients(ShapeTable* t)
+    {
+      PCU_Work_Lock();
+      if (!t->hasGradients)
+        t->tabulateGradients();
+      PCU_Work_Unlock();
+    }
+  private:
+    typedef std::pair<EntityShape*,int> Key;
+    typedef std::map<Key,ShapeTable*> Tables;
+    Tables tables;
+};
+
+static ShapeTables shapeTables;
+
 void Element::init(Field* f, MeshEntity* e, VectorElement* p)
 {
   field = f;
@@ -21,6 +120,11 @@ void Element::init(Field* f, MeshEntity* e, VectorElement* p)
   parent = p;
   nen = shape->countNodes();
   nc = f->countComponents();
+  ipOrder = -1;
+  ipPoint = -1;
+  table = 0;
+  tableOrder = -1;
+  tableGradients = false;
   getNodeData();
 }
 
@@ -72,23 +176,92 @@ static Matrix3x3 getJacobianInverse(Matrix3x3 J, int dim)
   }
 }
 
+void Element::setIntPoint(int order, int point, Vector3 const& xi)
+{
+  ipOrder = order;
+  ipPoint = point;
+  ipParam = xi;
+}
+
+int Element::findIntPoint(Vector3 const& xi)
+{
+  Element* root = this;
+  while (root->parent)
+    root = root->parent;
+  if (root->ipOrder < 0 || !(root->ipParam == xi))
+    return -1;
+  if (root->ipOrder != tableOrder)
+  {
+    table = shapeTables.get(shape,getType(),root->ipOrder);
+    tableOrder = root->ipOrder;
+    tableGradients = false;
+  }
+  if (!table || root->ipPoint >= table->points)
+    return -1;
+  return root->ipPoint;
+}
+
+double const* Element::getValuesAt(Vector3 const& xi,
+    NewArray<double>& buffer)
+{
+  int p = findIntPoint(xi);
+  if (p >= 0)
+    return table->getValues(p);
+  shape->getValues(xi,buffer);
+  return &(buffer[0]);
+}
+
+Vector3 const* Element::getLocalGradientsAt(Vector3 const& xi,
+    NewArray<Vector3>& buffer)
+{
+  int p = findIntPoint(xi);
+  if (p >= 0)
+  {
+    if (!tableGradients)
+    {
+      shapeTables.needGradients(table);
+      tableGradients = true;
+    }
+    return table->getGradients(p);
+  }
+  shape->getLocalGradients(xi,buffer);
+  return &(buffer[0]);
+}
+
 void Element::getGlobalGradients(Vector3 const& local,
-                                 NewArray<Vector3>& globalGradients)
+                                 Vector3* globalGradients)
 {
   Matrix3x3 J;
   parent->getJacobian(local,J);
   Matrix3x3 jinv = getJacobianInverse(J, getDimension());
-  NewArray<Vector3> localGradients;
-  shape->getLocalGradients(local,localGradients);
-  globalGradients.allocate(nen);
+  NewArray<Vector3> buffer;
+  Vector3 const* localGradients = getLocalGradientsAt(local,buffer);
   for (int i=0; i < nen; ++i)
     globalGradients[i] = jinv * localGradients[i];
 }
 
+void Element::getGlobalGradients(Vector3 const& local,
+                                 NewArray<Vector3>& globalGradients)
+{
+  globalGradients.allocate(nen);
+  getGlobalGradients(local,&(globalGradients[0]));
+}
+
+void Element::getShapeValues(Vector3 const& local, NewArray<double>& values)
+{
+  int p = findIntPoint(local);
+  if (p < 0)
+    return shape->getValues(local,values);
+  values.allocate(nen);
+  double const* v = table->getValues(p);
+  for (int i=0; i < nen; ++i)
+    values[i] = v[i];
+}
+
 void Element::getComponents(Vector3 const& xi, double* c)
 {
-  NewArray<double> shapeValues;
-  shape->getValues(xi,shapeValues);
+  NewArray<double> buffer;
+  double const* shapeValues = getValuesAt(xi,buffer);
   for (int ci = 0; ci < nc; ++ci)
     c[ci] = 0;
   for (int ni = 0; ni < nen; ++ni)
@@ -98,7 +271,8 @@ void Element::getComponents(Vector3 const& xi, double* c)
 
 void Element::getNodeData()
 {
-  field->getData()->getElementData(entity,nodeData);
+  nodeData.allocate(nen * nc);
+  field->getData()->getElementData(entity,&(nodeData[0]));
 }
 
 }//namespace apf
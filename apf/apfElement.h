@@ -16,6 +16,36 @@ namespace apf {
 
 class EntityShape;
 class VectorElement;
+struct ShapeTable;
+
+/** \brief array of per-node data that stays inside its owner
+  \details up to N entries are kept in a member array, which covers
+  the node counts of linear and quadratic elements without going
+  to the heap. Larger sizes fall back to a NewArray. */
+template <class T, int N>
+class NodeBuffer
+{
+  public:
+    NodeBuffer():elements(inline_elements) {}
+    void allocate(int n)
+    {
+      if (n <= N)
+        elements = inline_elements;
+      else
+      {
+        heap.allocate(n);
+        elements = &(heap[0]);
+      }
+    }
+    T& operator[](int i) {return elements[i];}
+    T const& operator[](int i) const {return elements[i];}
+  private:
+    NodeBuffer(NodeBuffer const&);
+    void operator=(NodeBuffer const&);
+    T* elements;
+    T inline_elements[N];
+    NewArray<T> heap;
+};
 
 class Element
 {
@@ -25,6 +55,9 @@ class Element
     virtual ~Element();
     void getGlobalGradients(Vector3 const& local,
                             NewArray<Vector3>& globalGradients);
+    void getGlobalGradients(Vector3 const& local,
+                            Vector3* globalGradients);
+    void getShapeValues(Vector3 const& local, NewArray<double>& values);
     int getType() {return mesh->getType(entity);}
     int getDimension() {return Mesh::typeDimension[getType()];}
     int getOrder() {return field->getShape()->getOrder();}
@@ -32,9 +65,14 @@ class Element
     MeshEntity* getEntity() {return entity;}
     EntityShape* getShape() {return shape;}
     void getComponents(Vector3 const& xi, double* c);
+    void setIntPoint(int order, int point, Vector3 const& xi);
   protected:
     void init(Field* f, MeshEntity* e, VectorElement* p);
     void getNodeData();
+    int findIntPoint(Vector3 const& xi);
+    double const* getValuesAt(Vector3 const& xi, NewArray<double>& buffer);
+    Vector3 const* getLocalGradientsAt(Vector3 const& xi,
+        NewArray<Vector3>& buffer);
     Field* field;
     Mesh* mesh;
     MeshEntity* entity;
@@ -42,7 +80,16 @@ class Element
     VectorElement* parent;
     int nen;
     int nc;
-    NewArray<double> nodeData;
+    NodeBuffer<double,30> nodeData;
+/* the integration point last given to the mesh element by getIntPoint.
+   evaluations at exactly that point read the shape table instead
+   of calling the EntityShape */
+    int ipOrder;
+    int ipPoint;
+    Vector3 ipParam;
+    ShapeTable* table;
+    int tableOrder;
+    bool tableGradients;
 };
 
 }//namespace apf
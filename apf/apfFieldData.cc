@@ -34,14 +34,17 @@ void synchronizeFieldData(FieldDataOf<T>* data, Sharing* shr)
           ( ! shr->isOwned(e)))
         continue;
       int n = f->countValuesOn(e);
-      NewArray<T> values(n);
-      data->get(e,&(values[0]));
       CopyArray copies;
       shr->getCopies(e, copies);
       for (size_t i = 0; i < copies.getSize(); ++i)
       {
         PCU_COMM_PACK(copies[i].peer, copies[i].entity);
-        PCU_Comm_Pack(copies[i].peer, &(values[0]), n*sizeof(T));
+        /* serialize straight into the send buffers.
+           packing again for the same peer may move what was
+           reserved before, so each copy reads the field again */
+        T* values = static_cast<T*>(
+            PCU_Comm_Reserve(copies[i].peer, n*sizeof(T)));
+        data->get(e,values);
       }
     }
     m->end(it);
@@ -51,9 +54,7 @@ void synchronizeFieldData(FieldDataOf<T>* data, Sharing* shr)
       MeshEntity* e;
       PCU_COMM_UNPACK(e);
       int n = f->countValuesOn(e);
-      NewArray<T> values(n);
-      PCU_Comm_Unpack(&(values[0]),n*sizeof(T));
-      data->set(e,&(values[0]));
+      data->set(e,static_cast<T*>(PCU_Comm_Extract(n*sizeof(T))));
     }
   }
   delete shr;
@@ -127,14 +128,14 @@ void accumulateFieldData(FieldDataOf<double>* data, Sharing* shr)
       CopyArray copies;
       shr->getCopies(e, copies);
       int n = f->countValuesOn(e);
-      NewArray<double> values(n);
-      data->get(e,&(values[0]));
       /* actually, non-owners send to all others,
          since apf::Sharing doesn't identify the owner */
       for (size_t i = 0; i < copies.getSize(); ++i)
       {
         PCU_COMM_PACK(copies[i].peer, copies[i].entity);
-        PCU_Comm_Pack(copies[i].peer, &(values[0]), n*sizeof(double));
+        double* values = static_cast<double*>(
+            PCU_Comm_Reserve(copies[i].peer, n*sizeof(double)));
+        data->get(e,values);
       }
     }
     m->end(it);
@@ -147,8 +148,8 @@ void accumulateFieldData(FieldDataOf<double>* data, Sharing* shr)
         PCU_COMM_UNPACK(e);
         int n = f->countValuesOn(e);
         NewArray<double> values(n);
-        NewArray<double> inValues(n);
-        PCU_Comm_Unpack(&(inValues[0]),n*sizeof(double));
+        double* inValues = static_cast<double*>(
+            PCU_Comm_Extract(n*sizeof(double)));
         data->get(e,&(values[0]));
         for (int i = 0; i < n; ++i)
           values[i] += inValues[i];
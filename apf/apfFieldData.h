@@ -75,6 +75,16 @@ class FieldDataOf : public FieldData
         components[i] = allComponents[node*nc+i];
     }
     int getElementData(MeshEntity* entity, NewArray<T>& data)
+    {
+      Mesh* mesh = field->getMesh();
+      EntityShape* es = field->getShape()->getEntityShape(
+          mesh->getType(entity));
+      data.allocate(field->countComponents() * es->countNodes());
+      return getElementData(entity, &(data[0]));
+    }
+    /* fills data, which must have room for all
+       components of all the element's nodes */
+    int getElementData(MeshEntity* entity, T* data)
     {
       Mesh* mesh = field->getMesh();
       int t = mesh->getType(entity);
@@ -83,7 +93,6 @@ class FieldDataOf : public FieldData
       EntityShape* es = fs->getEntityShape(t);
       int nc = field->countComponents();
       int nen = es->countNodes();
-      data.allocate(nc * nen);
       int n = 0;
       for (int d = 0; d <= ed; ++d)
       {
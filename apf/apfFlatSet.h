@@ -0,0 +1,239 @@
+/*
+ * Copyright 2026 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef APFFLATSET_H
+#define APFFLATSET_H
+
+/** \file apfFlatSet.h
+    \brief sorted array replacements for small std::set and std::map */
+
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+namespace apf {
+
+/** \brief a sorted array with inline storage for N elements.
+  \details this is the storage behind apf::FlatSet and apf::FlatMap.
+  The first N elements live inside the object, so most
+  containers of part ids never touch the heap.
+  Larger containers spill into a heap array. */
+template <class T, std::size_t N>
+class FlatStorage
+{
+  public:
+    FlatStorage():data(inlined),size(0),capacity(N) {}
+    FlatStorage(FlatStorage<T,N> const& other):
+      data(inlined),size(0),capacity(N)
+    {
+      assign(other.data, other.data + other.size);
+    }
+    ~FlatStorage()
+    {
+      if (data != inlined)
+        delete [] data;
+    }
+    FlatStorage<T,N>& operator=(FlatStorage<T,N> const& other)
+    {
+      if (&other != this)
+        assign(other.data, other.data + other.size);
+      return *this;
+    }
+    void assign(T const* first, T const* last)
+    {
+      size = 0;
+      reserve(last - first);
+      std::copy(first, last, data);
+      size = last - first;
+    }
+    void reserve(std::size_t n)
+    {
+      if (n <= capacity)
+        return;
+      std::size_t newCapacity = std::max(n, capacity * 2);
+      T* newData = new T[newCapacity];
+      std::copy(data, data + size, newData);
+      if (data != inlined)
+        delete [] data;
+      data = newData;
+      capacity = newCapacity;
+    }
+    T* insertAt(T* at, T const& value)
+    {
+      std::size_t i = at - data;
+      reserve(size + 1);
+      std::copy_backward(data + i, data + size, data + size + 1);
+      data[i] = value;
+      ++size;
+      return data + i;
+    }
+    void eraseAt(T* at)
+    {
+      std::copy(at + 1, data + size, at);
+      --size;
+    }
+    void clear() {size = 0;}
+    T* data;
+    std::size_t size;
+  private:
+    std::size_t capacity;
+    T inlined[N];
+};
+
+/** \brief a set of small values kept in a sorted array
+  \details this implements the part of the std::set interface
+  that APF uses, but lookups are binary searches over
+  contiguous memory and small sets need no allocation.
+  Insertion and removal are linear in the size,
+  so this is only meant for small sets such as part ids. */
+template <class T, std::size_t N = 8>
+class FlatSet
+{
+  public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef T const* iterator;
+    typedef T const* const_iterator;
+    FlatSet() {}
+    template <class It>
+    FlatSet(It first, It last) {insert(first, last);}
+    iterator begin() const {return s.data;}
+    iterator end() const {return s.data + s.size;}
+    std::size_t size() const {return s.size;}
+    bool empty() const {return !s.size;}
+    void clear() {s.clear();}
+    iterator find(T const& v) const
+    {
+      iterator it = std::lower_bound(begin(), end(), v);
+      if (it != end() && !(v < *it))
+        return it;
+      return end();
+    }
+    std::size_t count(T const& v) const {return find(v) != end();}
+    std::pair<iterator,bool> insert(T const& v)
+    {
+      T* it = std::lower_bound(s.data, s.data + s.size, v);
+      if (it != s.data + s.size && !(v < *it))
+        return std::make_pair(it, false);
+      return std::make_pair(s.insertAt(it, v), true);
+    }
+    template <class It>
+    void insert(It first, It last)
+    {
+      for (; first != last; ++first)
+        insert(*first);
+    }
+    std::size_t erase(T const& v)
+    {
+      iterator it = find(v);
+      if (it == end())
+        return 0;
+      erase(it);
+      return 1;
+    }
+    void erase(iterator it) {s.eraseAt(const_cast<T*>(it));}
+    bool operator==(FlatSet<T,N> const& other) const
+    {
+      return size() == other.size() &&
+        std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(FlatSet<T,N> const& other) const
+    {
+      return !(*this == other);
+    }
+    bool operator<(FlatSet<T,N> const& other) const
+    {
+      return std::lexicographical_compare(
+          begin(), end(), other.begin(), other.end());
+    }
+  private:
+    FlatStorage<T,N> s;
+};
+
+/** \brief a map from small keys kept in a sorted array of pairs
+  \details this is to std::map what apf::FlatSet is to std::set */
+template <class K, class V, std::size_t N = 8>
+class FlatMap
+{
+  public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K,V> value_type;
+    typedef value_type* iterator;
+    typedef value_type const* const_iterator;
+    FlatMap() {}
+    template <class It>
+    FlatMap(It first, It last) {insert(first, last);}
+    iterator begin() {return s.data;}
+    iterator end() {return s.data + s.size;}
+    const_iterator begin() const {return s.data;}
+    const_iterator end() const {return s.data + s.size;}
+    std::size_t size() const {return s.size;}
+    bool empty() const {return !s.size;}
+    void clear() {s.clear();}
+    iterator find(K const& k)
+    {
+      iterator it = lowerBound(k);
+      if (it != end() && !(k < it->first))
+        return it;
+      return end();
+    }
+    const_iterator find(K const& k) const
+    {
+      return const_cast<FlatMap<K,V,N>*>(this)->find(k);
+    }
+    std::size_t count(K const& k) const {return find(k) != end();}
+    std::pair<iterator,bool> insert(value_type const& v)
+    {
+      iterator it = lowerBound(v.first);
+      if (it != end() && !(v.first < it->first))
+        return std::make_pair(it, false);
+      return std::make_pair(s.insertAt(it, v), true);
+    }
+    template <class It>
+    void insert(It first, It last)
+    {
+      for (; first != last; ++first)
+        insert(*first);
+    }
+    V& operator[](K const& k)
+    {
+      return insert(value_type(k, V())).first->second;
+    }
+    std::size_t erase(K const& k)
+    {
+      iterator it = find(k);
+      if (it == end())
+        return 0;
+      erase(it);
+      return 1;
+    }
+    void erase(iterator it) {s.eraseAt(it);}
+    bool operator==(FlatMap<K,V,N> const& other) const
+    {
+      return size() == other.size() &&
+        std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(FlatMap<K,V,N> const& other) const
+    {
+      return !(*this == other);
+    }
+  private:
+    static bool keyLess(value_type const& a, K const& k)
+    {
+      return a.first < k;
+    }
+    iterator lowerBound(K const& k)
+    {
+      return std::lower_bound(begin(), end(), k, keyLess);
+    }
+    FlatStorage<value_type,N> s;
+};
+
+}
+
+#endif
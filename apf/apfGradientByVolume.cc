@@ -148,6 +148,10 @@ class RecoverGradient : public CavityOp
       GT grad = integrator.getResult();
       setValue(gradf,vert,grad);
     }
+    virtual CavityOp* clone()
+    {
+      return new RecoverGradient<T>(f,gradf);
+    }
   private:
     Mesh* mesh;
     MeshEntity* vert;
@@ -5,9 +5,16 @@
  * BSD license as described in the LICENSE file in the top-level directory.
  */
 
+#include <PCU.h>
 #include "apfIntegrate.h"
 #include "apfMesh.h"
 #include "apf.h"
+#include "apfShape.h"
+#include "apfField.h"
+#include "apfFieldData.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 namespace apf {
 
@@ -470,6 +477,232 @@ void Integrator::process(MeshElement* e)
   this->outElement();
 }
 
+static int integrationThreads = 1;
+
+void setIntegrationThreads(int n)
+{
+  integrationThreads = std::max(n, 1);
+}
+
+BlockIntegrator::BlockIntegrator(int o):
+  order(o),
+  threads(integrationThreads)
+{
+}
+
+BlockIntegrator::~BlockIntegrator()
+{
+}
+
+void BlockIntegrator::inProcess()
+{
+}
+
+void BlockIntegrator::parallelReduce()
+{
+}
+
+void BlockIntegrator::setThreads(int n)
+{
+  threads = std::max(n, 1);
+}
+
+/* large enough to amortize the per-block overhead,
+   small enough for the block arrays to stay in cache */
+enum { BLOCK_SIZE = 256 };
+
+/* what all blocks of one element type share: the integration
+   rule and the coordinate shape gradients at its points */
+struct BlockRule
+{
+  int dimension;
+  int points;
+  int nodes;
+  std::vector<Vector3> params;
+  std::vector<double> weights;
+  std::vector<Vector3> gradients;
+};
+
+struct BlockRange
+{
+  int type;
+  size_t first;
+  int count;
+};
+
+struct BlockWork
+{
+  BlockIntegrator* integrator;
+  FieldDataOf<double>* coordinates;
+  std::vector<MeshEntity*>* elements;
+  BlockRule* rules;
+  std::vector<BlockRange> blocks;
+  int threads;
+};
+
+/* the block arrays of one thread, reused from block to block */
+struct BlockScratch
+{
+  std::vector<double> element;
+  std::vector<double> x;
+  std::vector<double> J;
+  std::vector<double> dV;
+};
+
+/* the measures of getJacobianDeterminant, for n elements whose
+   Jacobian entry (i,j) is stored at J[(i * 3 + j) * n] */
+static void getBlockMeasures(int dimension, int n,
+    double const* J, double* dV)
+{
+  double const* J00 = J;
+  double const* J01 = J + 1 * n;
+  double const* J02 = J + 2 * n;
+  double const* J10 = J + 3 * n;
+  double const* J11 = J + 4 * n;
+  double const* J12 = J + 5 * n;
+  double const* J20 = J + 6 * n;
+  double const* J21 = J + 7 * n;
+  double const* J22 = J + 8 * n;
+  if (dimension == 3)
+  {
+    for (int i = 0; i < n; ++i)
+      dV[i] = J00[i] * (J11[i] * J22[i] - J12[i] * J21[i])
+            - J01[i] * (J10[i] * J22[i] - J12[i] * J20[i])
+            + J02[i] * (J10[i] * J21[i] - J11[i] * J20[i]);
+  }
+  else if (dimension == 2)
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      double c0 = J01[i] * J12[i] - J02[i] * J11[i];
+      double c1 = J02[i] * J10[i] - J00[i] * J12[i];
+      double c2 = J00[i] * J11[i] - J01[i] * J10[i];
+      dV[i] = sqrt(c0 * c0 + c1 * c1 + c2 * c2);
+    }
+  }
+  else
+  {
+    for (int i = 0; i < n; ++i)
+      dV[i] = sqrt(J00[i] * J00[i] + J01[i] * J01[i] + J02[i] * J02[i]);
+  }
+}
+
+static void integrateBlock(BlockWork* w, BlockRange const& r,
+    int thread, BlockScratch& s)
+{
+  BlockRule& rule = w->rules[r.type];
+  MeshEntity* const* elements = &(w->elements[r.type][r.first]);
+  int n = r.count;
+  int nen = rule.nodes;
+  int np = rule.points;
+  /* gather the coordinates so that each node component
+     of the whole block is contiguous */
+  s.element.resize(nen * 3);
+  s.x.resize(nen * 3 * n);
+  for (int i = 0; i < n; ++i)
+  {
+    w->coordinates->getElementData(elements[i], &(s.element[0]));
+    for (int a = 0; a < nen * 3; ++a)
+      s.x[a * n + i] = s.element[a];
+  }
+  s.J.resize(9 * n);
+  s.dV.resize(np * n);
+  for (int p = 0; p < np; ++p)
+  {
+    std::fill(s.J.begin(), s.J.end(), 0.0);
+    for (int a = 0; a < nen; ++a)
+    {
+      Vector3 const& g = rule.gradients[p * nen + a];
+      for (int k = 0; k < rule.dimension; ++k)
+        for (int j = 0; j < 3; ++j)
+        {
+          double gk = g[k];
+          double const* xaj = &(s.x[(a * 3 + j) * n]);
+          double* Jkj = &(s.J[(k * 3 + j) * n]);
+          for (int i = 0; i < n; ++i)
+            Jkj[i] += gk * xaj[i];
+        }
+    }
+    getBlockMeasures(rule.dimension, n, &(s.J[0]), &(s.dV[p * n]));
+  }
+  IntegrationBlock b;
+  b.type = r.type;
+  b.count = n;
+  b.points = np;
+  b.elements = elements;
+  b.params = &(rule.params[0]);
+  b.weights = &(rule.weights[0]);
+  b.dV = &(s.dV[0]);
+  w->integrator->atBlock(b, thread);
+}
+
+/* blocks are about the same size, so each
+   worker takes every threads-th one */
+static void runBlocks(int thread, void* arg)
+{
+  BlockWork* w = static_cast<BlockWork*>(arg);
+  BlockScratch s;
+  for (size_t i = thread; i < w->blocks.size(); i += w->threads)
+    integrateBlock(w, w->blocks[i], thread, s);
+}
+
+static void setupRule(Mesh* m, int type, int order, BlockRule& rule)
+{
+  Integration const* in = getIntegration(type)->getAccurate(order);
+  if (!in)
+    fail("BlockIntegrator: no integration rule of that order");
+  EntityShape* es = m->getShape()->getEntityShape(type);
+  rule.dimension = Mesh::typeDimension[type];
+  rule.points = in->countPoints();
+  rule.nodes = es->countNodes();
+  rule.gradients.resize(rule.points * rule.nodes);
+  NewArray<Vector3> g;
+  for (int p = 0; p < rule.points; ++p)
+  {
+    IntegrationPoint const* ip = in->getPoint(p);
+    rule.params.push_back(ip->param);
+    rule.weights.push_back(ip->weight);
+    es->getLocalGradients(ip->param, g);
+    for (int a = 0; a < rule.nodes; ++a)
+      rule.gradients[p * rule.nodes + a] = g[a];
+  }
+}
+
+void BlockIntegrator::process(Mesh* m)
+{
+  std::vector<MeshEntity*> elements[Mesh::TYPES];
+  MeshEntity* e;
+  MeshIterator* it = m->begin(m->getDimension());
+  while ((e = m->iterate(it)))
+    if (m->isOwned(e))
+      elements[m->getType(e)].push_back(e);
+  m->end(it);
+  BlockRule rules[Mesh::TYPES];
+  BlockWork w;
+  w.integrator = this;
+  w.coordinates = m->getCoordinateField()->getData();
+  w.elements = elements;
+  w.rules = rules;
+  for (int t = 0; t < Mesh::TYPES; ++t)
+  {
+    if (elements[t].empty())
+      continue;
+    setupRule(m, t, order, rules[t]);
+    for (size_t i = 0; i < elements[t].size(); i += BLOCK_SIZE)
+    {
+      BlockRange r;
+      r.type = t;
+      r.first = i;
+      r.count = std::min(elements[t].size() - i, size_t(BLOCK_SIZE));
+      w.blocks.push_back(r);
+    }
+  }
+  w.threads = threads;
+  this->inProcess();
+  PCU_Work_Run(threads, runBlocks, &w);
+  this->parallelReduce();
+}
+
 class Measurer : public Integrator
 {
   public:
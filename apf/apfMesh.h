@@ -16,6 +16,7 @@
 #include <set>
 #include "apfVector.h"
 #include "apfDynamicArray.h"
+#include "apfFlatSet.h"
 
 struct gmi_model;
 
@@ -37,10 +38,13 @@ class ModelEntity;
 
 /** \brief Remote copy container.
   \details the key is the part id, the value
-  is the on-part pointer to the remote copy */
-typedef std::map<int,MeshEntity*> Copies;
-/** \brief Set of unique part ids */
-typedef std::set<int> Parts;
+  is the on-part pointer to the remote copy.
+  This is a sorted array that only allocates
+  for entities with many copies. */
+typedef FlatMap<int,MeshEntity*> Copies;
+/** \brief Set of unique part ids
+  \details like apf::Copies, this is a sorted array */
+typedef FlatSet<int> Parts;
 /** \brief Set of adjacent mesh entities
   \details see also apf::Downward and apf::Up */
 typedef DynamicArray<MeshEntity*> Adjacent;
@@ -300,6 +304,15 @@ class Mesh
       \returns an estimate of how many bytes are needed
       to store an entity of (type) */
     virtual double getElementBytes(int) {return 1.0;}
+    /** \brief true if entities have dense per-dimension indices
+      \details when this is true, getDenseIndex maps the entities
+      of each dimension one-to-one onto [0, count(d)) in
+      iteration order. frozen fields use it to address
+      their arrays directly. */
+    virtual bool hasDenseIndices() {return false;}
+    /** \brief get the dense per-dimension index of an entity
+      \details only valid while hasDenseIndices returns true */
+    virtual long getDenseIndex(MeshEntity*) {return -1;}
     /** \brief associate a field with this mesh
       \details most users don't need this, functions in apf.h
                automatically call it */
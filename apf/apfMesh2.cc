@@ -20,6 +20,15 @@ MeshEntity* Mesh2::createVertex(ModelEntity* c, Vector3 const& point,
   return v;
 }
 
+bool Mesh2::reserveThreads(int, int const*)
+{
+  return false;
+}
+
+void Mesh2::commitThreads()
+{
+}
+
 void displaceMesh(Mesh2* m, Field* d, double factor)
 {
   m->getCoordinateField()->axpy(factor,d);
@@ -105,12 +114,11 @@ static void intersect(
     Parts& a,
     Parts const& b)
 {
-  for (Parts::iterator it = a.begin(); it != a.end();) {
-    if ( ! b.count(*it))
-      a.erase(*(it++));
-    else
-      ++it;
-  }
+  Parts c;
+  APF_ITERATE(Parts, a, it)
+    if (b.count(*it))
+      c.insert(*it);
+  a = c;
 }
 
 static void getCandidateParts(Mesh* m, MeshEntity* e, Parts& parts)
@@ -106,6 +106,25 @@ class Mesh2 : public Mesh
   mesh modifications so that all structures are properly updated before
   using the mesh any further. */
     virtual void acceptChanges() = 0;
+/** \brief let several threads create and destroy entities
+  \details normally only one thread may modify the mesh.
+  Implementations that support threads set aside room for each
+  of \a nthreads workers of PCU_Work_Run to create up to
+  counts[type] entities of each apf::Mesh::Type.
+  Until apf::Mesh2::commitThreads, createEntity and destroy
+  use the room of the calling worker (see PCU_Work_Thread),
+  and new entities reside only on this part.
+  Threads must not create or destroy entities adjacent to the
+  same entity at the same time (see apf::colorByVertices),
+  and they must not change residence or remote copies.
+  Running out of room is a fatal error.
+  \returns false if this mesh can only be modified by one thread,
+  which is the default */
+    virtual bool reserveThreads(int nthreads, int const* counts);
+/** \brief end threaded modification started by reserveThreads
+  \details afterwards entity counts are correct again and
+  unused room is reused by later creations. */
+    virtual void commitThreads();
 };
 
 /** \brief APF's migration function, works on apf::Mesh2
@@ -126,6 +145,15 @@ void migrateSilent(Mesh2* m, Migration* plan);
   be performed as several consecutive migrations. */
 void setMigrationLimit(size_t maxElements);
 
+/** \brief set a memory budget for each round of limited migration
+  \details when this is positive, apf::migrate measures the memory
+  used by each round of a limited migration (see apf::setMigrationLimit)
+  and resizes the following rounds so that their growth in memory
+  stays near \a megabytes per process.
+  The migration limit is then only the size of the first round.
+  Setting zero restores rounds of fixed size. */
+void setMigrationMemory(double megabytes);
+
 class Field;
 
 /** \brief add a field (times a factor) to the mesh coordinates
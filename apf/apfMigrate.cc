@@ -9,6 +9,7 @@
 #include "apfMesh2.h"
 #include "apfCavityOp.h"
 #include "apf.h"
+#include <algorithm>
 
 namespace apf {
 
@@ -354,76 +355,150 @@ static MeshEntity* unpackNonVertex(
   return m->createEntity(type,c,down);
 }
 
+static void getTagData(Mesh2* m, MeshEntity* e, MeshTag* t, double* d)
+{
+  m->getDoubleTag(e,t,d);
+}
+
+static void getTagData(Mesh2* m, MeshEntity* e, MeshTag* t, int* d)
+{
+  m->getIntTag(e,t,d);
+}
+
+static void getTagData(Mesh2* m, MeshEntity* e, MeshTag* t, long* d)
+{
+  m->getLongTag(e,t,d);
+}
+
+static void setTagData(Mesh2* m, MeshEntity* e, MeshTag* t, double* d)
+{
+  m->setDoubleTag(e,t,d);
+}
+
+static void setTagData(Mesh2* m, MeshEntity* e, MeshTag* t, int* d)
+{
+  m->setIntTag(e,t,d);
+}
+
+static void setTagData(Mesh2* m, MeshEntity* e, MeshTag* t, long* d)
+{
+  m->setLongTag(e,t,d);
+}
+
+typedef std::vector<unsigned char> Bitmap;
+
+static bool hasBit(Bitmap& bits, size_t i)
+{
+  return bits[i / 8] & (1 << (i % 8));
+}
+
+/* the values of one tag on all the entities in a message,
+   gathered into one contiguous column straight in the buffers */
+template <class T>
+static void packTagColumn(
+    Mesh2* m,
+    int to,
+    EntityVector& entities,
+    MeshTag* tag,
+    Bitmap& present,
+    size_t count)
+{
+  size_t size = m->getTagSize(tag);
+  T* column = static_cast<T*>(
+      PCU_Comm_Reserve(to, count * size * sizeof(T)));
+  size_t j = 0;
+  for (size_t i=0; i < entities.size(); ++i)
+    if (hasBit(present,i))
+      getTagData(m,entities[i],tag,column + (j++) * size);
+}
+
+template <class T>
+static void unpackTagColumn(
+    Mesh2* m,
+    MeshEntity** entities,
+    size_t n,
+    MeshTag* tag,
+    Bitmap& present,
+    size_t count)
+{
+  size_t size = m->getTagSize(tag);
+  T* column = static_cast<T*>(
+      PCU_Comm_Extract(count * size * sizeof(T)));
+  size_t j = 0;
+  for (size_t i=0; i < n; ++i)
+    if (hasBit(present,i))
+      setTagData(m,entities[i],tag,column + (j++) * size);
+}
+
+/* tags are sent one at a time for all entities going to a part,
+   as the number of tagged entities, a presence bitmap
+   (omitted if all or none are tagged) and the column of values. */
 static void packTags(
     Mesh2* m,
     int to,
-    MeshEntity* e,
+    EntityVector& entities,
     DynamicArray<MeshTag*>& tags)
 {
-  size_t total = tags.getSize();
-  size_t n = 0;
-  for (size_t i=0; i < total; ++i)
-    if (m->hasTag(e,tags[i]))
-      ++n;
-  PCU_COMM_PACK(to,n);
-  for (size_t i=0; i < total; ++i)
+  size_t n = entities.size();
+  Bitmap present((n + 7) / 8);
+  for (size_t t=0; t < tags.getSize(); ++t)
   {
-    MeshTag* tag = tags[i];
-    if (m->hasTag(e,tag))
-    {
-      PCU_COMM_PACK(to,i);
-      int type = m->getTagType(tag);
-      int size = m->getTagSize(tag);
-      if (type == Mesh2::DOUBLE)
-      {
-        DynamicArray<double> d(size);
-        m->getDoubleTag(e,tag,&(d[0]));
-        PCU_Comm_Pack(to,&(d[0]),size*sizeof(double));
-      }
-      if (type == Mesh2::INT)
+    MeshTag* tag = tags[t];
+    std::fill(present.begin(), present.end(), 0);
+    size_t count = 0;
+    for (size_t i=0; i < n; ++i)
+      if (m->hasTag(entities[i],tag))
       {
-        DynamicArray<int> d(size);
-        m->getIntTag(e,tag,&(d[0]));
-        PCU_Comm_Pack(to,&(d[0]),size*sizeof(int));
+        present[i / 8] |= (1 << (i % 8));
+        ++count;
       }
-    }
+    PCU_COMM_PACK(to,count);
+    if ( ! count)
+      continue;
+    if (count < n)
+      PCU_Comm_Pack(to,&(present[0]),present.size());
+    int type = m->getTagType(tag);
+    if (type == Mesh2::DOUBLE)
+      packTagColumn<double>(m,to,entities,tag,present,count);
+    if (type == Mesh2::INT)
+      packTagColumn<int>(m,to,entities,tag,present,count);
+    if (type == Mesh2::LONG)
+      packTagColumn<long>(m,to,entities,tag,present,count);
   }
 }
 
 static void unpackTags(
     Mesh2* m,
-    MeshEntity* e,
+    MeshEntity** entities,
+    size_t n,
     DynamicArray<MeshTag*>& tags)
 {
-  size_t n;
-  PCU_COMM_UNPACK(n);
-  for (size_t t=0; t < n; ++t)
+  Bitmap present((n + 7) / 8);
+  for (size_t t=0; t < tags.getSize(); ++t)
   {
-    size_t i;
-    PCU_COMM_UNPACK(i);
-    MeshTag* tag = tags[i];
+    MeshTag* tag = tags[t];
+    size_t count;
+    PCU_COMM_UNPACK(count);
+    if ( ! count)
+      continue;
+    if (count < n)
+      PCU_Comm_Unpack(&(present[0]),present.size());
+    else
+      std::fill(present.begin(), present.end(), 0xFF);
     int type = m->getTagType(tag);
-    int size = m->getTagSize(tag);
     if (type == Mesh2::DOUBLE)
-    {
-      DynamicArray<double> d(size);
-      PCU_Comm_Unpack(&(d[0]),size*sizeof(double));
-      m->setDoubleTag(e,tag,&(d[0]));
-    }
+      unpackTagColumn<double>(m,entities,n,tag,present,count);
     if (type == Mesh2::INT)
-    {
-      DynamicArray<int> d(size);
-      PCU_Comm_Unpack(&(d[0]),size*sizeof(int));
-      m->setIntTag(e,tag,&(d[0]));
-    }
+      unpackTagColumn<int>(m,entities,n,tag,present,count);
+    if (type == Mesh2::LONG)
+      unpackTagColumn<long>(m,entities,n,tag,present,count);
   }
 }
 
 static void packEntity(
     Mesh2* m,
     int to,
-    MeshEntity* e,
-    DynamicArray<MeshTag*>& tags)
+    MeshEntity* e)
 {
   int type = m->getType(e);
   PCU_COMM_PACK(to,type);
@@ -432,12 +507,10 @@ static void packEntity(
     packVertex(m,to,e);
   else
     packNonVertex(m,to,e);
-  packTags(m,to,e,tags);
 }
 
 static MeshEntity* unpackEntity(
-    Mesh2* m,
-    DynamicArray<MeshTag*>& tags)
+    Mesh2* m)
 {
   int from = PCU_Comm_Sender();
   int type;
@@ -452,7 +525,6 @@ static MeshEntity* unpackEntity(
   else
     entity = unpackNonVertex(m,type,c);
   m->setResidence(entity,residence);
-  unpackTags(m,entity,tags);
   Copies remotes;
   /* temporarily store the sender as
      a remote copy */
@@ -460,11 +532,16 @@ static MeshEntity* unpackEntity(
   return entity;
 }
 
+typedef std::map<int,EntityVector> EntitiesByPart;
+
+/* each message is the entities followed by
+   their tags, see packTags */
 static void sendEntities(
     Mesh2* m,
     EntityVector& senders,
     DynamicArray<MeshTag*>& tags)
 {
+  EntitiesByPart outgoing;
   APF_ITERATE(EntityVector,senders,it)
   {
     MeshEntity* entity = *it;
@@ -475,7 +552,17 @@ static void sendEntities(
     Parts sendTo;
     split(remotes,residence,sendTo);
     APF_ITERATE(Parts,sendTo,sit)
-      packEntity(m,*sit,entity,tags);
+      outgoing[*sit].push_back(entity);
+  }
+  APF_ITERATE(EntitiesByPart,outgoing,it)
+  {
+    int to = it->first;
+    EntityVector& entities = it->second;
+    size_t n = entities.size();
+    PCU_COMM_PACK(to,n);
+    for (size_t i=0; i < n; ++i)
+      packEntity(m,to,entities[i]);
+    packTags(m,to,entities,tags);
   }
 }
 
@@ -485,8 +572,16 @@ static void receiveEntities(
     EntityVector& received)
 {
   received.reserve(1024);
-  while (PCU_Comm_Receive())
-    received.push_back(unpackEntity(m,tags));
+  while (PCU_Comm_Listen())
+  {
+    size_t n;
+    PCU_COMM_UNPACK(n);
+    size_t first = received.size();
+    for (size_t i=0; i < n; ++i)
+      received.push_back(unpackEntity(m));
+    if (n)
+      unpackTags(m,&(received[first]),n,tags);
+  }
 }
 
 static void echoRemotes(
@@ -784,9 +879,15 @@ static void deleteOldEntities(
     }
 }
 
-/* this is the main migration routine */
-static void migrate1(Mesh2* m, Migration* plan)
+/* this is the main migration routine.
+   if growth is given, it receives the memory (in megabytes)
+   added by the new entities before the old ones are deleted,
+   which is roughly the peak of the migration */
+static void migrate1(Mesh2* m, Migration* plan, double* growth = 0)
 {
+  double before = 0;
+  if (growth)
+    before = PCU_GetMem();
   EntityVector affected[4];
   getAffected(m,plan,affected);
   EntityVector senders[4];
@@ -795,18 +896,40 @@ static void migrate1(Mesh2* m, Migration* plan)
   updateResidences(m,plan,affected);
   delete plan;
   moveEntities(m,senders);
+  if (growth)
+    *growth = PCU_GetMem() - before;
   updateMatching(m,affected,senders);
   deleteOldEntities(m,affected);
   m->acceptChanges();
 }
 
 static size_t migrationLimit = 1000*1000*1000;
+static double migrationMemory = 0;
 
 void setMigrationLimit(size_t maxElements)
 {
   migrationLimit = maxElements;
 }
 
+void setMigrationMemory(double megabytes)
+{
+  migrationMemory = megabytes;
+}
+
+/* chooses the next round's size from the largest memory
+   growth and the largest round size seen on any part,
+   growing by at most a factor of two per round since
+   the estimate comes from a single sample */
+static size_t getNextLimit(size_t limit, double growth, double send)
+{
+  if (migrationMemory <= 0 || growth <= 0 || send <= 0)
+    return limit;
+  double perElement = growth / send;
+  double next = migrationMemory / perElement;
+  next = std::min(next, 2.0 * limit);
+  return std::max(static_cast<size_t>(next), static_cast<size_t>(1));
+}
+
 /* this implements partial migrations
    to limit peak memory use */
 static void migrate2(Mesh2* m, Migration* plan)
@@ -821,14 +944,26 @@ static void migrate2(Mesh2* m, Migration* plan)
   }
   delete plan;
   size_t sent = 0;
-  while (PCU_Or(sent < tmp.size()))
+  size_t limit = migrationLimit;
+  bool more = true;
+  while (more)
   {
     plan = new Migration(m);
-    size_t send = std::min(tmp.size() - sent, migrationLimit);
+    size_t send = std::min(tmp.size() - sent, limit);
     for (size_t i = sent; i < sent + send; ++i)
       plan->send(tmp[i].first, tmp[i].second);
-    migrate1(m, plan);
+    double growth;
+    migrate1(m, plan, &growth);
     sent += send;
+    /* one reduction both checks for remaining work
+       and gathers the measurements for the next round */
+    double stats[3];
+    stats[0] = sent < tmp.size();
+    stats[1] = growth;
+    stats[2] = send;
+    PCU_Max_Doubles(stats, 3);
+    more = stats[0] > 0;
+    limit = getNextLimit(limit, stats[1], stats[2]);
   }
 }
 
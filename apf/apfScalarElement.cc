@@ -17,8 +17,9 @@ ScalarElement::ScalarElement(ScalarField* f, VectorElement* e):
 
 void ScalarElement::grad(Vector3 const& local, Vector3& g)
 {
-  NewArray<Vector3> globalGradients;
-  getGlobalGradients(local,globalGradients);
+  NodeBuffer<Vector3,10> globalGradients;
+  globalGradients.allocate(nen);
+  getGlobalGradients(local,&(globalGradients[0]));
   double* nodeValues = getNodeValues();
   g = globalGradients[0] * nodeValues[0];
   for (int i=1; i < nen; ++i)
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2026 Scientific Computation Research Center
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <PCU.h>
+#include "apf.h"
+#include "apfMesh.h"
+#include "apfShape.h"
+#include "apfField.h"
+#include "apfFieldData.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace apf {
+
+/* the shared entities exchanged with one peer,
+   in the order both sides agreed on when the plan was built */
+struct SharingLink
+{
+  int peer;
+  std::vector<MeshEntity*> entities;
+  /* prefix sum of node counts, entities.size()+1 long */
+  std::vector<int> firstNode;
+  int countNodes() const {return firstNode.back();}
+};
+
+class SharingPlan
+{
+  public:
+    Mesh* mesh;
+    FieldShape* shape;
+    /* owned entities, by the peers holding copies */
+    std::vector<SharingLink> owned;
+    /* copies, by the peer owning them */
+    std::vector<SharingLink> copies;
+    /* all peers of both lists, a symmetric graph */
+    std::vector<int> neighbors;
+};
+
+static void addToLink(std::map<int, SharingLink>& links, int peer,
+    MeshEntity* e, int nodes)
+{
+  SharingLink& l = links[peer];
+  if (l.firstNode.empty()) {
+    l.peer = peer;
+    l.firstNode.push_back(0);
+  }
+  l.entities.push_back(e);
+  l.firstNode.push_back(l.firstNode.back() + nodes);
+}
+
+static void flattenLinks(std::map<int, SharingLink>& from,
+    std::vector<SharingLink>& to)
+{
+  to.resize(from.size());
+  size_t i = 0;
+  std::map<int, SharingLink>::iterator it;
+  for (it = from.begin(); it != from.end(); ++it)
+    std::swap(to[i++], it->second);
+}
+
+static SharingLink& findLink(std::vector<SharingLink>& links, int peer)
+{
+  size_t lo = 0;
+  size_t hi = links.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (links[mid].peer < peer)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == links.size() || links[lo].peer != peer)
+    fail("SharingPlan received from an unknown peer");
+  return links[lo];
+}
+
+SharingPlan* makeSharingPlan(Mesh* m, FieldShape* s, Sharing* shr)
+{
+  if (!s)
+    s = m->getShape();
+  if (!shr)
+    shr = getSharing(m);
+  std::map<int, SharingLink> owned;
+  std::map<int, SharingLink> copies;
+  /* owners tell each peer which of its entities they will send,
+     so later messages can carry values alone */
+  PCU_Comm_Begin();
+  for (int d=0; d < 4; ++d)
+  {
+    if ( ! s->hasNodesIn(d))
+      continue;
+    MeshEntity* e;
+    MeshIterator* it = m->begin(d);
+    while ((e = m->iterate(it)))
+    {
+      int nodes = s->countNodesOn(m->getType(e));
+      if (( ! nodes) || ( ! shr->isOwned(e)))
+        continue;
+      CopyArray remotes;
+      shr->getCopies(e, remotes);
+      for (size_t i = 0; i < remotes.getSize(); ++i)
+      {
+        addToLink(owned, remotes[i].peer, e, nodes);
+        PCU_COMM_PACK(remotes[i].peer, remotes[i].entity);
+      }
+    }
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  while (PCU_Comm_Listen())
+  {
+    int peer = PCU_Comm_Sender();
+    while ( ! PCU_Comm_Unpacked())
+    {
+      MeshEntity* e;
+      PCU_COMM_UNPACK(e);
+      addToLink(copies, peer, e, s->countNodesOn(m->getType(e)));
+    }
+  }
+  delete shr;
+  SharingPlan* plan = new SharingPlan();
+  plan->mesh = m;
+  plan->shape = s;
+  flattenLinks(owned, plan->owned);
+  flattenLinks(copies, plan->copies);
+  for (size_t i = 0; i < plan->owned.size(); ++i)
+    plan->neighbors.push_back(plan->owned[i].peer);
+  for (size_t i = 0; i < plan->copies.size(); ++i)
+    plan->neighbors.push_back(plan->copies[i].peer);
+  std::sort(plan->neighbors.begin(), plan->neighbors.end());
+  plan->neighbors.erase(
+      std::unique(plan->neighbors.begin(), plan->neighbors.end()),
+      plan->neighbors.end());
+  return plan;
+}
+
+void destroySharingPlan(SharingPlan* plan)
+{
+  delete plan;
+}
+
+static void checkFields(SharingPlan* plan, Field** fields, int count)
+{
+  for (int i = 0; i < count; ++i)
+    if (fields[i]->getMesh() != plan->mesh ||
+        fields[i]->getShape() != plan->shape)
+      fail("field does not match its SharingPlan");
+}
+
+static int sumComponents(Field** fields, int count)
+{
+  int n = 0;
+  for (int i = 0; i < count; ++i)
+    n += fields[i]->countComponents();
+  return n;
+}
+
+/* the plan knows all of its peers, so its phases use the
+   neighborhood transport of PCU and skip the global
+   termination detection of the default one.
+   any neighbors the caller had set are put back afterward,
+   (saved) holds them and is left empty if there were none */
+static bool beginExchanges(SharingPlan* plan, std::vector<int>& saved)
+{
+  int const* ranks;
+  int count = PCU_Comm_Get_Neighbors(&ranks);
+  if (count >= 0)
+    saved.assign(ranks, ranks + count);
+  std::vector<int>& n = plan->neighbors;
+  PCU_Comm_Set_Neighbors(n.size(), n.empty() ? 0 : &n[0]);
+  return count >= 0;
+}
+
+static void endExchanges(bool hadNeighbors, std::vector<int>& saved)
+{
+  if (hadNeighbors)
+    PCU_Comm_Set_Neighbors(saved.size(), saved.empty() ? 0 : &saved[0]);
+  else
+    PCU_Comm_Clear_Neighbors();
+}
+
+/* messages hold each field's values in turn,
+   entity by entity in link order */
+static void exchange(std::vector<SharingLink>& from,
+    std::vector<SharingLink>& to,
+    Field** fields, int count, bool add)
+{
+  int components = sumComponents(fields, count);
+  PCU_Comm_Begin();
+  for (size_t l = 0; l < from.size(); ++l)
+  {
+    SharingLink& link = from[l];
+    size_t n = link.countNodes() * components;
+    double* values = static_cast<double*>(
+        PCU_Comm_Reserve(link.peer, n * sizeof(double)));
+    for (int f = 0; f < count; ++f)
+    {
+      FieldDataOf<double>* data = fields[f]->getData();
+      int nc = fields[f]->countComponents();
+      for (size_t i = 0; i < link.entities.size(); ++i)
+        data->get(link.entities[i], values + link.firstNode[i] * nc);
+      values += link.countNodes() * nc;
+    }
+  }
+  PCU_Comm_Send();
+  std::vector<double> sum;
+  while (PCU_Comm_Listen())
+  {
+    SharingLink& link = findLink(to, PCU_Comm_Sender());
+    size_t n = link.countNodes() * components;
+    double const* values = static_cast<double*>(
+        PCU_Comm_Extract(n * sizeof(double)));
+    for (int f = 0; f < count; ++f)
+    {
+      FieldDataOf<double>* data = fields[f]->getData();
+      int nc = fields[f]->countComponents();
+      for (size_t i = 0; i < link.entities.size(); ++i)
+      {
+        MeshEntity* e = link.entities[i];
+        double const* in = values + link.firstNode[i] * nc;
+        if ( ! add) {
+          data->set(e, in);
+          continue;
+        }
+        int nv = (link.firstNode[i + 1] - link.firstNode[i]) * nc;
+        sum.resize(nv);
+        data->get(e, &sum[0]);
+        for (int j = 0; j < nv; ++j)
+          sum[j] += in[j];
+        data->set(e, &sum[0]);
+      }
+      values += link.countNodes() * nc;
+    }
+  }
+}
+
+void synchronize(SharingPlan* plan, Field** fields, int count)
+{
+  checkFields(plan, fields, count);
+  std::vector<int> saved;
+  bool had = beginExchanges(plan, saved);
+  exchange(plan->owned, plan->copies, fields, count, false);
+  endExchanges(had, saved);
+}
+
+void synchronize(SharingPlan* plan, Field* f)
+{
+  synchronize(plan, &f, 1);
+}
+
+void accumulate(SharingPlan* plan, Field** fields, int count)
+{
+  checkFields(plan, fields, count);
+  /* copies send their values to the owner, which adds them up
+     and then broadcasts the sums back out */
+  std::vector<int> saved;
+  bool had = beginExchanges(plan, saved);
+  exchange(plan->copies, plan->owned, fields, count, true);
+  exchange(plan->owned, plan->copies, fields, count, false);
+  endExchanges(had, saved);
+}
+
+void accumulate(SharingPlan* plan, Field* f)
+{
+  accumulate(plan, &f, 1);
+}
+
+}
@@ -22,8 +22,9 @@ VectorElement::VectorElement(VectorField* f, VectorElement* p):
 
 double VectorElement::div(Vector3 const& xi)
 {
-  NewArray<Vector3> globalGradients;
-  getGlobalGradients(xi,globalGradients);
+  NodeBuffer<Vector3,10> globalGradients;
+  globalGradients.allocate(nen);
+  getGlobalGradients(xi,&(globalGradients[0]));
   Vector3* nodeValues = getNodeValues();
   double d = globalGradients[0] * nodeValues[0];
   for (int i=1; i < nen; ++i)
@@ -33,8 +34,9 @@ double VectorElement::div(Vector3 const& xi)
 
 void VectorElement::curl(Vector3 const& xi, Vector3& c)
 {
-  NewArray<Vector3> globalGradients;
-  getGlobalGradients(xi,globalGradients);
+  NodeBuffer<Vector3,10> globalGradients;
+  globalGradients.allocate(nen);
+  getGlobalGradients(xi,&(globalGradients[0]));
   Vector3* nodeValues = getNodeValues();
   c = cross(globalGradients[0],nodeValues[0]);
   for (int i=1; i < nen; ++i)
@@ -44,6 +46,13 @@ void VectorElement::curl(Vector3 const& xi, Vector3& c)
 void VectorElement::gradHelper(
     NewArray<Vector3>& nodalGradients,
     Matrix3x3& g)
+{
+  gradHelper(&(nodalGradients[0]),g);
+}
+
+void VectorElement::gradHelper(
+    Vector3 const* nodalGradients,
+    Matrix3x3& g)
 {
   Vector3* nodeValues = getNodeValues();
   g = tensorProduct(nodalGradients[0],nodeValues[0]);
@@ -53,16 +62,16 @@ void VectorElement::gradHelper(
 
 void VectorElement::grad(Vector3 const& xi, Matrix3x3& g)
 {
-  NewArray<Vector3> globalGradients;
-  getGlobalGradients(xi,globalGradients);
-  gradHelper(globalGradients,g);
+  NodeBuffer<Vector3,10> globalGradients;
+  globalGradients.allocate(nen);
+  getGlobalGradients(xi,&(globalGradients[0]));
+  gradHelper(&(globalGradients[0]),g);
 }
 
 void VectorElement::getJacobian(Vector3 const& xi, Matrix3x3& J)
 {
-  NewArray<Vector3> localGradients;
-  this->shape->getLocalGradients(xi,localGradients);
-  gradHelper(localGradients,J);
+  NewArray<Vector3> buffer;
+  gradHelper(getLocalGradientsAt(xi,buffer),J);
 }
 
 double getJacobianDeterminant(Matrix3x3 const& J, int dimension)
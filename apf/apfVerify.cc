@@ -7,17 +7,14 @@
 namespace apf {
 
 static void intersect(
-    std::set<int>& a,
-    std::set<int> const& b)
+    Parts& a,
+    Parts const& b)
 {
-  for (std::set<int>::iterator it = a.begin();
-      it != a.end();)
-  {
-    if ( ! b.count(*it))
-      a.erase(*(it++));
-    else
-      ++it;
-  }
+  Parts c;
+  APF_ITERATE(Parts, a, it)
+    if (b.count(*it))
+      c.insert(*it);
+  a = c;
 }
 
 static Parts getCandidateParts(Mesh* m, MeshEntity* e)
@@ -13,21 +13,25 @@
 #include "apfFieldData.h"
 #include <sstream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#ifdef APF_ZLIB
+#include <zlib.h>
+#endif
 
 namespace apf {
 
+static const char* typeNames[3] = {"Float64","Int32","Int64"};
+
 static void describeArray(
     std::ostream& file,
     const char* name,
     int type,
     int size)
 {
-  file << "type=\"";
-  const char* typeNames[3] = {"Float64","Int32","Int64"};
-  file << typeNames[type];
+  file << "type=\"" << typeNames[type];
   file << "\" Name=\"" << name;
-  file << "\" NumberOfComponents=\"" << size;
-  file << "\" format=\"ascii\"";
+  file << "\" NumberOfComponents=\"" << size << "\"";
 }
 
 static void writePDataArray(
@@ -195,81 +199,229 @@ static void writePvtuFile(const char* prefix, Mesh* m)
   file << "</VTKFile>\n";
 }
 
-static void writeDataHeader(std::ostream& file, const char* name, int type, int size)
+/* the binary formats prefix each array with its size in bytes,
+   or with a table of compressed block sizes, as this type */
+typedef unsigned long long VtkHeader;
+
+/* uncompressed size of each zlib block, as in vtkZLibDataCompressor */
+static size_t const vtkBlockSize = 1 << 15;
+
+struct VtkOutput
 {
-  file << "<DataArray ";
-  describeArray(file,name,type,size);
-  file << ">\n";
-}
+  VtkOutput(std::ostream& f, VtkFormat fmt, bool z):
+    file(f),
+    format(fmt),
+    compress(z)
+  {
+  }
+  std::ostream& file;
+  VtkFormat format;
+  bool compress;
+  /* everything after the '_' of the AppendedData element */
+  std::string appended;
+};
 
+static const char* getTypeName(double) {return "Float64";}
+static const char* getTypeName(int) {return "Int32";}
+static const char* getTypeName(long) {return "Int64";}
+static const char* getTypeName(unsigned char) {return "UInt8";}
+
+/* keeps UInt8 values from being printed as characters */
 template <class T>
-static void writeNodalField(std::ostream& file, FieldBase* f, DynamicArray<Node>& nodes)
+static T toText(T x) {return x;}
+static int toText(unsigned char x) {return x;}
+
+static bool isLittleEndian()
 {
-  int nc = f->countComponents();
-  writeDataHeader(file,f->getName(),f->getScalarType(),nc);
-  NewArray<T> nodalData(nc);
-  FieldDataOf<T>* data = static_cast<FieldDataOf<T>*>(f->getData());
-  for (size_t i=0; i < nodes.getSize(); ++i)
+  int one = 1;
+  return *(reinterpret_cast<char*>(&one));
+}
+
+static void appendHeader(std::string& s, VtkHeader h)
+{
+  s.append(reinterpret_cast<char*>(&h), sizeof(h));
+}
+
+static void encodeBase64(std::string const& in, std::ostream& out)
+{
+  static char const table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned char const* p =
+    reinterpret_cast<unsigned char const*>(in.data());
+  size_t n = in.size();
+  std::string s;
+  s.reserve((n + 2) / 3 * 4);
+  size_t i;
+  for (i = 0; i + 2 < n; i += 3)
   {
-    data->getNodeComponents(nodes[i].entity,nodes[i].node,&(nodalData[0]));
-    for (int j=0; j < nc; ++j)
-      file << nodalData[j] << ' ';
-    file << '\n';
+    unsigned x = (p[i] << 16) | (p[i + 1] << 8) | p[i + 2];
+    s += table[(x >> 18) & 63];
+    s += table[(x >> 12) & 63];
+    s += table[(x >> 6) & 63];
+    s += table[x & 63];
   }
-  file << "</DataArray>\n"; 
+  if (i < n)
+  {
+    unsigned x = p[i] << 16;
+    if (i + 1 < n)
+      x |= p[i + 1] << 8;
+    s += table[(x >> 18) & 63];
+    s += table[(x >> 12) & 63];
+    s += (i + 1 < n) ? table[(x >> 6) & 63] : '=';
+    s += '=';
+  }
+  out << s;
 }
 
-static void writePoints(std::ostream& file, Mesh* m, DynamicArray<Node>& nodes)
+static int vtkThreads = 1;
+
+void setVtkThreads(int n)
 {
-  file << "<Points>\n";
-  writeNodalField<double>(file,m->getCoordinateField(),nodes);
-  file << "</Points>\n"; 
+  vtkThreads = n;
 }
 
-static int countElementNodes(Numbering* n, MeshEntity* e)
+#ifdef APF_ZLIB
+/* the blocks of one array, compressed by PCU_Work_Run workers */
+struct ZlibBlocks
 {
-  return n->getShape()->getEntityShape(n->getMesh()->getType(e))->countNodes();
+  char const* data;
+  size_t size;
+  int threads;
+  std::vector<std::string> zipped;
+  std::vector<int> ok;
+};
+
+static void compressBlocks(int thread, void* p)
+{
+  ZlibBlocks* z = static_cast<ZlibBlocks*>(p);
+  for (size_t i = thread; i < z->zipped.size(); i += z->threads)
+  {
+    size_t rawSize = std::min(vtkBlockSize, z->size - i * vtkBlockSize);
+    uLongf zipSize = compressBound(rawSize);
+    std::string& zipped = z->zipped[i];
+    zipped.resize(zipSize);
+    z->ok[i] = compress2(reinterpret_cast<Bytef*>(&zipped[0]), &zipSize,
+        reinterpret_cast<Bytef const*>(z->data + i * vtkBlockSize),
+        rawSize, Z_BEST_SPEED) == Z_OK;
+    zipped.resize(zipSize);
+  }
 }
+#endif
 
-static void writeConnectivity(std::ostream& file, Numbering* n)
+/* fills the header and body of one array in the layout that
+   vtkXMLDataParser expects, see the VTK file formats document */
+static void encodeArray(char const* data, size_t size, bool compress,
+    std::string& header, std::string& body)
 {
-  file << "<DataArray type=\"Int32\" Name=\"connectivity\" format=\"ascii\">\n";
-  Mesh* m = n->getMesh();
-  MeshEntity* e;
-  MeshIterator* elements = m->begin(m->getDimension());
-  while ((e = m->iterate(elements)))
+  if (!compress)
   {
-    int nen = countElementNodes(n,e);
-    NewArray<int> numbers(nen);
-    getElementNumbers(n,e,numbers);
-    for (int i=0; i < nen; ++i)
-      file << numbers[i] << ' ';
-    file << '\n';
+    appendHeader(header, size);
+    body.append(data, size);
+    return;
   }
-  m->end(elements);
-  file << "</DataArray>\n";
+#ifdef APF_ZLIB
+  size_t nblocks = (size + vtkBlockSize - 1) / vtkBlockSize;
+  appendHeader(header, nblocks);
+  appendHeader(header, vtkBlockSize);
+  appendHeader(header, nblocks ? size - (nblocks - 1) * vtkBlockSize : 0);
+  ZlibBlocks z;
+  z.data = data;
+  z.size = size;
+  z.threads = std::min(size_t(vtkThreads), nblocks);
+  z.zipped.resize(nblocks);
+  z.ok.resize(nblocks);
+  if (z.threads)
+    PCU_Work_Run(z.threads, compressBlocks, &z);
+  for (size_t i = 0; i < nblocks; ++i)
+  {
+    if (!z.ok[i])
+      fail("zlib compression of a VTK array failed");
+    appendHeader(header, z.zipped[i].size());
+    body += z.zipped[i];
+  }
+#else
+  (void)data;
+  (void)size;
+  (void)header;
+  (void)body;
+  fail("recompile with APF_ZLIB=ON to compress VTK files");
+#endif
 }
 
-static void writeOffsets(std::ostream& file, Numbering* n)
+template <class T>
+static void writeDataArray(VtkOutput& out, const char* name, int nc,
+    std::vector<T> const& values)
 {
-  file << "<DataArray type=\"Int32\" Name=\"offsets\" format=\"ascii\">\n";
-  Mesh* m = n->getMesh();
-  MeshEntity* e;
-  int o=0;
-  MeshIterator* elements = m->begin(m->getDimension());
-  while ((e = m->iterate(elements)))
+  static const char* formatNames[3] = {"ascii","binary","appended"};
+  std::ostream& file = out.file;
+  file << "<DataArray type=\"" << getTypeName(T());
+  file << "\" Name=\"" << name;
+  file << "\" NumberOfComponents=\"" << nc;
+  file << "\" format=\"" << formatNames[out.format] << "\"";
+  if (out.format == VTK_ASCII)
   {
-    o += countElementNodes(n,e);
-    file << o << '\n';
+    file << ">\n";
+    for (size_t i = 0; i < values.size(); i += nc)
+    {
+      for (int j = 0; j < nc; ++j)
+        file << toText(values[i + j]) << ' ';
+      file << '\n';
+    }
+    file << "</DataArray>\n";
+    return;
   }
-  m->end(elements);
-  file << "</DataArray>\n";
+  size_t size = values.size() * sizeof(T);
+  char const* data = size ? reinterpret_cast<char const*>(&values[0]) : 0;
+  std::string header;
+  std::string body;
+  encodeArray(data, size, out.compress, header, body);
+  if (out.format == VTK_APPENDED)
+  {
+    file << " offset=\"" << out.appended.size() << "\"/>\n";
+    out.appended += header;
+    out.appended += body;
+    return;
+  }
+  file << ">\n";
+  /* an uncompressed array is encoded as one stream,
+     compressed ones encode the header separately */
+  if (out.compress)
+    encodeBase64(header, file);
+  else
+    body.insert(0, header);
+  encodeBase64(body, file);
+  file << "\n</DataArray>\n";
 }
 
-static void writeTypes(std::ostream& file, Mesh* m)
+template <class T>
+static void writeNodalField(VtkOutput& out, FieldBase* f,
+    DynamicArray<Node>& nodes)
 {
-  file << "<DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">\n";
-  MeshEntity* e;
+  int nc = f->countComponents();
+  std::vector<T> values(nodes.getSize() * nc);
+  FieldDataOf<T>* data = static_cast<FieldDataOf<T>*>(f->getData());
+  for (size_t i=0; i < nodes.getSize(); ++i)
+    data->getNodeComponents(nodes[i].entity,nodes[i].node,&(values[i*nc]));
+  writeDataArray(out,f->getName(),nc,values);
+}
+
+static void writePoints(VtkOutput& out, Mesh* m, DynamicArray<Node>& nodes)
+{
+  out.file << "<Points>\n";
+  writeNodalField<double>(out,m->getCoordinateField(),nodes);
+  out.file << "</Points>\n";
+}
+
+static int countElementNodes(Numbering* n, MeshEntity* e)
+{
+  return n->getShape()->getEntityShape(n->getMesh()->getType(e))->countNodes();
+}
+
+/* connectivity, offsets and types are filled in one pass
+   over the elements */
+static void writeCells(VtkOutput& out, Numbering* n)
+{
+  Mesh* m = n->getMesh();
   int order = m->getShape()->getOrder();
   static int vtkTypes[Mesh::TYPES][2] =
   /* order
@@ -284,157 +436,169 @@ static void writeTypes(std::ostream& file, Mesh* m)
    ,{13,-1}//prism
    ,{14,-1}//pyramid
    };
+  size_t ne = m->count(m->getDimension());
+  std::vector<int> connectivity;
+  std::vector<int> offsets(ne);
+  std::vector<unsigned char> types(ne);
+  NewArray<int> numbers;
+  MeshEntity* e;
+  size_t i = 0;
   MeshIterator* elements = m->begin(m->getDimension());
   while ((e = m->iterate(elements)))
-    file << vtkTypes[m->getType(e)][order-1] << '\n';
+  {
+    int nen = countElementNodes(n,e);
+    getElementNumbers(n,e,numbers);
+    connectivity.insert(connectivity.end(), &numbers[0], &numbers[0] + nen);
+    offsets[i] = connectivity.size();
+    types[i] = vtkTypes[m->getType(e)][order-1];
+    ++i;
+  }
   m->end(elements);
-  file << "</DataArray>\n";
-}
-
-static void writeCells(std::ostream& file, Numbering* n)
-{
-  file << "<Cells>\n";
-  writeConnectivity(file,n);
-  writeOffsets(file,n);
-  writeTypes(file,n->getMesh());
-  file << "</Cells>\n"; 
+  out.file << "<Cells>\n";
+  writeDataArray(out,"connectivity",1,connectivity);
+  writeDataArray(out,"offsets",1,offsets);
+  writeDataArray(out,"types",1,types);
+  out.file << "</Cells>\n";
 }
 
-static void writePointData(std::ostream& file, Mesh* m,
+static void writePointData(VtkOutput& out, Mesh* m,
     DynamicArray<Node>& nodes)
 {
-  file << "<PointData>\n";
+  out.file << "<PointData>\n";
   for (int i=0; i < m->countFields(); ++i)
   {
     Field* f = m->getField(i);
     if (getShape(f)== m->getShape())
-      writeNodalField<double>(file,f,nodes);
+      writeNodalField<double>(out,f,nodes);
   }
   for (int i=0; i < m->countNumberings(); ++i)
   {
     Numbering* n = m->getNumbering(i);
     if (getShape(n)== m->getShape())
-      writeNodalField<int>(file,n,nodes);
+      writeNodalField<int>(out,n,nodes);
   }
   for (int i=0; i < m->countGlobalNumberings(); ++i)
   {
     GlobalNumbering* n = m->getGlobalNumbering(i);
     if (getShape(n)== m->getShape())
-      writeNodalField<long>(file,n,nodes);
+      writeNodalField<long>(out,n,nodes);
   }
-  file << "</PointData>\n";
+  out.file << "</PointData>\n";
 }
 
+/* reads all points of each element at once, then writes
+   one cell array per integration point */
 template <class T>
-class WriteIPField : public FieldOp
-{
-  public:
-    int point;
-    int components;
-    NewArray<T> ipData;
-    FieldDataOf<T>* data;
-    MeshEntity* entity;
-    std::ostream* fp;
-    virtual bool inEntity(MeshEntity* e)
-    {
-      entity = e;
-      return true;
-    }
-    virtual void atNode(int node)
-    {
-      if (node != point)
-        return;
-      data->getNodeComponents(entity,node,&(ipData[0]));
-      for (int i=0; i < components; ++i)
-        (*fp) << ipData[i] << ' ';
-      (*fp) << '\n';
-    }
-    void runOnce(FieldBase* f)
-    {
-      std::string s = getIPName(f,point);
-      components = f->countComponents();
-      writeDataHeader(*fp,s.c_str(),f->getScalarType(),f->countComponents());
-      ipData.allocate(components);
-      data = static_cast<FieldDataOf<T>*>(f->getData());
-      apply(f);
-      (*fp) << "</DataArray>\n"; 
-    }
-    void run(std::ostream& file, FieldBase* f)
-    {
-      fp = &file;
-      int n = countIPs(f);
-      for (point=0; point < n; ++point)
-        runOnce(f);
-    }
-};
+static void writeIPField(VtkOutput& out, FieldBase* f)
+{
+  Mesh* m = f->getMesh();
+  int nc = f->countComponents();
+  int np = countIPs(f);
+  size_t ne = m->count(m->getDimension());
+  std::vector<T> all(ne * np * nc);
+  FieldDataOf<T>* data = static_cast<FieldDataOf<T>*>(f->getData());
+  MeshEntity* e;
+  size_t i = 0;
+  MeshIterator* elements = m->begin(m->getDimension());
+  while ((e = m->iterate(elements)))
+  {
+    if (f->countNodesOn(e) != np)
+      fail("VTK output of IP fields needs a non-mixed mesh");
+    data->get(e,&(all[i * np * nc]));
+    ++i;
+  }
+  m->end(elements);
+  std::vector<T> values(ne * nc);
+  for (int p=0; p < np; ++p)
+  {
+    for (i=0; i < ne; ++i)
+      for (int j=0; j < nc; ++j)
+        values[i * nc + j] = all[(i * np + p) * nc + j];
+    std::string s = getIPName(f,p);
+    writeDataArray(out,s.c_str(),nc,values);
+  }
+}
 
-static void writeCellParts(std::ostream& file, Mesh* m)
+static void writeCellParts(VtkOutput& out, Mesh* m)
 {
-  writeDataHeader(file, "apf_part", apf::Mesh::INT, 1);
-  size_t n = m->count(m->getDimension());
-  int id = m->getId();
-  for (size_t i = 0; i < n; ++i)
-    file << id << '\n';
-  file << "</DataArray>\n";
+  std::vector<int> parts(m->count(m->getDimension()), m->getId());
+  writeDataArray(out,"apf_part",1,parts);
 }
 
-static void writeCellData(std::ostream& file, Mesh* m)
+static void writeCellData(VtkOutput& out, Mesh* m)
 {
-  file << "<CellData>\n";
-  WriteIPField<double> wd;
+  out.file << "<CellData>\n";
   for (int i=0; i < m->countFields(); ++i)
   {
     Field* f = m->getField(i);
     if (isIPField(f))
-      wd.run(file,f);
+      writeIPField<double>(out,f);
   }
-  WriteIPField<int> wi;
   for (int i=0; i < m->countNumberings(); ++i)
   {
     Numbering* n = m->getNumbering(i);
     if (isIPField(n))
-      wi.run(file,n);
+      writeIPField<int>(out,n);
   }
-  WriteIPField<long> wl;
   for (int i=0; i < m->countGlobalNumberings(); ++i)
   {
     GlobalNumbering* n = m->getGlobalNumbering(i);
     if (isIPField(n))
-      wl.run(file,n);
+      writeIPField<long>(out,n);
   }
-  writeCellParts(file, m);
-  file << "</CellData>\n";
+  writeCellParts(out, m);
+  out.file << "</CellData>\n";
 }
 
-static void writeVtuFile(const char* prefix, Numbering* n)
+static void writeVtuFile(const char* prefix, Numbering* n,
+    VtkFormat format, bool compress)
 {
+  if (format == VTK_ASCII)
+    compress = false;
   std::string fileName = getPieceFileName(prefix,PCU_Comm_Self());
-  std::ofstream file(fileName.c_str());
+  std::ofstream file(fileName.c_str(), std::ios::binary);
   assert(file.is_open());
+  VtkOutput out(file, format, compress);
   Mesh* m = n->getMesh();
   DynamicArray<Node> nodes;
   getNodes(n,nodes);
-  file << "<VTKFile type=\"UnstructuredGrid\">\n";
+  file << "<VTKFile type=\"UnstructuredGrid\"";
+  if (format != VTK_ASCII)
+  {
+    file << " version=\"1.0\" byte_order=\"";
+    file << (isLittleEndian() ? "LittleEndian" : "BigEndian");
+    file << "\" header_type=\"UInt64\"";
+    if (compress)
+      file << " compressor=\"vtkZLibDataCompressor\"";
+  }
+  file << ">\n";
   file << "<UnstructuredGrid>\n";
   file << "<Piece NumberOfPoints=\"" << nodes.getSize();
   file << "\" NumberOfCells=\"" << m->count(m->getDimension());
   file << "\">\n";
-  writePoints(file,m,nodes);
-  writeCells(file,n);
-  writePointData(file,m,nodes);
-  writeCellData(file,m);
+  writePoints(out,m,nodes);
+  writeCells(out,n);
+  writePointData(out,m,nodes);
+  writeCellData(out,m);
   file << "</Piece>\n";
   file << "</UnstructuredGrid>\n";
+  if (format == VTK_APPENDED)
+  {
+    file << "<AppendedData encoding=\"raw\">\n_";
+    file.write(out.appended.data(), out.appended.size());
+    file << "\n</AppendedData>\n";
+  }
   file << "</VTKFile>\n";
 }
 
-void writeVtkFiles(const char* prefix, Mesh* m)
+void writeVtkFiles(const char* prefix, Mesh* m, VtkFormat format,
+    bool compress)
 {
   double t0 = MPI_Wtime();
   writePvtuFile(prefix, m);
   Numbering* n = numberOverlapNodes(m,"apf_vtk_number");
   m->removeNumbering(n);
-  writeVtuFile(prefix, n);
+  writeVtuFile(prefix, n, format, compress);
   double t1 = MPI_Wtime();
   if (!PCU_Comm_Self())
     printf("vtk files %s written in %f seconds\n",
@@ -442,14 +606,15 @@ void writeVtkFiles(const char* prefix, Mesh* m)
   delete n;
 }
 
-void writeOneVtkFile(const char* prefix, Mesh* m)
+void writeOneVtkFile(const char* prefix, Mesh* m, VtkFormat format,
+    bool compress)
 {
   /* creating a non-collective numbering is
      a tad bit risky, but we should be fine
      given the current state of the code */
   Numbering* n = numberOverlapNodes(m,"apf_vtk_number");
   m->removeNumbering(n);
-  writeVtuFile(prefix, n);
+  writeVtuFile(prefix, n, format, compress);
   delete n;
 }
 
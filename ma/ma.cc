@@ -40,6 +40,8 @@ void adapt(Input* in)
   cleanupLayer(a);
   tetrahedronize(a);
   postBalance(a);
+  if (a->shape)
+    printQualityHistogram(a);
   Mesh* m = a->mesh;
   delete a;
   delete in;
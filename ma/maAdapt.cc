@@ -33,6 +33,7 @@ Adapt::Adapt(Input* in)
   solutionTransfer = in->solutionTransfer;
   refine = new Refine(this);
   shape = getShapeHandler(this);
+  setupQualityCache(this);
   coarsensLeft = in->maximumIterations;
   refinesLeft = in->maximumIterations;
   resetLayer(this);
@@ -43,6 +44,7 @@ Adapt::Adapt(Input* in)
 Adapt::~Adapt()
 {
   clearFlags(this);
+  clearQualityCache(this);
   delete refine;
   delete shape;
 }
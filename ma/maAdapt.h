@@ -51,6 +51,8 @@ class Adapt
     SolutionTransfer* solutionTransfer;
     Refine* refine;
     ShapeHandler* shape;
+    /* element qualities, see setupQualityCache */
+    Tag* qualityTag;
     int coarsensLeft;
     int refinesLeft;
     bool hasLayer;
@@ -12,6 +12,8 @@
 #include "maAdapt.h"
 #include "maCollapse.h"
 #include "maOperator.h"
+#include <algorithm>
+#include <set>
 
 namespace ma {
 
@@ -47,6 +49,10 @@ class CollapseChecker : public apf::CavityOp
       if (collapse.checkClass())
         setFlag(a,e,CHECKED);
     }
+    virtual apf::CavityOp* clone()
+    {
+      return new CollapseChecker(getAdapt(),modelDimension);
+    }
     Adapt* getAdapt() {return collapse.adapt;}
   private:
     Collapse collapse;
@@ -147,35 +153,185 @@ static int collapseAllEdges(Adapt* a, int modelDimension)
   return collapser.successCount;
 }
 
-struct ShouldCollapse : public Predicate
+/* the edges marked for collapse in one coarsening pass,
+   paired with their metric lengths so the shortest go first */
+typedef std::vector<std::pair<double,Entity*> > CollapseQueue;
+
+/* this is the one sweep over all edges per pass.
+   it marks like markEntities and also fills the queue */
+static long markEdgesToCollapse(Adapt* a, CollapseQueue& queue)
 {
-  ShouldCollapse(Adapt* a_):a(a_) {}
-  bool operator()(Entity* e)
+  Mesh* m = a->mesh;
+  SizeField* sf = a->sizeField;
+  long count = 0;
+  Iterator* it = m->begin(1);
+  Entity* e;
+  while ((e = m->iterate(it)))
   {
-    return a->sizeField->shouldCollapse(e);
+    assert( ! getFlag(a,e,COLLAPSE));
+    if (getFlag(a,e,DONT_COLLAPSE))
+      continue;
+    if (sf->shouldCollapse(e))
+    {
+      setFlag(a,e,COLLAPSE);
+      queue.push_back(std::make_pair(sf->measure(e),e));
+      if (m->isOwned(e))
+        ++count;
+    }
+    else
+      setFlag(a,e,DONT_COLLAPSE);
   }
-  Adapt* a;
+  m->end(it);
+  PCU_Add_Longs(&count,1);
+  std::sort(queue.begin(),queue.end());
+  return count;
+}
+
+/* records what collapses destroy, so stale queue entries
+   are skipped. a queued edge existed before the pass began,
+   so its pointer can only be in here if it was destroyed. */
+class DestroyedEntities : public DeleteCallback
+{
+  public:
+    DestroyedEntities(Adapt* a):
+      DeleteCallback(a)
+    {
+    }
+    void call(Entity* e)
+    {
+      destroyed.insert(e);
+    }
+    bool has(Entity* e)
+    {
+      return destroyed.count(e);
+    }
+    void removeFrom(CollapseQueue& queue)
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < queue.size(); ++i)
+        if ( ! has(queue[i].second))
+          queue[n++] = queue[i];
+      queue.resize(n);
+    }
+  private:
+    std::set<Entity*> destroyed;
 };
 
-long markEdgesToCollapse(Adapt* a)
+static bool isLocalCollapse(Mesh* m, Entity* edge)
+{
+  Entity* v[2];
+  m->getDownward(edge,0,v);
+  return ( ! m->isShared(v[0])) && ( ! m->isShared(v[1]));
+}
+
+/* runs the three steps of CollapseChecker, IndependentSetFinder
+   and AllEdgeCollapser on the queued edges of one model dimension,
+   visiting only those edges and their vertices.
+   these collapses also destroy queued edges of higher model
+   dimensions, including ones with a vertex on a part boundary,
+   so the destroyed entities are taken out of the queue. */
+static long collapseQueue(Adapt* a, CollapseQueue& queue,
+    int modelDimension)
+{
+  Mesh* m = a->mesh;
+  DestroyedEntities destroyed(a);
+  Collapse collapse;
+  collapse.Init(a);
+  std::vector<Entity*> edges;
+  for (size_t i = 0; i < queue.size(); ++i)
+  {
+    Entity* e = queue[i].second;
+    if (destroyed.has(e) || ( ! getFlag(a,e,COLLAPSE)))
+      continue;
+    if (m->getModelType(m->toModel(e)) != modelDimension)
+      continue;
+    assert(isLocalCollapse(m,e));
+    edges.push_back(e);
+  }
+  std::vector<Entity*> verts;
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    bool ok = collapse.setEdge(edges[i]);
+    assert(ok);
+    collapse.checkClass();
+    Entity* v[2];
+    m->getDownward(edges[i],0,v);
+    verts.insert(verts.end(),v,v+2);
+  }
+  std::sort(verts.begin(),verts.end());
+  verts.erase(std::unique(verts.begin(),verts.end()),verts.end());
+  for (size_t i = 0; i < verts.size(); ++i)
+    if (getFlag(a,verts[i],COLLAPSE) &&
+        ( ! isRequiredForAnEdgeCollapse(a,verts[i])))
+      clearFlag(a,verts[i],COLLAPSE);
+  double qualityToBeat = a->input->validQuality;
+  long successCount = 0;
+  for (size_t i = 0; i < edges.size(); ++i)
+  {
+    Entity* e = edges[i];
+    if (destroyed.has(e) || ( ! getFlag(a,e,COLLAPSE)))
+      continue;
+    bool ok = collapse.setEdge(e);
+    assert(ok);
+    if ( ! collapse.checkTopo())
+      continue;
+    if ( ! collapse.tryBothDirections(qualityToBeat))
+      continue;
+    collapse.destroyOldElements();
+    ++successCount;
+  }
+  destroyed.removeFrom(queue);
+  return successCount;
+}
+
+/* whether any part has queued edges of this model dimension
+   with a vertex on a part boundary */
+static bool hasSharedEdges(Adapt* a, CollapseQueue& queue,
+    int modelDimension)
 {
-  ShouldCollapse p(a);
-  return markEntities(a, 1, p, COLLAPSE, DONT_COLLAPSE);
+  Mesh* m = a->mesh;
+  int hasShared = 0;
+  for (size_t i = 0; i < queue.size(); ++i)
+  {
+    Entity* e = queue[i].second;
+    if (getFlag(a,e,COLLAPSE) &&
+        (m->getModelType(m->toModel(e)) == modelDimension) &&
+        ( ! isLocalCollapse(m,e)))
+    {
+      hasShared = 1;
+      break;
+    }
+  }
+  return PCU_Or(hasShared);
 }
 
 bool coarsen(Adapt* a)
 {
   double t0 = MPI_Wtime();
   --(a->coarsensLeft);
-  long count = markEdgesToCollapse(a);
+  CollapseQueue queue;
+  long count = markEdgesToCollapse(a,queue);
   if ( ! count)
     return false;
   Mesh* m = a->mesh;
   int maxDimension = m->getDimension();
   assert(checkFlagConsistency(a,1,COLLAPSE));
   long successCount = 0;
+  /* part boundary collapses need the CavityOp versions, which
+     pull the cavities of shared edges before collapsing anything.
+     running them for the whole model dimension keeps the order in
+     which its edges collapse. they visit every edge of the mesh
+     and may migrate, after which the queue is useless, so all
+     higher model dimensions are swept the same way. */
+  bool useQueue = true;
   for (int modelDimension=1; modelDimension <= maxDimension; ++modelDimension)
   {
+    if (useQueue && ( ! hasSharedEdges(a,queue,modelDimension)))
+    {
+      successCount += collapseQueue(a,queue,modelDimension);
+      continue;
+    }
+    useQueue = false;
     checkAllEdgeCollapses(a,modelDimension);
     findIndependentSet(a);
     successCount += collapseAllEdges(a,modelDimension);
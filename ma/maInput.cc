@@ -55,6 +55,7 @@ void setDefaultValues(Input* in)
   in->shouldRefineLayer = false;
   in->shouldCoarsenLayer = false;
   in->isUniform = false;
+  in->threads = 1;
 }
 
 void rejectInput(const char* str)
@@ -101,6 +102,8 @@ void validateInput(Input* in)
     rejectInput("maximum imbalance less than 1.0");
   if (in->maximumEdgeRatio < 1.0)
     rejectInput("maximum tet edge ratio less than one");
+  if (in->threads < 1)
+    rejectInput("thread count less than one");
 }
 
 void setSolutionTransfer(Input* in, SolutionTransfer* s)
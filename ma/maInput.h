@@ -81,6 +81,15 @@ class Input
     bool shouldCoarsenLayer;
 /** \brief hack to enable boundary layer uniform refinement (do not touch!) */
     bool isUniform;
+/** \brief number of threads per process used for refinement (default 1)
+  \details threads split edges, build the refined elements and
+  transfer solution on them. This only happens when the mesh
+  supports threaded modification (see apf::Mesh2::reserveThreads),
+  has only simplices and linear coordinates, parametric coordinates
+  are not transferred, and both the size field and the solution
+  transfer report that they are thread safe.
+  Otherwise refinement runs on one thread. */
+    int threads;
 };
 
 /** \brief generate a configuration based on an anisotropic function.
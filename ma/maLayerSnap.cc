@@ -2,6 +2,7 @@
 #include "maCrawler.h"
 #include "maLayer.h"
 #include "maSnap.h"
+#include "maShape.h"
 
 namespace ma {
 
@@ -209,6 +210,8 @@ struct LayerSnapper : public Crawler
     Vector s;
     m->getDoubleTag(v, snapTag, &s[0]);
     m->setPoint(v, 0, s);
+    a->sizeField->onMove(v);
+    dropVertexQualities(a, v);
   }
   void handle(Entity* v, bool shouldSnap)
   {
@@ -9,11 +9,15 @@
 *******************************************************************************/
 
 #include <cfloat>
+#include <algorithm>
+#include <sstream>
+#include <PCU.h>
 #include "maMesh.h"
 #include "maSize.h"
 #include "maAdapt.h"
 #include "maShapeHandler.h"
 #include "maShape.h"
+#include <apfShape.h>
 
 namespace ma {
 
@@ -63,15 +67,245 @@ double measureElementQuality(Mesh* m, SizeField* f, Entity* e)
   return table[m->getType(e)](m,f,e);
 }
 
+/* elements are measured in blocks of this size, with the
+   vertex data stored so that the inner loops run across the
+   elements of a block, which lets the compiler vectorize them */
+enum { QUALITY_BLOCK = 32 };
+
+struct QualityBlock
+{
+  double x[4][3][QUALITY_BLOCK];
+  double r[4][9][QUALITY_BLOCK];
+  double h[4][3][QUALITY_BLOCK];
+};
+
+static bool gatherBlock(Mesh* m, SizeField* f,
+    Entity** e, int n, QualityBlock& b)
+{
+  for (int k = 0; k < n; ++k) {
+    Entity* v[4];
+    int nv = m->getDownward(e[k], 0, v);
+    for (int i = 0; i < nv; ++i) {
+      Vector x;
+      Matrix r;
+      Vector h;
+      if ( ! f->getVertexFrame(v[i], r, h))
+        return false;
+      m->getPoint(v[i], 0, x);
+      for (int j = 0; j < 3; ++j) {
+        b.x[i][j][k] = x[j];
+        b.h[i][j][k] = h[j];
+        for (int l = 0; l < 3; ++l)
+          b.r[i][j * 3 + l][k] = r[j][l];
+      }
+    }
+  }
+  return true;
+}
+
+/* maps the nd vectors d of each element into the metric space
+   of the frames and sizes averaged over the nv vertices v,
+   following MetricSizeField::measure operation for operation */
+static void toMetricSpace(QualityBlock const& b, int n,
+    int nv, int const* v, int nd, double (*d)[3][QUALITY_BLOCK])
+{
+  for (int k = 0; k < n; ++k) {
+    double r[9];
+    double h[3];
+    for (int j = 0; j < 9; ++j) {
+      r[j] = 0;
+      for (int i = 0; i < nv; ++i)
+        r[j] += b.r[v[i]][j][k];
+      r[j] /= nv;
+    }
+    for (int j = 0; j < 3; ++j) {
+      h[j] = 0;
+      for (int i = 0; i < nv; ++i)
+        h[j] += b.h[v[i]][j][k];
+      h[j] /= nv;
+    }
+    /* the rows of c are the orthonormalized columns of r */
+    double c[3][3];
+    for (int j = 0; j < 3; ++j)
+      for (int l = 0; l < 2; ++l)
+        c[l][j] = r[j * 3 + l];
+    double l0 = sqrt(c[0][0]*c[0][0] + c[0][1]*c[0][1] + c[0][2]*c[0][2]);
+    for (int j = 0; j < 3; ++j)
+      c[0][j] /= l0;
+    double p = c[0][0]*c[1][0] + c[0][1]*c[1][1] + c[0][2]*c[1][2];
+    for (int j = 0; j < 3; ++j)
+      c[1][j] = c[1][j] - c[0][j] * p;
+    double l1 = sqrt(c[1][0]*c[1][0] + c[1][1]*c[1][1] + c[1][2]*c[1][2]);
+    for (int j = 0; j < 3; ++j)
+      c[1][j] /= l1;
+    c[2][0] = c[0][1]*c[1][2] - c[0][2]*c[1][1];
+    c[2][1] = c[0][2]*c[1][0] - c[0][0]*c[1][2];
+    c[2][2] = c[0][0]*c[1][1] - c[0][1]*c[1][0];
+    for (int i = 0; i < nd; ++i) {
+      double x[3];
+      for (int j = 0; j < 3; ++j)
+        x[j] = d[i][j][k];
+      for (int j = 0; j < 3; ++j) {
+        double s = 1 / h[j];
+        d[i][j][k] = (c[j][0] * s) * x[0]
+                   + (c[j][1] * s) * x[1]
+                   + (c[j][2] * s) * x[2];
+      }
+    }
+  }
+}
+
+static bool measureBlock(Mesh* m, SizeField* f,
+    int type, Entity** e, int n, double* q)
+{
+  QualityBlock b;
+  if ( ! gatherBlock(m, f, e, n, b))
+    return false;
+  int nv = (type == TET) ? 4 : 3;
+  int ne = (type == TET) ? 6 : 3;
+  int const (*ev)[2] = (type == TET) ?
+    apf::tet_edge_verts : apf::tri_edge_verts;
+  double s[QUALITY_BLOCK];
+  for (int k = 0; k < n; ++k)
+    s[k] = 0;
+  for (int i = 0; i < ne; ++i) {
+    double d[1][3][QUALITY_BLOCK];
+    for (int j = 0; j < 3; ++j)
+      for (int k = 0; k < n; ++k)
+        d[0][j][k] = b.x[ev[i][1]][j][k] - b.x[ev[i][0]][j][k];
+    toMetricSpace(b, n, 2, ev[i], 1, d);
+    for (int k = 0; k < n; ++k) {
+      double l = sqrt(d[0][0][k]*d[0][0][k] +
+                      d[0][1][k]*d[0][1][k] +
+                      d[0][2][k]*d[0][2][k]);
+      s[k] += l * l;
+    }
+  }
+  static int const verts[4] = {0,1,2,3};
+  double d[3][3][QUALITY_BLOCK];
+  for (int i = 0; i < nv - 1; ++i)
+    for (int j = 0; j < 3; ++j)
+      for (int k = 0; k < n; ++k)
+        d[i][j][k] = b.x[i + 1][j][k] - b.x[0][j][k];
+  toMetricSpace(b, n, nv, verts, nv - 1, d);
+  for (int k = 0; k < n; ++k) {
+    double x = d[0][1][k]*d[1][2][k] - d[0][2][k]*d[1][1][k];
+    double y = d[0][2][k]*d[1][0][k] - d[0][0][k]*d[1][2][k];
+    double z = d[0][0][k]*d[1][1][k] - d[0][1][k]*d[1][0][k];
+    if (type == TRI) {
+      double A = sqrt(x*x + y*y + z*z) / 2;
+      q[k] = 48*(A*A)/(s[k]*s[k]);
+    } else {
+      double V = (x*d[2][0][k] + y*d[2][1][k] + z*d[2][2][k]) / 6;
+      double Q = 15552*(V*V)/(s[k]*s[k]*s[k]);
+      q[k] = (V < 0) ? -Q : Q;
+    }
+  }
+  return true;
+}
+
+void measureElementQualities(Mesh* m, SizeField* f,
+    Entity** e, size_t n, double* q)
+{
+  size_t i = 0;
+  while (i < n) {
+    int type = m->getType(e[i]);
+    size_t j = i + 1;
+    while (j < n && j - i < QUALITY_BLOCK && m->getType(e[j]) == type)
+      ++j;
+    bool blocked = (type == TRI || type == TET) &&
+      measureBlock(m, f, type, e + i, j - i, q + i);
+    if ( ! blocked)
+      for (size_t k = i; k < j; ++k)
+        q[k] = measureElementQuality(m, f, e[k]);
+    i = j;
+  }
+}
+
+void setupQualityCache(Adapt* a)
+{
+  a->qualityTag = 0;
+  if (a->shape && a->mesh->getShape()->getOrder() == 1)
+    a->qualityTag = a->mesh->createDoubleTag("ma_quality", 1);
+}
+
+static void dropCachedQuality(Adapt* a, Entity* e)
+{
+  Tag* tag = a->qualityTag;
+  if (tag && a->mesh->hasTag(e, tag))
+    a->mesh->removeTag(e, tag);
+}
+
+void clearQualityCache(Adapt* a)
+{
+  if ( ! a->qualityTag)
+    return;
+  Mesh* m = a->mesh;
+  Iterator* it = m->begin(m->getDimension());
+  Entity* e;
+  while ((e = m->iterate(it)))
+    dropCachedQuality(a, e);
+  m->end(it);
+  m->destroyTag(a->qualityTag);
+  a->qualityTag = 0;
+}
+
+void dropVertexQualities(Adapt* a, Entity* vert)
+{
+  if ( ! a->qualityTag)
+    return;
+  Mesh* m = a->mesh;
+  Upward es;
+  m->getAdjacent(vert, m->getDimension(), es);
+  for (size_t i = 0; i < es.getSize(); ++i)
+    dropCachedQuality(a, es[i]);
+}
+
+/* only elements of the mesh dimension are cached,
+   the lower ones are measured every time */
+void getCachedQualities(Adapt* a, Entity** e, size_t n, double* q)
+{
+  Tag* tag = a->qualityTag;
+  if ( ! tag) {
+    a->shape->getQualities(e, n, q);
+    return;
+  }
+  Mesh* m = a->mesh;
+  int dim = m->getDimension();
+  for (size_t i = 0; i < n; i += QUALITY_BLOCK) {
+    size_t bn = std::min(n - i, size_t(QUALITY_BLOCK));
+    Entity* missing[QUALITY_BLOCK];
+    double* at[QUALITY_BLOCK];
+    size_t nm = 0;
+    for (size_t j = 0; j < bn; ++j) {
+      if (m->hasTag(e[i + j], tag))
+        m->getDoubleTag(e[i + j], tag, q + i + j);
+      else {
+        missing[nm] = e[i + j];
+        at[nm++] = q + i + j;
+      }
+    }
+    double mq[QUALITY_BLOCK];
+    a->shape->getQualities(missing, nm, mq);
+    for (size_t j = 0; j < nm; ++j) {
+      *(at[j]) = mq[j];
+      if (getDimension(m, missing[j]) == dim)
+        m->setDoubleTag(missing[j], tag, mq + j);
+    }
+  }
+}
+
 double getWorstQuality(Adapt* a, Entity** e, size_t n)
 {
   assert(n);
-  ShapeHandler* sh = a->shape;
-  double worst = sh->getQuality(e[0]);
-  for (size_t i = 1; i < n; ++i) {
-    double quality = sh->getQuality(e[i]);
-    if (quality < worst)
-      worst = quality;
+  double worst = 0;
+  for (size_t i = 0; i < n; i += QUALITY_BLOCK) {
+    size_t bn = std::min(n - i, size_t(QUALITY_BLOCK));
+    double q[QUALITY_BLOCK];
+    getCachedQualities(a, e + i, bn, q);
+    for (size_t j = 0; j < bn; ++j)
+      if (( ! i && ! j) || q[j] < worst)
+        worst = q[j];
   }
   return worst;
 }
@@ -81,6 +315,59 @@ double getWorstQuality(Adapt* a, EntityArray& e)
   return getWorstQuality(a, &(e[0]), e.getSize());
 }
 
+static void addToHistogram(Adapt* a, Entity** e, size_t n,
+    int nbins, long* counts)
+{
+  double q[QUALITY_BLOCK];
+  getCachedQualities(a, e, n, q);
+  for (size_t i = 0; i < n; ++i) {
+    int bin = q[i] * nbins;
+    bin = std::max(0, std::min(nbins - 1, bin));
+    ++counts[bin];
+  }
+}
+
+void getPartQualityHistogram(Adapt* a, int nbins, long* counts)
+{
+  for (int i = 0; i < nbins; ++i)
+    counts[i] = 0;
+  Mesh* m = a->mesh;
+  Entity* block[QUALITY_BLOCK];
+  size_t n = 0;
+  Iterator* it = m->begin(m->getDimension());
+  Entity* e;
+  while ((e = m->iterate(it))) {
+    if ( ! apf::isSimplex(m->getType(e)))
+      continue;
+    block[n++] = e;
+    if (n == QUALITY_BLOCK) {
+      addToHistogram(a, block, n, nbins, counts);
+      n = 0;
+    }
+  }
+  m->end(it);
+  if (n)
+    addToHistogram(a, block, n, nbins, counts);
+}
+
+void getQualityHistogram(Adapt* a, int nbins, long* counts)
+{
+  getPartQualityHistogram(a, nbins, counts);
+  PCU_Add_Longs(counts, nbins);
+}
+
+void printQualityHistogram(Adapt* a)
+{
+  enum { BINS = 10 };
+  long counts[BINS];
+  getQualityHistogram(a, BINS, counts);
+  std::stringstream ss;
+  for (int i = 0; i < BINS; ++i)
+    ss << ' ' << counts[i];
+  print("element quality histogram, %d bins over [0,1]:%s",
+      BINS, ss.str().c_str());
+}
+
 /* applies the same measure as measureTetQuality
    but works directly off the points. */
 double measureLinearTetQuality(Vector xyz[4])
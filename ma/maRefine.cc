@@ -19,6 +19,8 @@
 #include "maSnap.h"
 #include "maLayer.h"
 #include <apf.h>
+#include <apfShape.h>
+#include <apfCavityOp.h>
 
 namespace ma {
 
@@ -327,10 +329,157 @@ void collectForTransfer(Refine* r)
     r->shouldCollect[d] = true;
 }
 
+static bool canRefineInThreads(Adapt* a)
+{
+  Input* in = a->input;
+  return (in->threads > 1) &&
+         ( ! a->hasLayer) &&
+         (a->mesh->getShape()->getOrder() == 1) &&
+         ( ! in->shouldTransferParametric) &&
+         a->sizeField->isThreadSafe() &&
+         a->solutionTransfer->isThreadSafe();
+}
+
+/* upper bounds on the entities of each type created by
+   the templates that split one simplex. The worst tet case
+   adds a center vertex to a prism left by cutting off one tet,
+   which makes nine tets. Bounds that are too large only
+   waste slots until the next reservation reuses them. */
+static int const maxNewEntities[TYPES][TYPES] =
+/*  V  E  T  Q  TT H  P  PY */
+{{0, 0, 0, 0, 0, 0, 0, 0} //vert
+,{1, 2, 0, 0, 0, 0, 0, 0} //edge
+,{1, 6, 6, 0, 0, 0, 0, 0} //tri
+,{0, 0, 0, 0, 0, 0, 0, 0} //quad
+,{1,12,24, 0,12, 0, 0, 0} //tet
+,{0, 0, 0, 0, 0, 0, 0, 0} //hex
+,{0, 0, 0, 0, 0, 0, 0, 0} //prism
+,{0, 0, 0, 0, 0, 0, 0, 0} //pyramid
+};
+
+/* threads reserve room for this many entities at a time,
+   which bounds the slots wasted by the estimates above */
+static size_t const splitChunk = 16 * 1024;
+
+/* gives the entities built by each thread
+   to the collector of that thread */
+class ThreadCollector : public apf::BuildCallback
+{
+  public:
+    ThreadCollector(int n):perThread(n) {}
+    virtual void call(Entity* e)
+    {
+      perThread[PCU_Work_Thread()].call(e);
+    }
+    std::vector<NewEntities> perThread;
+};
+
+struct SplitWork
+{
+  Refine* refine;
+  int dimension;
+  int threads;
+  Entity* const* entities;
+  size_t count;
+  ThreadCollector* collector;
+};
+
+static void splitInThread(int thread, void* data)
+{
+  SplitWork* w = static_cast<SplitWork*>(data);
+  Refine* r = w->refine;
+  Mesh* m = r->adapt->mesh;
+  for (size_t i = thread; i < w->count; i += w->threads)
+  {
+    Entity* e = w->entities[i];
+    if ( ! w->collector)
+    {
+      splitElement(r,e);
+      continue;
+    }
+    NewEntities& cb = w->collector->perThread[thread];
+    cb.reset();
+    splitElement(r,e);
+    int n;
+    m->getIntTag(e,r->numberTag,&n);
+    cb.retrieve(r->newEntities[w->dimension][n]);
+  }
+}
+
+static void reserveForSplits(SplitWork* w)
+{
+  Mesh* m = w->refine->adapt->mesh;
+  std::vector<int> need(w->threads * TYPES, 0);
+  for (size_t i = 0; i < w->count; ++i)
+  {
+    int type = m->getType(w->entities[i]);
+    int* n = &need[(i % w->threads) * TYPES];
+    for (int t = 0; t < TYPES; ++t)
+      n[t] += maxNewEntities[type][t];
+  }
+  int counts[TYPES] = {};
+  for (int i = 0; i < w->threads; ++i)
+    for (int t = 0; t < TYPES; ++t)
+      counts[t] = std::max(counts[t], need[i * TYPES + t]);
+  /* splitElementsInThreads checked that this is supported */
+  m->reserveThreads(w->threads,counts);
+}
+
+/* entities of one dimension are grouped so that no two in a
+   group share a vertex, and each group is split by all threads.
+   Everything a template touches is then private to one thread:
+   the closure of the entity, the entities that split it,
+   and the upward adjacencies of their vertices. */
+static bool splitElementsInThreads(Refine* r)
+{
+  Adapt* a = r->adapt;
+  Mesh* m = a->mesh;
+  int threads = a->input->threads;
+  int none[TYPES] = {};
+  if ( ! m->reserveThreads(threads,none))
+    return false;
+  m->commitThreads();
+  ThreadCollector cb(threads);
+  SplitWork w;
+  w.refine = r;
+  w.threads = threads;
+  for (int d=1; d <= m->getDimension(); ++d)
+  {
+    w.dimension = d;
+    w.collector = 0;
+    if (r->shouldCollect[d])
+    {
+      r->newEntities[d].setSize(r->toSplit[d].getSize());
+      setBuildCallback(a,&cb);
+      w.collector = &cb;
+    }
+    std::vector<Entity*> entities(r->toSplit[d].getSize());
+    for (size_t i=0; i < entities.size(); ++i)
+      entities[i] = r->toSplit[d][i];
+    std::vector<std::vector<Entity*> > colors;
+    apf::colorByVertices(m,entities,colors);
+    size_t chunk = splitChunk * threads;
+    for (size_t c=0; c < colors.size(); ++c)
+      for (size_t b=0; b < colors[c].size(); b += chunk)
+      {
+        w.entities = &(colors[c][b]);
+        w.count = std::min(chunk,colors[c].size() - b);
+        reserveForSplits(&w);
+        PCU_Work_Run(threads,splitInThread,&w);
+        m->commitThreads();
+      }
+    if (r->shouldCollect[d])
+      clearBuildCallback(a);
+  }
+  return true;
+}
+
 void splitElements(Refine* r)
 {
   Adapt* a = r->adapt;
   Mesh* m = a->mesh;
+  if (canRefineInThreads(a) && splitElementsInThreads(r))
+    return;
   NewEntities cb;
   for (int d=1; d <= m->getDimension(); ++d)
   {
@@ -354,15 +503,46 @@ void splitElements(Refine* r)
   }
 }
 
+struct TransferWork
+{
+  Refine* refine;
+  int dimension;
+  int threads;
+};
+
+/* each parent only writes to the entities that split it,
+   so this needs no grouping */
+static void transferInThread(int thread, void* data)
+{
+  TransferWork* w = static_cast<TransferWork*>(data);
+  Refine* r = w->refine;
+  SolutionTransfer* st = r->adapt->solutionTransfer;
+  int d = w->dimension;
+  for (size_t i = thread; i < r->toSplit[d].getSize(); i += w->threads)
+    st->onRefine(r->toSplit[d][i],r->newEntities[d][i]);
+}
+
 void transferElements(Refine* r)
 {
   Adapt* a = r->adapt;
   Mesh* m = a->mesh;
   SolutionTransfer* st = a->solutionTransfer;
   int td = st->getTransferDimension();
+  bool threaded = canRefineInThreads(a);
   for (int d = td; d <= m->getDimension(); ++d)
+  {
+    if (threaded)
+    {
+      TransferWork w;
+      w.refine = r;
+      w.dimension = d;
+      w.threads = a->input->threads;
+      PCU_Work_Run(w.threads,transferInThread,&w);
+      continue;
+    }
     for (size_t i=0; i < r->toSplit[d].getSize(); ++i)
       st->onRefine(r->toSplit[d][i],r->newEntities[d][i]);
+  }
   td = a->shape->getTransferDimension();
   for (int d = td; d <= m->getDimension(); ++d)
     for (size_t i=0; i < r->toSplit[d].getSize(); ++i)
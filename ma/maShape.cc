@@ -73,20 +73,51 @@ CodeMatch matchSliver(
   return table[getSliverCode(a,tet)];
 }
 
-struct IsBadQuality : public Predicate
+/* elements whose quality is unknown are measured
+   this many at a time through getCachedQualities */
+enum { MARK_BLOCK = 64 };
+
+static long markQualities(Adapt* a, Entity** e, size_t n)
 {
-  IsBadQuality(Adapt* a_):a(a_) {}
-  bool operator()(Entity* e)
-  {
-    return a->shape->getQuality(e) < a->input->goodQuality;
-  }
-  Adapt* a;
-};
+  double q[MARK_BLOCK];
+  getCachedQualities(a, e, n, q);
+  long count = 0;
+  for (size_t i = 0; i < n; ++i)
+    if (q[i] < a->input->goodQuality) {
+      setFlag(a, e[i], BAD_QUALITY);
+      if (a->mesh->isOwned(e[i]))
+        ++count;
+    } else
+      setFlag(a, e[i], OK_QUALITY);
+  return count;
+}
 
+/* this is markEntities with a bad quality predicate,
+   except that qualities are computed in blocks */
 int markBadQuality(Adapt* a)
 {
-  IsBadQuality p(a);
-  return markEntities(a, a->mesh->getDimension(), p, BAD_QUALITY, OK_QUALITY);
+  Mesh* m = a->mesh;
+  Entity* block[MARK_BLOCK];
+  size_t n = 0;
+  long count = 0;
+  Iterator* it = m->begin(m->getDimension());
+  Entity* e;
+  while ((e = m->iterate(it)))
+  {
+    assert( ! getFlag(a,e,BAD_QUALITY));
+    if (getFlag(a,e,OK_QUALITY))
+      continue;
+    block[n++] = e;
+    if (n == MARK_BLOCK)
+    {
+      count += markQualities(a, block, n);
+      n = 0;
+    }
+  }
+  m->end(it);
+  count += markQualities(a, block, n);
+  PCU_Add_Longs(&count,1);
+  return count;
 }
 
 class ShortEdgeFixer : public Operator
@@ -21,12 +21,36 @@ class Adapt;
 double measureTriQuality(Mesh* m, SizeField* f, Entity* tri);
 double measureTetQuality(Mesh* m, SizeField* f, Entity* tet);
 double measureElementQuality(Mesh* m, SizeField* f, Entity* e);
+/* same as measureElementQuality for each of the n elements,
+   but triangles and tets are measured in blocks when the
+   size field provides vertex frames */
+void measureElementQualities(Mesh* m, SizeField* f,
+    Entity** e, size_t n, double* q);
 
 double measureQuadraticTetQuality(Mesh* m, Entity* tet);
 
 double getWorstQuality(Adapt* a, EntityArray& e);
 double getWorstQuality(Adapt* a, Entity** e, size_t n);
 
+/* on linear meshes, element qualities are cached in a tag.
+   quality there depends only on the element's vertices,
+   so a cached value is dropped when one of its vertices moves,
+   and the mesh drops it along with the element's other tags
+   when the element is destroyed. */
+void setupQualityCache(Adapt* a);
+void clearQualityCache(Adapt* a);
+void dropVertexQualities(Adapt* a, Entity* vert);
+/* like ShapeHandler::getQualities, but consults the cache */
+void getCachedQualities(Adapt* a, Entity** e, size_t n, double* q);
+
+/* counts simplex elements by quality into nbins equal bins
+   over [0,1]. negative qualities count in the first bin.
+   the part version counts the elements of this part,
+   the other sums over all parts. */
+void getPartQualityHistogram(Adapt* a, int nbins, long* counts);
+void getQualityHistogram(Adapt* a, int nbins, long* counts);
+void printQualityHistogram(Adapt* a);
+
 bool isLayerElementOk(Mesh* m, Entity* e);
 
 CodeMatch matchSliver(
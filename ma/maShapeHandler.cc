@@ -15,6 +15,12 @@
 
 namespace ma {
 
+void ShapeHandler::getQualities(Entity** e, size_t n, double* q)
+{
+  for (size_t i = 0; i < n; ++i)
+    q[i] = getQuality(e[i]);
+}
+
 class LinearHandler : public ShapeHandler
 {
   public:
@@ -27,6 +33,10 @@ class LinearHandler : public ShapeHandler
     {
       return measureElementQuality(mesh, sizeField, e);
     }
+    virtual void getQualities(Entity** e, size_t n, double* q)
+    {
+      measureElementQualities(mesh, sizeField, e, n, q);
+    }
     virtual bool hasNodesOn(int dimension)
     {
       return dimension == 0;
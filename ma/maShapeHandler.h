@@ -11,6 +11,8 @@ class ShapeHandler : public SolutionTransfer
 {
   public:
     virtual double getQuality(Entity* e) = 0;
+    /* fills q[i] with getQuality(e[i]) for all n elements */
+    virtual void getQualities(Entity** e, size_t n, double* q);
 };
 
 ShapeHandler* getShapeHandler(Adapt* a);
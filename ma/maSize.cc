@@ -18,6 +18,20 @@ SizeField::~SizeField()
 {
 }
 
+bool SizeField::isThreadSafe()
+{
+  return false;
+}
+
+bool SizeField::getVertexFrame(Entity*, Matrix&, Vector&)
+{
+  return false;
+}
+
+void SizeField::onMove(Entity*)
+{
+}
+
 IdentitySizeField::IdentitySizeField(Mesh* m):
   mesh(m)
 {
@@ -46,6 +60,22 @@ double IdentitySizeField::placeSplit(Entity*)
   return 0.5;
 }
 
+bool IdentitySizeField::isThreadSafe()
+{
+  return true;
+}
+
+bool IdentitySizeField::getVertexFrame(Entity*, Matrix& r, Vector& h)
+{
+  if (mesh->getShape()->getOrder() != 1)
+    return false;
+  r = Matrix(1,0,0,
+             0,1,0,
+             0,0,1);
+  h = Vector(1,1,1);
+  return true;
+}
+
 void IdentitySizeField::interpolate(
     apf::MeshElement*,
     Vector const&,
@@ -76,12 +106,8 @@ static void makeQ(Matrix const& R, Vector const& h, Matrix& Q)
   Q = R*S;
 }
 
-static void interpolateR(
-    apf::Element* rElement,
-    Vector const& xi,
-    Matrix& R)
+static void orthonormalize(Matrix& R)
 {
-  apf::getMatrix(rElement,xi,R);
   /* by the way, the principal direction vectors
      are in the columns, so lets do our cleanup
      work on the transpose */
@@ -109,6 +135,15 @@ static void interpolateR(
   R = transpose(RT);
 }
 
+static void interpolateR(
+    apf::Element* rElement,
+    Vector const& xi,
+    Matrix& R)
+{
+  apf::getMatrix(rElement,xi,R);
+  orthonormalize(R);
+}
+
 static void interpolateQ(
     apf::Element* rElement,
     apf::Element* hElement,
@@ -189,12 +224,71 @@ struct MetricSizeField : public SizeField
   }
   double measure(Entity* e)
   {
+    int type = mesh->getType(e);
+    if ((type == EDGE || type == TRI || type == TET) &&
+        isLinear())
+      return measureSimplex(e);
     SizeFieldIntegrator integrator(rField, hField);
     apf::MeshElement* me = apf::createMeshElement(mesh, e);
     integrator.process(me);
     apf::destroyMeshElement(me);
     return integrator.measurement;
   }
+  bool isLinear()
+  {
+    apf::FieldShape* linear = apf::getLagrange(1);
+    return mesh->getShape() == linear &&
+           apf::getShape(rField) == linear &&
+           apf::getShape(hField) == linear;
+  }
+  /* the first order SizeFieldIntegrator evaluates one point
+     at the centroid of a simplex, where the linear fields
+     are vertex averages and the Jacobian is constant.
+     This is the same measure computed straight from the
+     vertex values, without building apf::Elements. */
+  double measureSimplex(Entity* e)
+  {
+    Entity* v[4];
+    int n = mesh->getDownward(e,0,v);
+    Vector p[4];
+    Matrix R(0,0,0,0,0,0,0,0,0);
+    Vector h(0,0,0);
+    for (int i=0; i < n; ++i)
+    {
+      mesh->getPoint(v[i],0,p[i]);
+      Matrix vR;
+      apf::getMatrix(rField,v[i],0,vR);
+      R = R + vR;
+      Vector vh;
+      apf::getVector(hField,v[i],0,vh);
+      h = h + vh;
+    }
+    R = R / n;
+    h = h / n;
+    orthonormalize(R);
+    Matrix Q;
+    makeQ(R,h,Q);
+    Matrix QT = transpose(Q);
+  /* the rows of J*Q are the edge vectors in metric space.
+     the parent edge has length 2 and its tangent is half
+     the edge vector, so the weights cancel out there. */
+    Vector a = QT*(p[1]-p[0]);
+    if (n == 2)
+      return a.getLength();
+    Vector b = QT*(p[2]-p[0]);
+    if (n == 3)
+      return apf::cross(a,b).getLength() / 2;
+    Vector c = QT*(p[3]-p[0]);
+    return (apf::cross(a,b) * c) / 6;
+  }
+  bool getVertexFrame(Entity* vert, Matrix& r, Vector& h)
+  {
+    if ( ! isLinear())
+      return false;
+    apf::getMatrix(rField,vert,0,r);
+    apf::getVector(hField,vert,0,h);
+    return true;
+  }
   bool shouldSplit(Entity* edge)
   {
     return this->measure(edge) > 1.5;
@@ -258,6 +352,10 @@ struct MetricSizeField : public SizeField
     /* parentMeasure is used to normalize */
     return measure(e) / parentMeasure[mesh->getType(e)];
   }
+  bool isThreadSafe()
+  {
+    return true;
+  }
   void setValue(
       Entity* vert,
       Matrix const& r,
@@ -306,85 +404,59 @@ struct IsoWrapper : public AnisotropicFunction
   IsotropicFunction* function;
 };
 
-struct BothEval
+/* the user's function is evaluated once per vertex and the
+   results are kept in ordinary vertex fields, which the
+   MetricSizeField code reads from then on.
+   New vertices get a fresh evaluation in interpolate,
+   and vertices moved by snapping one in onMove. */
+struct AnisoSizeField : public MetricSizeField
 {
-  BothEval(AnisotropicFunction* f)
-  {
-    function = f;
-    cachedVert = 0;
-  }
-  void updateCache(Entity* v)
-  {
-    if (v == cachedVert)
-      return;
-    function->getValue(v, cachedFrame, cachedSizes);
-    cachedVert = v;
-  }
-  void getSizes(Entity* v, Vector& s)
-  {
-    updateCache(v);
-    s = cachedSizes;
-  }
-  void getFrame(Entity* v, Matrix& f)
+  AnisoSizeField(Mesh* m, AnisotropicFunction* f):
+    function(f)
   {
-    updateCache(v);
-    f = cachedFrame;
+    sizesField = apf::createLagrangeField(m, "ma_sizes", apf::VECTOR, 1);
+    frameField = apf::createLagrangeField(m, "ma_frame", apf::MATRIX, 1);
+    this->init(m, sizesField, frameField);
   }
-  Entity* cachedVert;
-  Vector cachedSizes;
-  Matrix cachedFrame;
-  AnisotropicFunction* function;
-};
-
-struct SizesEval : public apf::Function
-{
-  SizesEval(BothEval* b)
+  ~AnisoSizeField()
   {
-    both = b;
+    apf::destroyField(sizesField);
+    apf::destroyField(frameField);
   }
-  void eval(Entity* e, double* result)
+  /* called once the function object is fully constructed,
+     which for the derived classes is after this constructor */
+  void evaluate()
   {
-    Vector* s = (Vector*) result;
-    both->getSizes(e, *s);
+    apf::MeshIterator* it = mesh->begin(0);
+    Entity* v;
+    while ((v = mesh->iterate(it)))
+      evaluate(v);
+    mesh->end(it);
   }
-  BothEval* both;
-};
-
-struct FrameEval : public apf::Function
-{
-  FrameEval(BothEval* b)
+  void evaluate(Entity* v)
   {
-    both = b;
+    Matrix r;
+    Vector h;
+    function->getValue(v, r, h);
+    this->setValue(v, r, h);
   }
-  void eval(Entity* e, double* result)
+  void interpolate(
+      apf::MeshElement*,
+      Vector const&,
+      Entity* newVert)
   {
-    Matrix* f = (Matrix*) result;
-    both->getFrame(e, *f);
+    evaluate(newVert);
   }
-  BothEval* both;
-};
-
-struct AnisoSizeField : public MetricSizeField
-{
-  AnisoSizeField(Mesh* m, AnisotropicFunction* f):
-    bothEval(f),
-    sizesEval(&bothEval),
-    frameEval(&bothEval)
+  void onMove(Entity* vert)
   {
-    sizesField = apf::createUserField(m, "ma_sizes", apf::VECTOR,
-        apf::getLagrange(1), &sizesEval);
-    frameField = apf::createUserField(m, "ma_frame", apf::MATRIX,
-        apf::getLagrange(1), &frameEval);
-    this->init(m, sizesField, frameField);
+    evaluate(vert);
   }
-  ~AnisoSizeField()
+  /* the user's function need not be reentrant */
+  bool isThreadSafe()
   {
-    apf::destroyField(sizesField);
-    apf::destroyField(frameField);
+    return false;
   }
-  BothEval bothEval;
-  SizesEval sizesEval;
-  FrameEval frameEval;
+  AnisotropicFunction* function;
   apf::Field* sizesField;
   apf::Field* frameField;
 };
@@ -435,17 +507,23 @@ SizeField* makeSizeField(Mesh* m, apf::Field* sizes, apf::Field* frames)
 
 SizeField* makeSizeField(Mesh* m, AnisotropicFunction* f)
 {
-  return new AnisoSizeField(m, f);
+  AnisoSizeField* sf = new AnisoSizeField(m, f);
+  sf->evaluate();
+  return sf;
 }
 
 SizeField* makeSizeField(Mesh* m, IsotropicFunction* f)
 {
-  return new IsoSizeField(m, f);
+  AnisoSizeField* sf = new IsoSizeField(m, f);
+  sf->evaluate();
+  return sf;
 }
 
 SizeField* makeSizeField(Mesh* m, apf::Field* size)
 {
-  return new IsoUserField(m, size);
+  AnisoSizeField* sf = new IsoUserField(m, size);
+  sf->evaluate();
+  return sf;
 }
 
 double getAverageEdgeLength(Mesh* m)
@@ -37,6 +37,20 @@ class SizeField
         Vector const& xi,
         Matrix& t) = 0;
     virtual double getWeight(Entity* e) = 0;
+    /** \brief whether placeSplit and interpolate may run on
+      several threads at once for different entities (default false) */
+    virtual bool isThreadSafe();
+    /** \brief get the frame and sizes at a vertex
+      \details returns false unless measures in this field are
+      linear simplex measures under the vertex frames and sizes
+      averaged over the simplex, which allows batched quality
+      evaluation (default false) */
+    virtual bool getVertexFrame(Entity* vert, Matrix& r, Vector& h);
+    /** \brief update the size at a vertex whose point moved
+      \details snapping calls this after each move of an existing
+      vertex, so fields that keep values computed from the point
+      can compute them again (default does nothing) */
+    virtual void onMove(Entity* vert);
 };
 
 struct IdentitySizeField : public SizeField
@@ -55,6 +69,8 @@ struct IdentitySizeField : public SizeField
           Vector const&,
           Matrix& t);
   double getWeight(Entity*);
+  bool isThreadSafe();
+  bool getVertexFrame(Entity*, Matrix& r, Vector& h);
   Mesh* mesh;
 };
 
@@ -10,6 +10,7 @@
 #include "maSnapper.h"
 #include "maAdapt.h"
 #include "maShapeHandler.h"
+#include "maShape.h"
 #include <apfCavityOp.h>
 
 namespace ma {
@@ -96,11 +97,15 @@ static bool trySnapping(Adapt* adapter, Tag* tag, Entity* vert,
   computeNormals(mesh, elements, normals);
 /* move the vertex to the desired point */
   mesh->setPoint(vert, 0, s);
+  adapter->sizeField->onMove(vert);
+  dropVertexQualities(adapter, vert);
 /* check resulting cavity */
   collectBadElements(adapter, elements, normals, badElements);
   if (badElements.n) {
     /* not ok, put the vertex back where it was */
     mesh->setPoint(vert, 0, x);
+    adapter->sizeField->onMove(vert);
+    dropVertexQualities(adapter, vert);
     return false;
   } else {
     /* ok, take off the snap tag */
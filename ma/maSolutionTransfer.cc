@@ -39,6 +39,11 @@ void SolutionTransfer::onCavity(
 {
 }
 
+bool SolutionTransfer::isThreadSafe()
+{
+  return false;
+}
+
 static int getMinimumDimension(apf::FieldShape* s)
 {
   int transferDimension = 4;
@@ -71,7 +76,7 @@ class FieldTransfer : public SolutionTransfer
       field = f;
       mesh = apf::getMesh(f);
       shape = apf::getShape(f);
-      value.allocate(apf::countComponents(f));
+      components = apf::countComponents(f);
     }
     /* hmm... in vs. on ... probably the ma:: signature
        should change, it has the least users */
@@ -79,10 +84,16 @@ class FieldTransfer : public SolutionTransfer
     {
       return shape->hasNodesIn(dimension);
     }
+    /* the value buffers are local so that threads
+       can transfer into different entities at once */
+    virtual bool isThreadSafe()
+    {
+      return true;
+    }
     apf::Field* field;
     apf::Mesh* mesh;
     apf::FieldShape* shape;
-    apf::NewArray<double> value;
+    int components;
 };
 
 class LinearTransfer : public FieldTransfer
@@ -98,6 +109,7 @@ class LinearTransfer : public FieldTransfer
         Entity* vert)
     {
       apf::Element* e = apf::createElement(field,parent);
+      apf::NewArray<double> value(components);
       apf::getComponents(e,xi,&(value[0]));
       apf::setComponents(field,vert,0,&(value[0]));
     }
@@ -116,6 +128,7 @@ class CavityTransfer : public FieldTransfer
         apf::Node const& node,
         Vector const& elemXi)
     {
+      apf::NewArray<double> value(components);
       apf::getComponents(elem,elemXi,&(value[0]));
       apf::setComponents(field,node.entity,node.node,&(value[0]));
     }
@@ -243,6 +256,10 @@ class HighOrderTransfer : public SolutionTransfer
     {
       others.onCavity(oldElements,newEntities);
     }
+    virtual bool isThreadSafe()
+    {
+      return true;
+    }
 };
 
 SolutionTransfer* createFieldTransfer(apf::Field* f)
@@ -307,6 +324,14 @@ void SolutionTransfers::onCavity(
     transfers[i]->onCavity(oldElements,newEntities);
 }
 
+bool SolutionTransfers::isThreadSafe()
+{
+  for (size_t i = 0; i < transfers.size(); ++i)
+    if ( ! transfers[i]->isThreadSafe())
+      return false;
+  return true;
+}
+
 AutoSolutionTransfer::AutoSolutionTransfer(Mesh* m)
 {
   for (int i = 0; i < m->countFields(); ++i)
@@ -69,6 +69,11 @@ class SolutionTransfer
     virtual void onCavity(
         EntityArray& oldElements,
         EntityArray& newEntities);
+    /** \brief whether onVertex and onRefine may run on several
+      threads at once for different entities
+      \details the default is false, override it to allow
+      threaded refinement (see ma::Input::threads) */
+    virtual bool isThreadSafe();
     /** \brief for internal MeshAdapt use */
     int getTransferDimension();
 };
@@ -100,6 +105,7 @@ class SolutionTransfers : public SolutionTransfer
     virtual void onCavity(
         EntityArray& oldElements,
         EntityArray& newEntities);
+    virtual bool isThreadSafe();
   private:
     typedef std::vector<SolutionTransfer*> Transfers;
     Transfers transfers;
@@ -92,6 +92,18 @@ static int apf2mds(int t_apf)
   return table[t_apf];
 }
 
+/* threads creating and destroying entities share PMEs,
+   so their reference counts change atomically and PMEs that
+   drop to zero are only erased by commitThreads */
+static void addPMERefs(PME* p, int n)
+{
+#if defined(__GNUC__)
+  __sync_fetch_and_add(&p->refs, n);
+#else
+  p->refs += n;
+#endif
+}
+
 class MeshMDS : public Mesh2
 {
   public:
@@ -101,6 +113,7 @@ class MeshMDS : public Mesh2
       mds_id cap[MDS_TYPES] = {};
       mesh = mds_apf_create(m, d, cap);
       isMatched = isMatched_;
+      threadPME = 0;
     }
     MeshMDS(gmi_model* m, Mesh* from)
     {
@@ -117,6 +130,7 @@ class MeshMDS : public Mesh2
       int d = from->getDimension();
       mesh = mds_apf_create(m,d,cap);
       isMatched = from->hasMatching();
+      threadPME = 0;
       apf::convert(from,this);
     }
     MeshMDS(gmi_model* m, const char* pathname)
@@ -124,6 +138,7 @@ class MeshMDS : public Mesh2
       init(apf::getLagrange(1));
       mesh = mds_read_smb(m, pathname);
       isMatched = PCU_Or(!mds_net_empty(&mesh->matches));
+      threadPME = 0;
     }
     ~MeshMDS()
     {
@@ -196,10 +211,7 @@ class MeshMDS : public Mesh2
     }
     int countUpward(MeshEntity* e)
     {
-      mds_set s;
-      mds_id id = fromEnt(e);
-      mds_get_adjacent(&(mesh->mds),id,mds_dim[mds_type(id)] + 1,&s);
-      return s.n;
+      return mds_count_up(&(mesh->mds),fromEnt(e));
     }
     MeshEntity* getUpward(MeshEntity* e, int i)
     {
@@ -252,18 +264,29 @@ class MeshMDS : public Mesh2
     }
     void getRemotes(MeshEntity* e, Copies& remotes)
     {
-      if (!isShared(e))
-        return;
-      mds_copies* c = mds_get_copies(&mesh->remotes, fromEnt(e));
-      for (int i = 0; i < c->n; ++i)
-        remotes[c->c[i].p] = toEnt(c->c[i].e);
+      MdsCopies c = getRemotesView(e);
+      for (int i = 0; i < c.getSize(); ++i)
+        remotes[c.getPeer(i)] = c.getEntity(i);
     }
     void getResidence(MeshEntity* e, Parts& residence)
+    {
+      MdsParts p = getResidenceView(e);
+      residence.insert(p.begin(), p.end());
+    }
+    MdsCopies getRemotesView(MeshEntity* e)
+    {
+      MdsCopies c;
+      c.c = mds_get_copies(&mesh->remotes, fromEnt(e));
+      return c;
+    }
+    MdsParts getResidenceView(MeshEntity* e)
     {
       void* vp = mds_get_part(mesh, fromEnt(e));
       PME* p = static_cast<PME*>(vp);
-      for (size_t i = 0; i < p->ids.size(); ++i)
-        residence.insert(p->ids[i]);
+      MdsParts v;
+      v.n = p->ids.size();
+      v.ids = v.n ? &(p->ids[0]) : 0;
+      return v;
     }
     MeshTag* createDoubleTag(const char* name, int size)
     {
@@ -505,12 +528,19 @@ class MeshMDS : public Mesh2
         for (int i = 0; i < s.n; ++i)
           s.e[i] = fromEnt(down[i]);
       }
-      mds_id id = mds_apf_create_entity(
-          mesh, t, reinterpret_cast<gmi_ent*>(c), s.e);
+      gmi_ent* g = reinterpret_cast<gmi_ent*>(c);
+      mds_reservation* r = getReservation();
+      if (r) {
+        mds_id id = mds_apf_create_reserved(mesh, r, t, g, s.e);
+        addPMERefs(threadPME, 1);
+        mds_set_part(mesh, id, threadPME);
+        return toEnt(id);
+      }
+      mds_id id = mds_apf_create_entity(mesh, t, g, s.e);
       MeshEntity* e = toEnt(id);
-      apf::Parts r;
-      r.insert(getId());
-      setResidence(e, r);
+      apf::Parts res;
+      res.insert(getId());
+      setResidence(e, res);
       return e;
     }
     void destroy_(MeshEntity* e)
@@ -518,9 +548,51 @@ class MeshMDS : public Mesh2
       mds_id id = fromEnt(e);
       void* ovp = mds_get_part(mesh, id);
       PME* op = static_cast<PME*>(ovp);
+      mds_reservation* r = getReservation();
+      if (r) {
+        addPMERefs(op, -1);
+        mds_apf_destroy_reserved(mesh, r, id);
+        return;
+      }
       putPME(parts, op);
       mds_apf_destroy_entity(mesh,id);
     }
+    mds_reservation* getReservation()
+    {
+      if (reservations.empty())
+        return 0;
+      int i = PCU_Work_Thread();
+      assert(i < static_cast<int>(reservations.size()));
+      return &reservations[i];
+    }
+    bool reserveThreads(int n, int const* counts)
+    {
+      assert(reservations.empty());
+      mds_id count[MDS_TYPES];
+      for (int t = 0; t < TYPES; ++t)
+        count[apf2mds(t)] = counts[t];
+      reservations.resize(n);
+      for (int i = 0; i < n; ++i)
+        mds_apf_reserve(mesh, &reservations[i], count);
+      apf::Parts res;
+      res.insert(getId());
+      threadPME = getPME(parts, res);
+      return true;
+    }
+    void commitThreads()
+    {
+      for (size_t i = 0; i < reservations.size(); ++i)
+        mds_commit(&mesh->mds, &reservations[i]);
+      reservations.clear();
+      putPME(parts, threadPME);
+      threadPME = 0;
+      PM::iterator it = parts.begin();
+      while (it != parts.end())
+        if (!it->refs)
+          parts.erase(it++);
+        else
+          ++it;
+    }
     bool hasMatching()
     {
       return isMatched;
@@ -561,9 +633,28 @@ class MeshMDS : public Mesh2
       };
       return table[type];
     }
+    bool hasDenseIndices()
+    {
+      for (int t = 0; t < MDS_TYPES; ++t)
+        if (mesh->mds.end[t] != mesh->mds.n[t])
+          return false;
+      return true;
+    }
+    long getDenseIndex(MeshEntity* e)
+    {
+      long i = 0;
+      mds_id id = fromEnt(e);
+      int type = mds_type(id);
+      for (int t = 0; t < type; ++t)
+        if (mds_dim[t] == mds_dim[type])
+          i += mesh->mds.n[t];
+      return i + mds_index(id);
+    }
     mds_apf* mesh;
     PM parts;
     bool isMatched;
+    std::vector<mds_reservation> reservations;
+    PME* threadPME;
 };
 
 Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched)
@@ -613,10 +704,55 @@ Mesh2* loadMdsMesh(const char* modelfile, const char* meshfile)
   return loadMdsMesh(model, meshfile);
 }
 
-void reorderMdsMesh(Mesh2* mesh)
+void setSmbPartsPerFile(int n)
+{
+  mds_set_smb_parts_per_file(n);
+}
+
+void setSmbThreads(int n)
+{
+  mds_set_smb_threads(n);
+}
+
+void reorderMdsMesh(Mesh2* mesh, MdsOrdering ordering)
 {
   MeshMDS* m = static_cast<MeshMDS*>(mesh);
-  m->mesh = mds_reorder(m->mesh);
+  /* frozen fields may be addressed by entity index */
+  m->requireUnfrozen();
+  bool wasFrozen = m->mesh->mds.frozen;
+  m->mesh = mds_reorder(m->mesh, ordering);
+  if (wasFrozen)
+    mds_freeze_up(&(m->mesh->mds));
+}
+
+void setReorderThreads(int n)
+{
+  mds_set_order_threads(n);
+}
+
+MdsLocality measureMdsLocality(Mesh2* in)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  mds_locality l;
+  mds_measure_locality(&(m->mesh->mds), &l);
+  MdsLocality r;
+  r.edgeDistance = l.edge_distance;
+  r.elementDistance = l.element_distance;
+  r.elementSpread = l.element_spread;
+  r.missRate = l.miss_rate;
+  return r;
+}
+
+void freezeMdsUpward(Mesh2* in)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  mds_freeze_up(&(m->mesh->mds));
+}
+
+bool isMdsUpwardFrozen(Mesh2* in)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  return m->mesh->mds.frozen;
 }
 
 static MeshTag* cloneTag(Mesh2* from, MeshTag* t, Mesh2* onto)
@@ -707,27 +843,46 @@ void deriveMdsModel(Mesh2* in)
   return mds_derive_model(m->mesh);
 }
 
+int MdsCopies::getSize() const
+{
+  return c ? c->n : 0;
+}
+
+int MdsCopies::getPeer(int i) const
+{
+  return c->c[i].p;
+}
+
+MeshEntity* MdsCopies::getEntity(int i) const
+{
+  return toEnt(c->c[i].e);
+}
+
+MdsParts getMdsResidence(Mesh2* in, MeshEntity* e)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  return m->getResidenceView(e);
+}
+
+MdsCopies getMdsRemotes(Mesh2* in, MeshEntity* e)
+{
+  MeshMDS* m = static_cast<MeshMDS*>(in);
+  return m->getRemotesView(e);
+}
+
 void changeMdsDimension(Mesh2* in, int d)
 {
   MeshMDS* m = static_cast<MeshMDS*>(in);
   return mds_change_dimension(&(m->mesh->mds), d);
 }
 
-int getMdsIndex(Mesh2* in, MeshEntity* e)
+long getMdsIndex(Mesh2* in, MeshEntity* e)
 {
   MeshMDS* m = static_cast<MeshMDS*>(in);
-  mds* mds = &(m->mesh->mds);
-  int i = 0;
-  mds_id id = fromEnt(e);
-  int type = mds_type(id);
-  for (int t = 0; t < type; ++t)
-    if (mds_dim[t] == mds_dim[type])
-      i += mds->n[t];
-  i += mds_index(id);
-  return i;
+  return m->getDenseIndex(e);
 }
 
-MeshEntity* getMdsEntity(Mesh2* in, int dimension, int index)
+MeshEntity* getMdsEntity(Mesh2* in, int dimension, long index)
 {
   MeshMDS* m = static_cast<MeshMDS*>(in);
   mds* mds = &(m->mesh->mds);
@@ -31,6 +31,7 @@
   \brief Interface to the compact Mesh Data Structure */
 
 struct gmi_model;
+struct mds_copies;
 
 namespace apf {
 
@@ -56,12 +57,29 @@ Mesh2* makeEmptyMdsMesh(gmi_model* model, int dim, bool isMatched);
                   If the path is "something/", then the
                   file "something/N.smb" will be loaded.
                   For both of these cases, if the path is
-                  prepended with "bz2:", then it will be uncompressed
-                  using PCU file IO functions.
+                  prepended with "bz2:" or "zst:", then it will be
+                  uncompressed using PCU file IO functions,
+                  see apf::setSmbThreads.
+                  If instead the path is prepended with "agg:",
+                  groups of parts share one file "somethingG.smb",
+                  see apf::setSmbPartsPerFile.
                   Calling apf::Mesh::writeNative on the
                   resulting object will do the same in reverse. */
 Mesh2* loadMdsMesh(gmi_model* model, const char* meshfile);
 
+/** \brief set how many parts share a file when writing "agg:" paths
+  \details the first part of each group gathers the others' data
+  and is the only one to open the file, which keeps file system
+  metadata traffic low at large part counts.
+  The default is 2048. Reading uses the grouping found in the files. */
+void setSmbPartsPerFile(int n);
+
+/** \brief set how many threads compress and uncompress SMB files
+  \details "bz2:" and "zst:" files are made of blocks that
+  PCU_Work_Run workers handle at once. The default is 1.
+  "zst:" needs PCU built with PCU_ZSTD=ON. */
+void setSmbThreads(int n);
+
 /** \brief load an MDS mesh and model from file
   \param modelfile will be passed to gmi_load to get the model */
 Mesh2* loadMdsMesh(const char* modelfile, const char* meshfile);
@@ -71,14 +89,75 @@ Mesh2* loadMdsMesh(const char* modelfile, const char* meshfile);
   \details this function uses apf::convert to copy any apf::Mesh */
 Mesh2* createMdsMesh(gmi_model* model, Mesh* from);
 
+/** \brief entity orderings for apf::reorderMdsMesh */
+enum MdsOrdering
+{
+  /** \brief breadth-first traversal of adjacencies */
+  MDS_BREADTH_FIRST,
+  /** \brief along a Hilbert curve through entity centroids */
+  MDS_HILBERT,
+  /** \brief along a Morton (Z-order) curve through entity centroids */
+  MDS_MORTON
+};
+
 /** \brief apply adjacency-based reordering
-  \details similar to the algorithm for apf::reorder,
+  \details by default, similar to the algorithm for apf::reorder,
            this function will traverse adjacencies to reorder
            each topological type.
+           The space-filling curve orderings instead sort each
+           type by the curve position of its vertex centroid,
+           which ignores connectivity but follows the geometry.
            Then all MDS arrays are re-formed in this new order.
            An important side effect of this function is that
-           there are no gaps in the MDS arrays after this */
-void reorderMdsMesh(Mesh2* mesh);
+           there are no gaps in the MDS arrays after this.
+           If upward adjacencies were frozen by apf::freezeMdsUpward,
+           they are frozen again in the new order.
+  \param ordering one of apf::MdsOrdering */
+void reorderMdsMesh(Mesh2* mesh, MdsOrdering ordering = MDS_BREADTH_FIRST);
+
+/** \brief set how many threads sort the space-filling curve keys
+  \details the radix sort of apf::reorderMdsMesh splits its digit
+  counting and scattering over PCU_Work_Run workers.
+  The default is 1. */
+void setReorderThreads(int n);
+
+/** \brief how close an MDS ordering keeps neighbors
+  \details all distances are differences of apf::getMdsIndex
+  values, averaged over the local part. */
+struct MdsLocality
+{
+  /** \brief mean distance between the vertices of an edge */
+  double edgeDistance;
+  /** \brief mean distance between elements sharing a side */
+  double elementDistance;
+  /** \brief mean spread of vertex indices within an element */
+  double elementSpread;
+  /** \brief fraction of vertex reads in an element loop that miss
+    a small simulated cache, a proxy for real cache misses */
+  double missRate;
+};
+
+/** \brief measure the locality of the current MDS ordering
+  \details use this to compare the apf::MdsOrdering choices
+  on a given mesh. */
+MdsLocality measureMdsLocality(Mesh2* in);
+
+/** \brief store upward adjacencies in compressed arrays
+  \details by default MDS keeps upward adjacencies as
+  linked lists threaded through its arrays.
+  This function copies them into contiguous offset and
+  index arrays, so that upward queries such as
+  apf::Mesh::getUp and apf::Mesh::countUpward become
+  linear scans.
+  It is best called after apf::reorderMdsMesh on a mesh
+  that will not be modified for a while.
+  Any entity creation or destruction drops the compressed
+  arrays and MDS falls back to the linked lists until
+  this function is called again. */
+void freezeMdsUpward(Mesh2* in);
+
+/** \brief returns true while apf::freezeMdsUpward arrays are in use */
+bool isMdsUpwardFrozen(Mesh2* in);
 
 /** \brief split an MDS mesh into multiple parts per process using threads
   \param m the MDS mesh
@@ -114,7 +193,7 @@ void changeMdsDimension(Mesh2* in, int d);
 /** \brief returns the dimension-unique index for this entity
  \details this function only works when the arrays have no gaps,
  so call apf::reorderMdsMesh after any mesh modification. */
-int getMdsIndex(Mesh2* in, MeshEntity* e);
+long getMdsIndex(Mesh2* in, MeshEntity* e);
 
 /** \brief retrieve an entity by dimension and index
   \details indices follow iteration order, so this
@@ -122,7 +201,43 @@ int getMdsIndex(Mesh2* in, MeshEntity* e);
   but is actually much faster than that.
   this function only works when the arrays have no gaps,
   so call apf::reorderMdsMesh after any mesh modification. */
-MeshEntity* getMdsEntity(Mesh2* in, int dimension, int index);
+MeshEntity* getMdsEntity(Mesh2* in, int dimension, long index);
+
+/** \brief a read-only view of an MDS entity's residence
+  \details the part ids are sorted and point directly
+  into the MDS partition model, so the view is only valid
+  until the residence of some entity in the mesh changes. */
+struct MdsParts
+{
+  int const* ids;
+  int n;
+  int const* begin() const {return ids;}
+  int const* end() const {return ids + n;}
+};
+
+/** \brief a read-only view of an MDS entity's remote copies
+  \details this reads directly from the MDS remote copy
+  storage, so the view is only valid until the remote copies
+  of this entity change. */
+class MdsCopies
+{
+  public:
+    MdsCopies():c(0) {}
+    int getSize() const;
+    int getPeer(int i) const;
+    MeshEntity* getEntity(int i) const;
+    mds_copies const* c;
+};
+
+/** \brief get the residence of an MDS entity without copying
+  \details this is the same as apf::Mesh::getResidence,
+  but without building an apf::Parts */
+MdsParts getMdsResidence(Mesh2* in, MeshEntity* e);
+
+/** \brief get the remote copies of an MDS entity without copying
+  \details this is the same as apf::Mesh::getRemotes,
+  but without building an apf::Copies */
+MdsCopies getMdsRemotes(Mesh2* in, MeshEntity* e);
 
 Mesh2* loadMdsFromGmsh(gmi_model* g, const char* filename);
 
@@ -8,8 +8,9 @@
 
 *******************************************************************************/
 
-#include "mds.h"
+#include "mds_up.h"
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
@@ -30,8 +31,6 @@ static void* mds_realloc(void* p, size_t n)
 #define REALLOC(p,n) ((p)=mds_realloc(p,(n)*sizeof(*(p))))
 #define ZERO(o) memset(&(o),0,sizeof(o))
 
-#define MDS_LIVE -2
-
 int const mds_dim[MDS_TYPES] =
 {0 /* MDS_VERTEX */
 ,1 /* MDS_EDGE */
@@ -229,6 +228,7 @@ static void alloc_adjacency(struct mds* m, int from_dim, int to_dim)
 void mds_remove_adjacency(struct mds* m, int from_dim, int to_dim)
 {
   mds_id zero_cap[MDS_TYPES] = {0};
+  mds_thaw_up(m);
   resize_adjacency(m,from_dim,to_dim,m->cap,zero_cap);
   m->mrm[from_dim][to_dim] = 0;
 }
@@ -276,16 +276,13 @@ void mds_destroy(struct mds* m)
 {
   int i;
   mds_id old_cap[MDS_TYPES];
+  mds_thaw_up(m);
   for (i = 0; i < MDS_TYPES; ++i)
     old_cap[i] = m->cap[i];
   ZERO(m->cap);
   resize(m,old_cap);
 }
 
-#define ID(t,i) ((i)*MDS_TYPES + (t))
-#define TYPE(id) ((id) % MDS_TYPES)
-#define INDEX(id) ((id) / MDS_TYPES)
-
 int mds_type(mds_id e)
 {
   return TYPE(e);
@@ -321,101 +318,10 @@ static void relate_down(struct mds* m, mds_id from, mds_id* to)
     *at_id(m->down[to_dim],ID(t,i * deg + j)) = to[j];
 }
 
-static void relate_up(struct mds* m, mds_id e, mds_id node)
-{
-  int node_dim;
-  int e_dim;
-  mds_id* head;
-  mds_id* nodep;
-  e_dim = mds_dim[TYPE(e)];
-  node_dim = mds_dim[TYPE(node)];
-  head = at_id(m->first_up[node_dim],e);
-  nodep = at_id(m->up[e_dim],node);
-  *nodep = *head;
-  *head = node;
-}
-
-static void unrelate_up(struct mds* m, mds_id e, mds_id node)
-{
-  int node_dim;
-  int e_dim;
-  mds_id* prev;
-  e_dim = mds_dim[TYPE(e)];
-  node_dim = mds_dim[TYPE(node)];
-  prev = at_id(m->first_up[node_dim],e);
-  while (*prev != node)
-    prev = at_id(m->up[e_dim],*prev);
-  *prev = *at_id(m->up[e_dim],node);
-}
-
-static void relate_back_up(struct mds* m, mds_id* from, mds_id to)
-{
-  int t;
-  mds_id i;
-  int j;
-  int deg;
-  int from_dim;
-  mds_id x;
-  t = TYPE(to);
-  i = INDEX(to);
-  from_dim = mds_dim[TYPE(from[0])];
-  deg = mds_degree[t][from_dim];
-  for (j = 0; j < deg; ++j) {
-    x = ID(t, i * deg + j);
-    relate_up(m,from[j],x);
-  }
-}
-
-static void unrelate_back_up(struct mds* m, mds_id* from, mds_id to)
-{
-  int t;
-  mds_id i;
-  int j;
-  int deg;
-  int from_dim;
-  mds_id x;
-  t = TYPE(to);
-  i = INDEX(to);
-  from_dim = mds_dim[TYPE(from[0])];
-  deg = mds_degree[t][from_dim];
-  for (j = 0; j < deg; ++j) {
-    x = ID(t, i * deg + j);
-    unrelate_up(m,from[j],x);
-  }
-}
-
 static void relate_both(struct mds* m, mds_id* down, mds_id up)
 {
   relate_down(m,up,down);
-  relate_back_up(m,down,up);
-}
-
-static void look_up(struct mds* m, mds_id const e, int d, struct mds_set* s)
-{
-  mds_id* n;
-  mds_id nv;
-  int t;
-  mds_id i;
-  int deg;
-  mds_id* es = s->e;
-  mds_id** p;
-  t = TYPE(e);
-  i = INDEX(e);
-  p = m->first_up[d];
-  n = p[t] + i;
-  nv = *n;
-  d = mds_dim[t];
-  p = m->up[d];
-  while (nv != MDS_NONE) {
-    t = TYPE(nv);
-    i = INDEX(nv);
-    deg = mds_degree[t][d];
-    *es = ID(t, i / deg);
-    ++es;
-    n = p[t] + i;
-    nv = *n;
-  }
-  s->n = es - s->e;
+  mds_relate_up(m,down,up);
 }
 
 struct down {
@@ -454,7 +360,7 @@ static void look(struct mds* m, mds_id e, int d, struct mds_set* s)
   } else if (from_dim == d) {
     s->n = 1; s->e[0] = e;
   } else {
-    look_up(m,e,d,s);
+    mds_look_up(m,e,d,s);
   }
 }
 
@@ -520,9 +426,9 @@ static mds_id common_up(struct mds* m, struct mds_set* s, int d)
   for (i = 0; i < s->n; ++i)
     if (s->e[i] == MDS_NONE)
       return MDS_NONE;
-  look_up(m,s->e[0],d,&found);
+  mds_look_up(m,s->e[0],d,&found);
   for (i = 1; i < s->n; ++i) {
-    look_up(m,s->e[i],d,&adjacent);
+    mds_look_up(m,s->e[i],d,&adjacent);
     intersect(&found,&adjacent);
   }
   assert(found.n <= 1);
@@ -554,9 +460,32 @@ static mds_id fill_hole(struct mds* m, int t)
   return ID(t,i);
 }
 
-static mds_id alloc_ent(struct mds* m, int t)
+/* a reservation is a private free list of slots that were
+   taken out of the shared one by mds_reserve.
+   It is chained through the same m->free arrays, which is safe
+   because each slot belongs to exactly one list. */
+static mds_id alloc_reserved(struct mds* m, int t,
+    struct mds_reservation* r)
+{
+  mds_id i;
+  assert(!m->frozen);
+  i = r->first_free[t];
+  if (i == MDS_NONE) {
+    fprintf(stderr,"mds: reservation for type %d is exhausted\n",t);
+    abort();
+  }
+  r->first_free[t] = m->free[t][i];
+  m->free[t][i] = MDS_LIVE;
+  ++(r->n[t]);
+  return ID(t,i);
+}
+
+static mds_id alloc_ent(struct mds* m, int t, struct mds_reservation* r)
 {
   mds_id id;
+  if (r)
+    return alloc_reserved(m,t,r);
+  mds_thaw_up(m);
   if (m->n[t] == m->cap[t])
     grow(m,t);
   ++(m->n[t]);
@@ -572,7 +501,7 @@ static mds_id alloc_ent(struct mds* m, int t)
   return id;
 }
 
-static void free_ent(struct mds* m, mds_id e)
+static void free_ent(struct mds* m, mds_id e, struct mds_reservation* r)
 {
   mds_id *head;
   mds_id *node;
@@ -580,30 +509,38 @@ static void free_ent(struct mds* m, mds_id e)
   mds_id i;
   t = TYPE(e);
   i = INDEX(e);
-  head = &(m->first_free[t]);
+  if (r) {
+    assert(!m->frozen);
+    head = &(r->first_free[t]);
+    --(r->n[t]);
+  } else {
+    mds_thaw_up(m);
+    head = &(m->first_free[t]);
+    --(m->n[t]);
+  }
   node = &(m->free[t][i]);
   *node = *head;
   *head = i;
-  --(m->n[t]);
 }
 
-static mds_id add_ent(struct mds* m, int t, mds_id* from)
+static mds_id add_ent(struct mds* m, int t, mds_id* from,
+    struct mds_reservation* r)
 {
   mds_id id;
-  id = alloc_ent(m,t);
+  id = alloc_ent(m,t,r);
   relate_both(m,from,id);
   return id;
 }
 
 static mds_id add_or_find_ent(struct mds* m, int t, struct mds_set* from,
-    int can_add)
+    int can_add, struct mds_reservation* r)
 {
   mds_id id;
   id = common_up(m,from,mds_dim[t]);
   if (id != MDS_NONE)
     return id;
   if (can_add)
-    return add_ent(m,t,from->e);
+    return add_ent(m,t,from->e,r);
   return MDS_NONE;
 }
 
@@ -623,21 +560,26 @@ static void unrelate_ent(struct mds* m, mds_id e)
 {
   struct mds_set down;
   look_down(m,e,mds_dim[TYPE(e)] - 1,&down);
-  unrelate_back_up(m,down.e,e);
+  mds_unrelate_up(m,down.e,e);
 }
 
-void mds_destroy_entity(struct mds* m, mds_id e)
+static void destroy_ent(struct mds* m, mds_id e, struct mds_reservation* r)
 {
   check_ent(m,e);
   if (TYPE(e) != MDS_VERTEX)
     unrelate_ent(m,e);
-  free_ent(m,e);
+  free_ent(m,e,r);
+}
+
+void mds_destroy_entity(struct mds* m, mds_id e)
+{
+  destroy_ent(m,e,NULL);
 }
 
 static void step_up(struct mds* m,
     struct mds_set* from_s, int from_dim,
     struct mds_set* to_s, int to_dim,
-    int t, int make)
+    int t, int make, struct mds_reservation* r)
 {
   struct mds_set s;
   int i;
@@ -655,7 +597,7 @@ static void step_up(struct mds* m,
       s.e[j] = from_s->e[*ci];
       ++ci;
     }
-    to_s->e[i] = add_or_find_ent(m,tt,&s,make);
+    to_s->e[i] = add_or_find_ent(m,tt,&s,make,r);
     ++ct;
   }
 }
@@ -681,7 +623,7 @@ static void step_down(struct mds* m,
 static void convert_up(struct mds* m,
     struct mds_set* from_s, int from_dim,
     struct mds_set* to_s, int to_dim,
-    int t, int make)
+    int t, int make, struct mds_reservation* r)
 {
   struct mds_set sets[2];
   struct mds_set* s[2];
@@ -690,7 +632,7 @@ static void convert_up(struct mds* m,
   s[1] = sets + 1;
   copy_set(s[0],from_s);
   for (; from_dim != to_dim; ++from_dim) {
-    step_up(m,s[0],from_dim,s[1],from_dim + 1,t,make);
+    step_up(m,s[0],from_dim,s[1],from_dim + 1,t,make,r);
     tmp = s[0];
     s[0] = s[1];
     s[1] = tmp;
@@ -730,18 +672,20 @@ static void check_set(struct mds* m, struct mds_set* s)
     assert(dim == mds_dim[TYPE(s->e[i])]);
 }
 
-static mds_id get_ent_far(struct mds* m, int t, struct mds_set* in, int make)
+static mds_id get_ent_far(struct mds* m, int t, struct mds_set* in,
+    int make, struct mds_reservation* r)
 {
   int from_dim;
   int to_dim;
   struct mds_set down;
   from_dim = mds_dim[TYPE(in->e[0])];
   to_dim = mds_dim[t];
-  convert_up(m,in,from_dim,&down,to_dim - 1,t,make);
-  return add_or_find_ent(m,t,&down,make);
+  convert_up(m,in,from_dim,&down,to_dim - 1,t,make,r);
+  return add_or_find_ent(m,t,&down,make,r);
 }
 
-static mds_id get_ent(struct mds* m, int t, mds_id* from, int make)
+static mds_id get_ent(struct mds* m, int t, mds_id* from, int make,
+    struct mds_reservation* r)
 {
   int from_dim;
   int to_dim;
@@ -756,20 +700,131 @@ static mds_id get_ent(struct mds* m, int t, mds_id* from, int make)
   to_dim = mds_dim[t];
   assert(from_dim < to_dim);
   if (from_dim + 1 == to_dim)
-    return add_or_find_ent(m,t,&in,make);
-  return get_ent_far(m,t,&in,make);
+    return add_or_find_ent(m,t,&in,make,r);
+  return get_ent_far(m,t,&in,make,r);
 }
 
 mds_id mds_create_entity(struct mds* m, int t, mds_id* from)
 {
   if (t == MDS_VERTEX)
-    return alloc_ent(m,t);
-  return get_ent(m,t,from,1);
+    return alloc_ent(m,t,NULL);
+  return get_ent(m,t,from,1,NULL);
 }
 
 mds_id mds_find_entity(struct mds* m, int t, mds_id* from)
 {
-  return get_ent(m,t,from,0);
+  return get_ent(m,t,from,0,NULL);
+}
+
+/* appends n entities of type t, where from holds the one-level-down
+   adjacent entities of each one in order (NULL for vertices).
+   Unlike mds_create_entity, this does not search for an
+   existing entity with the same boundary, so it is only
+   for inputs known to be free of duplicates, such as files. */
+void mds_create_entities(struct mds* m, int t, mds_id n, mds_id* from)
+{
+  int i;
+  int deg;
+  mds_id j;
+  mds_id first;
+  mds_id old_cap[MDS_TYPES];
+  mds_thaw_up(m);
+  assert(m->first_free[t] == MDS_NONE);
+  first = m->end[t];
+  if (first + n > m->cap[t]) {
+    for (i = 0; i < MDS_TYPES; ++i)
+      old_cap[i] = m->cap[i];
+    m->cap[t] = first + n;
+    resize(m,old_cap);
+  }
+  for (j = 0; j < n; ++j)
+    m->free[t][first + j] = MDS_LIVE;
+  m->n[t] += n;
+  m->end[t] += n;
+  if (t == MDS_VERTEX)
+    return;
+  deg = mds_degree[t][mds_dim[t] - 1];
+  for (j = 0; j < n; ++j)
+    relate_both(m,from + j * deg,ID(t,first + j));
+}
+
+/* moves count[t] free slots of each type into the reservation,
+   reusing holes before growing the arrays.
+   This is the only step that may reallocate, so after it
+   several threads holding separate reservations can create
+   and destroy entities without touching shared allocation state. */
+void mds_reserve(struct mds* m, struct mds_reservation* r,
+    mds_id count[MDS_TYPES])
+{
+  int t;
+  mds_id i;
+  mds_id k;
+  mds_id fresh[MDS_TYPES];
+  mds_id old_cap[MDS_TYPES];
+  int grew = 0;
+  mds_thaw_up(m);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    r->first_free[t] = MDS_NONE;
+    r->n[t] = 0;
+    for (k = 0; k < count[t] && m->first_free[t] != MDS_NONE; ++k) {
+      i = m->first_free[t];
+      m->first_free[t] = m->free[t][i];
+      m->free[t][i] = r->first_free[t];
+      r->first_free[t] = i;
+    }
+    fresh[t] = count[t] - k;
+    old_cap[t] = m->cap[t];
+    if (m->end[t] + fresh[t] > m->cap[t]) {
+      m->cap[t] = ((m->cap[t] + 2) * 3) / 2;
+      if (m->end[t] + fresh[t] > m->cap[t])
+        m->cap[t] = m->end[t] + fresh[t];
+      grew = 1;
+    }
+  }
+  if (grew)
+    resize(m,old_cap);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    /* push in reverse so that new entities come out in order */
+    for (i = m->end[t] + fresh[t] - 1; i >= m->end[t]; --i) {
+      m->free[t][i] = r->first_free[t];
+      r->first_free[t] = i;
+    }
+    m->end[t] += fresh[t];
+  }
+}
+
+mds_id mds_create_reserved(struct mds* m, struct mds_reservation* r,
+    int t, mds_id* from)
+{
+  if (t == MDS_VERTEX)
+    return alloc_ent(m,t,r);
+  return get_ent(m,t,from,1,r);
+}
+
+void mds_destroy_reserved(struct mds* m, struct mds_reservation* r,
+    mds_id e)
+{
+  destroy_ent(m,e,r);
+}
+
+/* counts what the reservation created and destroyed into
+   the mesh and returns its remaining slots to the shared free list */
+void mds_commit(struct mds* m, struct mds_reservation* r)
+{
+  int t;
+  mds_id i;
+  for (t = 0; t < MDS_TYPES; ++t) {
+    m->n[t] += r->n[t];
+    r->n[t] = 0;
+    i = r->first_free[t];
+    if (i == MDS_NONE)
+      continue;
+    while (m->free[t][i] != MDS_NONE)
+      i = m->free[t][i];
+    m->free[t][i] = m->first_free[t];
+    m->first_free[t] = r->first_free[t];
+    r->first_free[t] = MDS_NONE;
+  }
 }
 
 static void expand_once(struct mds* m, struct mds_set* from, struct mds_set* to)
@@ -781,7 +836,7 @@ static void expand_once(struct mds* m, struct mds_set* from, struct mds_set* to)
   assert(from->n);
   dim = mds_dim[TYPE(from->e[0])];
   for (i = 0; i < from->n; ++i) {
-    look_up(m,from->e[i],dim + 1,&up);
+    mds_look_up(m,from->e[i],dim + 1,&up);
     unite(to,&up);
   }
 }
@@ -874,13 +929,14 @@ void mds_add_adjacency(struct mds* m, int from_dim, int to_dim)
 {
   mds_id e;
   struct mds_set adj;
+  mds_thaw_up(m);
   alloc_adjacency(m,from_dim,to_dim);
   if (from_dim < to_dim)
     for (e = mds_begin(m,to_dim);
          e != MDS_NONE;
          e = mds_next(m,e)) {
       mds_get_adjacent(m,e,from_dim,&adj);
-      relate_back_up(m,adj.e,e);
+      mds_relate_up(m,adj.e,e);
     }
   else
     for (e = mds_begin(m,from_dim);
@@ -892,15 +948,6 @@ void mds_add_adjacency(struct mds* m, int from_dim, int to_dim)
   m->mrm[from_dim][to_dim] = 1;
 }
 
-int mds_has_up(struct mds* m, mds_id e)
-{
-  int d;
-  d = mds_dim[TYPE(e)];
-  if (d == m->d)
-    return 0;
-  return *at_id(m->first_up[d + 1],e) != MDS_NONE;
-}
-
 static void increase_dimension(struct mds* m)
 {
   int old_d;
@@ -40,6 +40,16 @@ struct mds {
   mds_id* first_up[4][MDS_TYPES];
   mds_id* free[MDS_TYPES];
   mds_id first_free[MDS_TYPES];
+  /* compressed upward adjacency, see mds_freeze_up */
+  int frozen;
+  mds_id* frozen_first[4][MDS_TYPES];
+  mds_id* frozen_up[4][MDS_TYPES];
+};
+
+/* free entity slots set aside for one thread, see mds_reserve */
+struct mds_reservation {
+  mds_id first_free[MDS_TYPES];
+  mds_id n[MDS_TYPES];
 };
 
 struct mds_set {
@@ -56,6 +66,7 @@ void mds_destroy(struct mds* m);
 mds_id mds_create_entity(struct mds* m, int type, mds_id *from);
 void mds_destroy_entity(struct mds* m, mds_id e);
 mds_id mds_find_entity(struct mds* m, int type, mds_id *from);
+void mds_create_entities(struct mds* m, int type, mds_id n, mds_id* from);
 int mds_type(mds_id e);
 mds_id mds_index(mds_id e);
 mds_id mds_identify(int type, mds_id idx);
@@ -67,7 +78,19 @@ void mds_add_adjacency(struct mds* m, int from_dim, int to_dim);
 void mds_remove_adjacency(struct mds* m, int from_dim, int to_dim);
 
 int mds_has_up(struct mds* m, mds_id e);
+int mds_count_up(struct mds* m, mds_id e);
+
+void mds_freeze_up(struct mds* m);
+void mds_thaw_up(struct mds* m);
 
 void mds_change_dimension(struct mds* m, int d);
 
+void mds_reserve(struct mds* m, struct mds_reservation* r,
+    mds_id count[MDS_TYPES]);
+mds_id mds_create_reserved(struct mds* m, struct mds_reservation* r,
+    int type, mds_id* from);
+void mds_destroy_reserved(struct mds* m, struct mds_reservation* r,
+    mds_id e);
+void mds_commit(struct mds* m, struct mds_reservation* r);
+
 #endif
@@ -64,42 +64,61 @@ struct gmi_ent* mds_apf_model(struct mds_apf* m, mds_id e)
   return m->model[mds_type(e)][mds_index(e)];
 }
 
-mds_id mds_apf_create_entity(
-    struct mds_apf* m, int type, struct gmi_ent* model, mds_id* from)
+static void grow_arrays(struct mds_apf* m, mds_id old_cap[MDS_TYPES])
 {
   int t;
-  mds_id old_cap[MDS_TYPES];
-  mds_id e;
-  mds_id i;
-  old_cap[type] = m->mds.cap[type];
-  e = mds_create_entity(&(m->mds),type,from);
-  i = mds_index(e);
-  if (m->mds.cap[type] != old_cap[type]) {
-    for (t = 0; t < MDS_TYPES; ++t)
-      if (t != type)
-        old_cap[t] = m->mds.cap[t];
-    mds_grow_tags(&(m->tags),&(m->mds),old_cap);
-    if (type == MDS_VERTEX) {
-      m->point = realloc(m->point,m->mds.cap[type] * sizeof(*(m->point)));
-      m->param = realloc(m->param,m->mds.cap[type] * sizeof(*(m->param)));
+  mds_grow_tags(&(m->tags),&(m->mds),old_cap);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    if (m->mds.cap[t] == old_cap[t])
+      continue;
+    if (t == MDS_VERTEX) {
+      m->point = realloc(m->point,m->mds.cap[t] * sizeof(*(m->point)));
+      m->param = realloc(m->param,m->mds.cap[t] * sizeof(*(m->param)));
     }
-    m->model[type] = realloc(m->model[type],
-        m->mds.cap[type] * sizeof(*(m->model[type])));
-    m->parts[type] = realloc(m->parts[type],
-        m->mds.cap[type] * sizeof(*(m->parts[type])));
-    mds_grow_net(&m->remotes, &m->mds, old_cap);
-    mds_grow_net(&m->matches, &m->mds, old_cap);
+    m->model[t] = realloc(m->model[t],
+        m->mds.cap[t] * sizeof(*(m->model[t])));
+    m->parts[t] = realloc(m->parts[t],
+        m->mds.cap[t] * sizeof(*(m->parts[t])));
   }
+  mds_grow_net(&m->remotes, &m->mds, old_cap);
+  mds_grow_net(&m->matches, &m->mds, old_cap);
+}
+
+static void get_caps(struct mds_apf* m, mds_id cap[MDS_TYPES])
+{
+  int t;
+  for (t = 0; t < MDS_TYPES; ++t)
+    cap[t] = m->mds.cap[t];
+}
+
+static void init_entity(struct mds_apf* m, mds_id e, struct gmi_ent* model)
+{
+  int type;
+  mds_id i;
+  type = mds_type(e);
+  i = mds_index(e);
   m->model[type][i] = model;
   m->parts[type][i] = NULL;
   if (type == MDS_VERTEX) {
     m->point[i][0] = m->point[i][1] = m->point[i][2] = 0;
     m->param[i][0] = m->param[i][1] = 0;
   }
+}
+
+mds_id mds_apf_create_entity(
+    struct mds_apf* m, int type, struct gmi_ent* model, mds_id* from)
+{
+  mds_id old_cap[MDS_TYPES];
+  mds_id e;
+  get_caps(m,old_cap);
+  e = mds_create_entity(&(m->mds),type,from);
+  if (m->mds.cap[type] != old_cap[type])
+    grow_arrays(m,old_cap);
+  init_entity(m,e,model);
   return e;
 }
 
-void mds_apf_destroy_entity(struct mds_apf* m, mds_id e)
+static void drop_entity(struct mds_apf* m, mds_id e)
 {
   struct mds_tag* t;
   for (t = m->tags.first; t; t = t->next)
@@ -107,9 +126,40 @@ void mds_apf_destroy_entity(struct mds_apf* m, mds_id e)
       mds_take_tag(t,e);
   mds_set_copies(&m->remotes, &m->mds, e, NULL);
   mds_set_copies(&m->matches, &m->mds, e, NULL);
+}
+
+void mds_apf_destroy_entity(struct mds_apf* m, mds_id e)
+{
+  drop_entity(m,e);
   mds_destroy_entity(&(m->mds),e);
 }
 
+void mds_apf_reserve(struct mds_apf* m, struct mds_reservation* r,
+    mds_id count[MDS_TYPES])
+{
+  mds_id old_cap[MDS_TYPES];
+  get_caps(m,old_cap);
+  mds_reserve(&(m->mds),r,count);
+  grow_arrays(m,old_cap);
+}
+
+mds_id mds_apf_create_reserved(struct mds_apf* m,
+    struct mds_reservation* r, int type, struct gmi_ent* model,
+    mds_id* from)
+{
+  mds_id e;
+  e = mds_create_reserved(&(m->mds),r,type,from);
+  init_entity(m,e,model);
+  return e;
+}
+
+void mds_apf_destroy_reserved(struct mds_apf* m,
+    struct mds_reservation* r, mds_id e)
+{
+  drop_entity(m,e);
+  mds_destroy_reserved(&(m->mds),r,e);
+}
+
 void* mds_get_part(struct mds_apf* m, mds_id e)
 {
   return m->parts[mds_type(e)][mds_index(e)];
@@ -45,11 +45,34 @@ struct gmi_ent* mds_apf_model(struct mds_apf* m, mds_id e);
 mds_id mds_apf_create_entity(
     struct mds_apf* m, int type, struct gmi_ent* model, mds_id* from);
 void mds_apf_destroy_entity(struct mds_apf* m, mds_id e);
+void mds_apf_reserve(struct mds_apf* m, struct mds_reservation* r,
+    mds_id count[MDS_TYPES]);
+mds_id mds_apf_create_reserved(struct mds_apf* m,
+    struct mds_reservation* r, int type, struct gmi_ent* model,
+    mds_id* from);
+void mds_apf_destroy_reserved(struct mds_apf* m,
+    struct mds_reservation* r, mds_id e);
 
 void* mds_get_part(struct mds_apf* m, mds_id e);
 void mds_set_part(struct mds_apf* m, mds_id e, void* p);
 
-struct mds_apf* mds_reorder(struct mds_apf* m);
+/* entity orderings for mds_reorder,
+   these match apf::MdsOrdering */
+#define MDS_ORDER_BFS 0
+#define MDS_ORDER_HILBERT 1
+#define MDS_ORDER_MORTON 2
+
+struct mds_apf* mds_reorder(struct mds_apf* m, int ordering);
+void mds_set_order_threads(int n);
+
+struct mds_locality {
+  double edge_distance;
+  double element_distance;
+  double element_spread;
+  double miss_rate;
+};
+
+void mds_measure_locality(struct mds* m, struct mds_locality* l);
 
 struct gmi_ent* mds_find_model(struct mds_apf* m, int dim, int id);
 int mds_model_dim(struct mds_apf* m, struct gmi_ent* model);
@@ -57,6 +80,8 @@ int mds_model_id(struct mds_apf* m, struct gmi_ent* model);
 
 struct mds_apf* mds_read_smb(struct gmi_model* model, const char* pathname);
 struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname);
+void mds_set_smb_parts_per_file(int n);
+void mds_set_smb_threads(int n);
 
 void mds_verify(struct mds_apf* m);
 void mds_verify_residence(struct mds_apf* m, mds_id e);
@@ -144,8 +144,8 @@ static int insert_peer(struct mds_links* ln, int p)
   i = ln->np;
   ++(ln->np);
   ln->p = realloc(ln->p, ln->np * sizeof(unsigned));
-  ln->n = realloc(ln->n, ln->np * sizeof(unsigned));
-  ln->l = realloc(ln->l, ln->np * sizeof(unsigned*));
+  ln->n = realloc(ln->n, ln->np * sizeof(mds_id));
+  ln->l = realloc(ln->l, ln->np * sizeof(mds_id*));
   ln->p[i] = p;
   ln->n[i] = 0;
   ln->l[i] = NULL;
@@ -186,7 +186,7 @@ static void alloc_links(struct mds_links* ln)
 {
   unsigned i;
   for (i = 0; i < ln->np; ++i)
-    ln->l[i] = malloc(ln->n[i] * sizeof(unsigned));
+    ln->l[i] = malloc(ln->n[i] * sizeof(mds_id));
 }
 
 static void take_remote_link(mds_id i, struct mds_copy c, void* u)
@@ -214,7 +214,7 @@ static void recv_links(struct mds_links* ln)
   int from;
   mds_id* tmp;
   int pi;
-  unsigned i;
+  mds_id i;
   from = PCU_Comm_Sender();
   pi = find_peer(ln, from);
   tmp = PCU_Comm_Extract(ln->n[pi] * sizeof(mds_id));
@@ -248,8 +248,8 @@ void mds_set_type_links(struct mds_net* net, struct mds* m,
     int t, struct mds_links* ln)
 {
   unsigned i;
-  unsigned j;
-  unsigned* in;
+  mds_id j;
+  mds_id* in;
   struct mds_copy c;
   PCU_Comm_Begin();
   for (i = 0; i < ln->np; ++i)
@@ -260,7 +260,7 @@ void mds_set_type_links(struct mds_net* net, struct mds* m,
     c.p = PCU_Comm_Sender();
     assert(c.p != PCU_Comm_Self());
     i = find_peer(ln, c.p);
-    in = PCU_Comm_Extract(ln->n[i] * sizeof(unsigned));
+    in = PCU_Comm_Extract(ln->n[i] * sizeof(mds_id));
     for (j = 0; j < ln->n[i]; ++j) {
       c.e = mds_identify(t, in[j]);
       mds_add_copy(net, m, mds_identify(t, ln->l[i][j]), c);
@@ -322,8 +322,8 @@ void mds_get_local_matches(struct mds_net* net, struct mds* m,
     return;
   other = find_peer(ln, PCU_Comm_Peers());
   assert(ln->n[self] == ln->n[other]);
-  ln->l[self] = malloc(ln->n[self] * sizeof(unsigned));
-  ln->l[other] = malloc(ln->n[other] * sizeof(unsigned));
+  ln->l[self] = malloc(ln->n[self] * sizeof(mds_id));
+  ln->l[other] = malloc(ln->n[other] * sizeof(mds_id));
   ln->n[self] = 0;
   ln->n[other] = 0;
   for_type_net(net, m, t, take_local_link, ln);
@@ -333,7 +333,7 @@ void mds_set_local_matches(struct mds_net* net, struct mds* m,
                          int t, struct mds_links* ln)
 {
   int self, other;
-  unsigned i;
+  mds_id i;
   mds_id a, b;
   struct mds_copy c;
   c.p = PCU_Comm_Self();
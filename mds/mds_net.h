@@ -28,11 +28,12 @@ struct mds_net {
   struct mds_copies** data[MDS_TYPES];
 };
 
+/* np peers p, with n[i] entity indices l[i] for peer p[i] */
 struct mds_links {
   unsigned np;
-  unsigned* n;
+  mds_id* n;
   unsigned* p;
-  unsigned** l;
+  mds_id** l;
 };
 #define MDS_LINKS_INIT {0,0,0,0}
 
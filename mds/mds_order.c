@@ -12,6 +12,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <float.h>
+#include <stdint.h>
 #include <PCU.h>
 
 struct queue {
@@ -141,6 +143,330 @@ static struct mds_tag* number_graph(struct mds_apf* m)
   return tag;
 }
 
+/* space-filling curve ordering: entities of each type are
+   sorted by the curve key of their vertex centroid */
+
+struct sfc_box {
+  double min[3];
+  double scale[3];
+  /* axes along which the part has any extent */
+  int axis[3];
+  int n;
+  int bits;
+};
+
+static void find_box(struct mds_apf* m, struct sfc_box* b)
+{
+  double max[3];
+  double* p;
+  mds_id v;
+  int i;
+  for (i = 0; i < 3; ++i) {
+    b->min[i] = DBL_MAX;
+    max[i] = -DBL_MAX;
+  }
+  for (v = mds_begin(&m->mds, 0); v != MDS_NONE; v = mds_next(&m->mds, v)) {
+    p = mds_apf_point(m, v);
+    for (i = 0; i < 3; ++i) {
+      if (p[i] < b->min[i])
+        b->min[i] = p[i];
+      if (p[i] > max[i])
+        max[i] = p[i];
+    }
+  }
+  /* flat meshes use a 2D curve, which keeps its locality
+     where a 3D curve restricted to a plane would not */
+  b->n = 0;
+  for (i = 0; i < 3; ++i)
+    if (max[i] > b->min[i])
+      b->axis[b->n++] = i;
+  b->bits = (b->n == 3) ? 21 : 31;
+  for (i = 0; i < 3; ++i)
+    if (max[i] > b->min[i])
+      b->scale[i] = ((1u << b->bits) - 1) / (max[i] - b->min[i]);
+    else
+      b->scale[i] = 0;
+}
+
+/* J. Skilling, "Programming the Hilbert curve",
+   AIP Conf. Proc. 707, 2004. converts coordinates in place
+   to the transposed form of their Hilbert index */
+static void hilbert_transpose(uint32_t* x, int n, int bits)
+{
+  uint32_t p, q, t, set;
+  int i;
+  for (q = 1u << (bits - 1); q > 1; q >>= 1) {
+    p = q - 1;
+    /* branch-free form of: if (x[i] & q) invert the low bits
+       of x[0], otherwise exchange them with those of x[i] */
+    for (i = 0; i < n; ++i) {
+      set = -(uint32_t)((x[i] & q) != 0);
+      t = (x[0] ^ x[i]) & p & ~set;
+      x[0] ^= (p & set) | t;
+      x[i] ^= t;
+    }
+  }
+  for (i = 1; i < n; ++i)
+    x[i] ^= x[i - 1];
+  t = 0;
+  for (q = 1u << (bits - 1); q > 1; q >>= 1)
+    if (x[n - 1] & q)
+      t ^= q - 1;
+  for (i = 0; i < n; ++i)
+    x[i] ^= t;
+}
+
+/* spread the low 21 bits of v two bits apart */
+static uint64_t spread3(uint64_t v)
+{
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+/* spread the low 32 bits of v one bit apart */
+static uint64_t spread2(uint64_t v)
+{
+  v &= 0xffffffffULL;
+  v = (v | v << 16) & 0x0000ffff0000ffffULL;
+  v = (v | v << 8) & 0x00ff00ff00ff00ffULL;
+  v = (v | v << 4) & 0x0f0f0f0f0f0f0f0fULL;
+  v = (v | v << 2) & 0x3333333333333333ULL;
+  v = (v | v << 1) & 0x5555555555555555ULL;
+  return v;
+}
+
+/* interleave the coordinate bits, most significant first */
+static uint64_t interleave(uint32_t const* x, int n)
+{
+  if (n == 3)
+    return (spread3(x[0]) << 2) | (spread3(x[1]) << 1) | spread3(x[2]);
+  if (n == 2)
+    return (spread2(x[0]) << 1) | spread2(x[1]);
+  if (n == 1)
+    return x[0];
+  return 0;
+}
+
+/* the centroid of an entity's sides is the vertex centroid
+   for simplices and hexes, and an interior point otherwise,
+   which is all a curve key needs. it only costs a one-level
+   downward lookup per entity, given the centroids below */
+static void get_centroid(struct mds_apf* m, double* centroids[MDS_TYPES],
+    mds_id e, double x[3])
+{
+  struct mds_set s;
+  double* p;
+  int i, j;
+  if (mds_type(e) == MDS_VERTEX) {
+    p = mds_apf_point(m, e);
+    for (j = 0; j < 3; ++j)
+      x[j] = p[j];
+    return;
+  }
+  mds_get_adjacent(&m->mds, e, mds_dim[mds_type(e)] - 1, &s);
+  for (j = 0; j < 3; ++j)
+    x[j] = 0;
+  for (i = 0; i < s.n; ++i) {
+    if (mds_type(s.e[i]) == MDS_VERTEX)
+      p = mds_apf_point(m, s.e[i]);
+    else
+      p = centroids[mds_type(s.e[i])] + 3 * mds_index(s.e[i]);
+    for (j = 0; j < 3; ++j)
+      x[j] += p[j];
+  }
+  for (j = 0; j < 3; ++j)
+    x[j] /= s.n;
+}
+
+static uint64_t sfc_key(struct sfc_box* b, int ordering, double const c[3])
+{
+  double q;
+  uint32_t x[3];
+  int i, j;
+  for (i = 0; i < b->n; ++i) {
+    j = b->axis[i];
+    q = (c[j] - b->min[j]) * b->scale[j];
+    x[i] = (q > 0) ? (uint32_t)q : 0;
+  }
+  if (ordering == MDS_ORDER_HILBERT && b->n > 1)
+    hilbert_transpose(x, b->n, b->bits);
+  return interleave(x, b->n);
+}
+
+#define RADIX_BITS 11
+#define RADIX (1 << RADIX_BITS)
+
+static int order_threads = 1;
+
+void mds_set_order_threads(int n)
+{
+  assert(n > 0);
+  order_threads = n;
+}
+
+/* one digit pass of the radix sort. each PCU_Work_Run worker
+   owns a contiguous range of the input and a histogram row,
+   and the rows are offset so that ranges keep their order
+   within each bucket, which keeps the sort stable */
+struct radix_pass {
+  mds_id n;
+  uint64_t* k[2];
+  mds_id* v[2];
+  int from;
+  int shift;
+  int threads;
+  /* threads rows of RADIX counts, later bucket offsets */
+  mds_id* count;
+};
+
+static void get_range(struct radix_pass* r, int thread,
+    mds_id* begin, mds_id* end)
+{
+  *begin = r->n / r->threads * thread;
+  *end = (thread == r->threads - 1) ? r->n : *begin + r->n / r->threads;
+}
+
+static void count_digits(int thread, void* data)
+{
+  struct radix_pass* r = data;
+  mds_id* count = r->count + (size_t)thread * RADIX;
+  uint64_t const* k = r->k[r->from];
+  mds_id i, begin, end;
+  get_range(r, thread, &begin, &end);
+  memset(count, 0, RADIX * sizeof(mds_id));
+  for (i = begin; i < end; ++i)
+    ++count[(k[i] >> r->shift) & (RADIX - 1)];
+}
+
+static void scatter_digits(int thread, void* data)
+{
+  struct radix_pass* r = data;
+  mds_id* count = r->count + (size_t)thread * RADIX;
+  uint64_t const* k = r->k[r->from];
+  mds_id const* v = r->v[r->from];
+  uint64_t* k2 = r->k[1 - r->from];
+  mds_id* v2 = r->v[1 - r->from];
+  mds_id i, begin, end;
+  unsigned d;
+  get_range(r, thread, &begin, &end);
+  for (i = begin; i < end; ++i) {
+    d = (k[i] >> r->shift) & (RADIX - 1);
+    k2[count[d]] = k[i];
+    v2[count[d]] = v[i];
+    ++count[d];
+  }
+}
+
+/* turns the histogram rows into bucket offsets, returning
+   zero if all keys share this digit and the pass can be skipped */
+static int offset_digits(struct radix_pass* r)
+{
+  mds_id sum, c;
+  unsigned d;
+  int t;
+  d = (r->k[r->from][0] >> r->shift) & (RADIX - 1);
+  sum = 0;
+  for (t = 0; t < r->threads; ++t)
+    sum += r->count[(size_t)t * RADIX + d];
+  if (sum == r->n)
+    return 0;
+  sum = 0;
+  for (d = 0; d < RADIX; ++d)
+    for (t = 0; t < r->threads; ++t) {
+      c = r->count[(size_t)t * RADIX + d];
+      r->count[(size_t)t * RADIX + d] = sum;
+      sum += c;
+    }
+  return 1;
+}
+
+/* stable LSD radix sort of (ids) by (keys) */
+static void radix_sort(mds_id n, uint64_t* keys, mds_id* ids)
+{
+  struct radix_pass r;
+  if (n < 2)
+    return;
+  r.n = n;
+  r.k[0] = keys;
+  r.v[0] = ids;
+  r.k[1] = malloc(n * sizeof(uint64_t));
+  r.v[1] = malloc(n * sizeof(mds_id));
+  r.from = 0;
+  /* small inputs are not worth starting threads for */
+  r.threads = order_threads;
+  if (n < (mds_id)r.threads * RADIX)
+    r.threads = 1;
+  r.count = malloc((size_t)r.threads * RADIX * sizeof(mds_id));
+  for (r.shift = 0; r.shift < 64; r.shift += RADIX_BITS) {
+    PCU_Work_Run(r.threads, count_digits, &r);
+    if ( ! offset_digits(&r))
+      continue;
+    PCU_Work_Run(r.threads, scatter_digits, &r);
+    r.from = 1 - r.from;
+  }
+  if (r.from) {
+    memcpy(keys, r.k[1], n * sizeof(uint64_t));
+    memcpy(ids, r.v[1], n * sizeof(mds_id));
+  }
+  free(r.k[1]);
+  free(r.v[1]);
+  free(r.count);
+}
+
+static struct mds_tag* number_sfc(struct mds_apf* m, int ordering)
+{
+  struct mds_tag* tag;
+  struct sfc_box b;
+  uint64_t* keys[MDS_TYPES];
+  mds_id* ids[MDS_TYPES];
+  double* centroids[MDS_TYPES];
+  double x[3];
+  mds_id n[MDS_TYPES];
+  mds_id e;
+  mds_id i;
+  mds_id* l;
+  int d, t, j;
+  tag = mds_create_tag(&m->tags, "mds_number", sizeof(mds_id), 1);
+  find_box(m, &b);
+  for (t = 0; t < MDS_TYPES; ++t) {
+    keys[t] = malloc(m->mds.n[t] * sizeof(uint64_t));
+    ids[t] = malloc(m->mds.n[t] * sizeof(mds_id));
+    centroids[t] = 0;
+    if (mds_dim[t] > 0 && mds_dim[t] < m->mds.d)
+      centroids[t] = malloc(m->mds.end[t] * 3 * sizeof(double));
+    n[t] = 0;
+  }
+  for (d = 0; d <= m->mds.d; ++d)
+    for (e = mds_begin(&m->mds, d); e != MDS_NONE; e = mds_next(&m->mds, e)) {
+      t = mds_type(e);
+      get_centroid(m, centroids, e, x);
+      if (centroids[t])
+        for (j = 0; j < 3; ++j)
+          centroids[t][3 * mds_index(e) + j] = x[j];
+      keys[t][n[t]] = sfc_key(&b, ordering, x);
+      ids[t][n[t]] = e;
+      ++(n[t]);
+    }
+  for (t = 0; t < MDS_TYPES; ++t) {
+    free(centroids[t]);
+    assert(n[t] == m->mds.n[t]);
+    radix_sort(n[t], keys[t], ids[t]);
+    for (i = 0; i < n[t]; ++i) {
+      mds_give_tag(tag, &m->mds, ids[t][i]);
+      l = mds_get_tag(tag, ids[t][i]);
+      *l = i;
+    }
+    free(keys[t]);
+    free(ids[t]);
+  }
+  return tag;
+}
+
 static mds_id lookup(struct mds_tag* tag, mds_id old)
 {
   mds_id* ip;
@@ -369,12 +695,88 @@ static struct mds_apf* rebuild(
   return m2;
 }
 
-struct mds_apf* mds_reorder(struct mds_apf* m)
+struct mds_apf* mds_reorder(struct mds_apf* m, int ordering)
 {
   struct mds_tag* new_of;
   struct mds_apf* m2;
-  new_of = number_graph(m);
+  if (ordering == MDS_ORDER_BFS)
+    new_of = number_graph(m);
+  else
+    new_of = number_sfc(m, ordering);
   m2 = rebuild(m, new_of);
   mds_apf_destroy(m);
   return m2;
 }
+
+static mds_id dense_index(struct mds* m, mds_id e)
+{
+  mds_id i = 0;
+  int type = mds_type(e);
+  int t;
+  for (t = 0; t < type; ++t)
+    if (mds_dim[t] == mds_dim[type])
+      i += m->n[t];
+  return i + mds_index(e);
+}
+
+static double index_distance(struct mds* m, mds_id a, mds_id b)
+{
+  return labs((long)dense_index(m, a) - (long)dense_index(m, b));
+}
+
+/* the cache proxy reads element vertices through a direct-mapped
+   cache of LOCALITY_LINES lines, each holding the coordinates of
+   LOCALITY_LINE_VERTS consecutive vertices */
+#define LOCALITY_LINES 512
+#define LOCALITY_LINE_VERTS 8
+
+void mds_measure_locality(struct mds* m, struct mds_locality* l)
+{
+  struct mds_set s;
+  mds_id cache[LOCALITY_LINES];
+  mds_id e, line, lo, hi;
+  double edges = 0, sides = 0, elements = 0, reads = 0;
+  int i;
+  memset(l, 0, sizeof(*l));
+  for (e = mds_begin(m, 1); e != MDS_NONE; e = mds_next(m, e)) {
+    mds_get_adjacent(m, e, 0, &s);
+    l->edge_distance += index_distance(m, s.e[0], s.e[1]);
+    ++edges;
+  }
+  if (m->d > 1)
+    for (e = mds_begin(m, m->d - 1); e != MDS_NONE; e = mds_next(m, e)) {
+      mds_get_adjacent(m, e, m->d, &s);
+      if (s.n != 2)
+        continue;
+      l->element_distance += index_distance(m, s.e[0], s.e[1]);
+      ++sides;
+    }
+  for (i = 0; i < LOCALITY_LINES; ++i)
+    cache[i] = MDS_NONE;
+  for (e = mds_begin(m, m->d); e != MDS_NONE; e = mds_next(m, e)) {
+    mds_get_adjacent(m, e, 0, &s);
+    lo = hi = mds_index(s.e[0]);
+    for (i = 0; i < s.n; ++i) {
+      if (mds_index(s.e[i]) < lo)
+        lo = mds_index(s.e[i]);
+      if (mds_index(s.e[i]) > hi)
+        hi = mds_index(s.e[i]);
+      line = mds_index(s.e[i]) / LOCALITY_LINE_VERTS;
+      if (cache[line % LOCALITY_LINES] != line) {
+        cache[line % LOCALITY_LINES] = line;
+        l->miss_rate += 1;
+      }
+      ++reads;
+    }
+    l->element_spread += hi - lo;
+    ++elements;
+  }
+  if (edges)
+    l->edge_distance /= edges;
+  if (sides)
+    l->element_distance /= sides;
+  if (elements)
+    l->element_spread /= elements;
+  if (reads)
+    l->miss_rate /= reads;
+}
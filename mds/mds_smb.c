@@ -17,7 +17,9 @@
 #include <pcu_io.h>
 #include <sys/stat.h> /*using POSIX mkdir call for SMB "foo/" path*/
 
-enum { SMB_VERSION = 4 };
+/* version 5 stores entity counts and indices in 64 bits
+   and adds long tags */
+enum { SMB_VERSION = 5 };
 
 enum {
   SMB_VERT,
@@ -33,7 +35,8 @@ enum {
 
 enum {
   SMB_INT,
-  SMB_DBL
+  SMB_DBL,
+  SMB_LONG
 };
 
 static int smb2mds(int smb_type)
@@ -69,7 +72,52 @@ static int down_degree(int t)
   return mds_degree[t][mds_dim[t] - 1];
 }
 
-static void read_links(struct pcu_file* f, struct mds_links* l)
+static void read_ids(struct pcu_file* f, mds_id* p, size_t n,
+    unsigned version)
+{
+  size_t i;
+  unsigned* u;
+  long* l;
+  if (version >= 5 && sizeof(mds_id) == sizeof(long)) {
+    pcu_read_longs(f, (long*)p, n);
+  } else if (version >= 5) {
+    l = malloc(n * sizeof(*l));
+    pcu_read_longs(f, l, n);
+    for (i = 0; i < n; ++i) {
+      p[i] = l[i];
+      if (p[i] != l[i]) {
+        fprintf(stderr, "smb id %ld does not fit in an mds_id,"
+            " reconfigure with MDS_ID_TYPE=long to read this file\n", l[i]);
+        abort();
+      }
+    }
+    free(l);
+  } else {
+    u = malloc(n * sizeof(*u));
+    pcu_read_unsigneds(f, u, n);
+    for (i = 0; i < n; ++i)
+      p[i] = u[i];
+    free(u);
+  }
+}
+
+static void write_ids(struct pcu_file* f, mds_id* p, size_t n)
+{
+  size_t i;
+  long* l;
+  if (sizeof(mds_id) == sizeof(long)) {
+    pcu_write_longs(f, (long*)p, n);
+    return;
+  }
+  l = malloc(n * sizeof(*l));
+  for (i = 0; i < n; ++i)
+    l[i] = p[i];
+  pcu_write_longs(f, l, n);
+  free(l);
+}
+
+static void read_links(struct pcu_file* f, struct mds_links* l,
+    unsigned version)
 {
   unsigned i;
   PCU_READ_UNSIGNED(f, l->np);
@@ -77,12 +125,12 @@ static void read_links(struct pcu_file* f, struct mds_links* l)
     return;
   l->p = malloc(l->np * sizeof(unsigned));
   pcu_read_unsigneds(f, l->p, l->np);
-  l->n = malloc(l->np * sizeof(unsigned));
-  l->l = malloc(l->np * sizeof(unsigned*));
-  pcu_read_unsigneds(f, l->n, l->np);
+  l->n = malloc(l->np * sizeof(mds_id));
+  l->l = malloc(l->np * sizeof(mds_id*));
+  read_ids(f, l->n, l->np, version);
   for (i = 0; i < l->np; ++i) {
-    l->l[i] = malloc(l->n[i] * sizeof(unsigned));
-    pcu_read_unsigneds(f, l->l[i], l->n[i]);
+    l->l[i] = malloc(l->n[i] * sizeof(mds_id));
+    read_ids(f, l->l[i], l->n[i], version);
   }
 }
 
@@ -93,9 +141,9 @@ static void write_links(struct pcu_file* f, struct mds_links* l)
   if (!l->np)
     return;
   pcu_write_unsigneds(f, l->p, l->np);
-  pcu_write_unsigneds(f, l->n, l->np);
+  write_ids(f, l->n, l->np);
   for (i = 0; i < l->np; ++i)
-    pcu_write_unsigneds(f, l->l[i], l->n[i]);
+    write_ids(f, l->l[i], l->n[i]);
 }
 
 static void read_header(struct pcu_file* f, unsigned* version, unsigned* dim)
@@ -124,35 +172,35 @@ static void write_header(struct pcu_file* f, unsigned dim)
 
 static void make_verts(struct mds_apf* m)
 {
-  mds_id i;
-  for (i = 0; i < m->mds.cap[MDS_VERTEX]; ++i)
-    mds_create_entity(&m->mds, MDS_VERTEX, NULL);
+  mds_create_entities(&m->mds, MDS_VERTEX, m->mds.cap[MDS_VERTEX], NULL);
 }
 
-static void read_conn(struct pcu_file* f, struct mds_apf* m)
+static void read_conn(struct pcu_file* f, struct mds_apf* m,
+    unsigned version)
 {
-  unsigned* conn;
-  struct mds_set down;
+  mds_id* conn;
   int const* dt;
   mds_id cap;
   size_t size;
   int type_mds;
   int i;
+  int n;
   mds_id j;
   int k;
   for (i = 1; i < SMB_TYPES; ++i) {
     type_mds = smb2mds(i);
-    down.n = down_degree(type_mds);
+    n = down_degree(type_mds);
     cap = m->mds.cap[type_mds];
     dt = mds_types[type_mds][mds_dim[type_mds] - 1];
-    size = down.n * cap;
+    size = n * cap;
     conn = malloc(size * sizeof(*conn));
-    pcu_read_unsigneds(f, conn, size);
-    for (j = 0; j < cap; ++j) {
-      for (k = 0; k < down.n; ++k)
-        down.e[k] = mds_identify(dt[k], conn[j * down.n + k]);
-      mds_create_entity(&m->mds, type_mds, down.e);
-    }
+    read_ids(f, conn, size, version);
+    for (j = 0; j < cap; ++j)
+      for (k = 0; k < n; ++k)
+        conn[j * n + k] = mds_identify(dt[k], conn[j * n + k]);
+    /* entities in a file are unique, so they are added in bulk
+       without the duplicate search of mds_create_entity */
+    mds_create_entities(&m->mds, type_mds, cap, conn);
     free(conn);
     assert(m->mds.n[type_mds] == m->mds.cap[type_mds]);
   }
@@ -160,7 +208,7 @@ static void read_conn(struct pcu_file* f, struct mds_apf* m)
 
 static void write_conn(struct pcu_file* f, struct mds_apf* m)
 {
-  unsigned* conn;
+  mds_id* conn;
   struct mds_set down;
   mds_id end;
   size_t size;
@@ -180,15 +228,16 @@ static void write_conn(struct pcu_file* f, struct mds_apf* m)
       for (k = 0; k < down.n; ++k)
         conn[j * down.n + k] = mds_index(down.e[k]);
     }
-    pcu_write_unsigneds(f, conn, size);
+    write_ids(f, conn, size);
     free(conn);
   }
 }
 
-static void read_remotes(struct pcu_file* f, struct mds_apf* m)
+static void read_remotes(struct pcu_file* f, struct mds_apf* m,
+    unsigned version)
 {
   struct mds_links ln = MDS_LINKS_INIT;
-  read_links(f, &ln);
+  read_links(f, &ln, version);
   mds_set_type_links(&m->remotes, &m->mds, MDS_VERTEX, &ln);
   mds_free_links(&ln);
 }
@@ -207,7 +256,10 @@ static void read_class(struct pcu_file* f, struct mds_apf* m)
   size_t size;
   int type_mds;
   unsigned* class;
-  int i,j;
+  int i;
+  mds_id j;
+  struct gmi_ent* last = NULL;
+  unsigned last_dim = 0, last_id = 0;
   for (i = 0; i < SMB_TYPES; ++i) {
     type_mds = smb2mds(i);
     cap = m->mds.cap[type_mds];
@@ -215,9 +267,14 @@ static void read_class(struct pcu_file* f, struct mds_apf* m)
     class = malloc(size * sizeof(*class));
     pcu_read_unsigneds(f, class, size);
     for (j = 0; j < cap; ++j) {
-      m->model[type_mds][j] =
-        mds_find_model(m, class[2 * j + 1], class[2 * j]);
-      assert(m->model[type_mds][j]);
+      /* neighboring entities tend to share a model entity */
+      if (!last || class[2 * j + 1] != last_dim || class[2 * j] != last_id) {
+        last_dim = class[2 * j + 1];
+        last_id = class[2 * j];
+        last = mds_find_model(m, last_dim, last_id);
+        assert(last);
+      }
+      m->model[type_mds][j] = last;
     }
     free(class);
   }
@@ -251,13 +308,16 @@ static struct mds_tag* read_tag_header(struct pcu_file* f, struct mds_apf* m)
   unsigned type, count;
   char* name;
   struct mds_tag* t;
-  int type_apf[2];
-  size_t bytes[2];
+  int type_apf[3];
+  size_t bytes[3];
   type_apf[SMB_INT] = mds_apf_int;
   type_apf[SMB_DBL] = mds_apf_double;
+  type_apf[SMB_LONG] = mds_apf_long;
   bytes[SMB_INT] = sizeof(int);
   bytes[SMB_DBL] = sizeof(double);
+  bytes[SMB_LONG] = sizeof(long);
   PCU_READ_UNSIGNED(f, type);
+  assert(type <= SMB_LONG);
   PCU_READ_UNSIGNED(f, count);
   pcu_read_string(f, &name);
   t = mds_create_tag(&m->tags, name,
@@ -269,12 +329,14 @@ static struct mds_tag* read_tag_header(struct pcu_file* f, struct mds_apf* m)
 static void write_tag_header(struct pcu_file* f, struct mds_tag* t)
 {
   unsigned type, count;
-  int type_smb[2];
-  size_t bytes[2];
+  int type_smb[3];
+  size_t bytes[3];
   type_smb[mds_apf_int] = SMB_INT;
   type_smb[mds_apf_double] = SMB_DBL;
+  type_smb[mds_apf_long] = SMB_LONG;
   bytes[mds_apf_int] = sizeof(int);
   bytes[mds_apf_double] = sizeof(double);
+  bytes[mds_apf_long] = sizeof(long);
   type = type_smb[t->user_type];
   count = t->bytes / bytes[t->user_type];
   PCU_WRITE_UNSIGNED(f, type);
@@ -282,21 +344,29 @@ static void write_tag_header(struct pcu_file* f, struct mds_tag* t)
   pcu_write_string(f, t->name);
 }
 
+static mds_id* read_tag_ids(struct pcu_file* f, mds_id count,
+    unsigned version)
+{
+  mds_id* ids;
+  ids = malloc(count * sizeof(*ids));
+  read_ids(f, ids, count, version);
+  return ids;
+}
+
 static void read_int_tag(struct pcu_file* f, struct mds_apf* m,
-                         struct mds_tag* tag, unsigned count, int t)
+    struct mds_tag* tag, mds_id count, int t, unsigned version)
 {
-  unsigned* ids;
+  mds_id* ids;
   unsigned* tmp;
   int size;
-  unsigned i;
+  mds_id i;
   int j;
   mds_id e;
   int* p;
   unsigned* q;
-  ids = malloc(count * sizeof(*ids));
+  ids = read_tag_ids(f, count, version);
   size = tag->bytes / sizeof(int);
   tmp = malloc(size * count * sizeof(*tmp));
-  pcu_read_unsigneds(f, ids, count);
   pcu_read_unsigneds(f, tmp, size * count);
   for (i = 0; i < count; ++i) {
     e = mds_identify(t, ids[i]);
@@ -310,6 +380,29 @@ static void read_int_tag(struct pcu_file* f, struct mds_apf* m,
   free(ids);
 }
 
+/* doubles and longs are stored in the file exactly as in the tag */
+static void read_raw_tag(struct pcu_file* f, struct mds_apf* m,
+    struct mds_tag* tag, mds_id count, int t, unsigned version)
+{
+  mds_id* ids;
+  char* tmp;
+  mds_id i;
+  mds_id e;
+  ids = read_tag_ids(f, count, version);
+  tmp = malloc(tag->bytes * count);
+  if (tag->user_type == mds_apf_long)
+    pcu_read_longs(f, (long*)tmp, tag->bytes / sizeof(long) * count);
+  else
+    pcu_read_doubles(f, (double*)tmp, tag->bytes / sizeof(double) * count);
+  for (i = 0; i < count; ++i) {
+    e = mds_identify(t, ids[i]);
+    mds_give_tag(tag, &m->mds, e);
+    memcpy(mds_get_tag(tag, e), tmp + i * tag->bytes, tag->bytes);
+  }
+  free(tmp);
+  free(ids);
+}
+
 static mds_id count_tagged(struct mds_apf* m, struct mds_tag* tag, int t)
 {
   mds_id i;
@@ -320,104 +413,70 @@ static mds_id count_tagged(struct mds_apf* m, struct mds_tag* tag, int t)
   return count;
 }
 
+static mds_id* get_tag_ids(struct mds_apf* m, struct mds_tag* tag,
+    mds_id count, int t)
+{
+  mds_id* ids;
+  mds_id i;
+  mds_id k = 0;
+  ids = malloc(count * sizeof(*ids));
+  for (i = 0; i < m->mds.end[t]; ++i)
+    if (mds_has_tag(tag, mds_identify(t, i)))
+      ids[k++] = i;
+  assert(k == count);
+  return ids;
+}
+
 static void write_int_tag(struct pcu_file* f, struct mds_apf* m,
-                          struct mds_tag* tag, unsigned count, int t)
+    struct mds_tag* tag, mds_id count, int t)
 {
-  unsigned* ids;
+  mds_id* ids;
   unsigned* tmp;
   int size;
-  unsigned i;
+  mds_id i;
   int j;
-  unsigned k;
-  mds_id e;
   int* p;
   unsigned* q;
-  ids = malloc(count * sizeof(*ids));
+  ids = get_tag_ids(m, tag, count, t);
   size = tag->bytes / sizeof(int);
   tmp = malloc(size * count * sizeof(*tmp));
-  k = 0;
-  for (i = 0; i < (unsigned)(m->mds.end[t]); ++i) {
-    e = mds_identify(t, i);
-    if (!mds_has_tag(tag, e))
-      continue;
-    ids[k] = i;
-    p = mds_get_tag(tag, e);
-    q = tmp + k * size;
+  for (i = 0; i < count; ++i) {
+    p = mds_get_tag(tag, mds_identify(t, ids[i]));
+    q = tmp + i * size;
     for (j = 0; j < size; ++j)
       q[j] = p[j];
-    ++k;
   }
-  assert(k == count);
-  pcu_write_unsigneds(f, ids, count);
+  write_ids(f, ids, count);
   pcu_write_unsigneds(f, tmp, size * count);
   free(tmp);
   free(ids);
 }
 
-static void read_dbl_tag(struct pcu_file* f, struct mds_apf* m,
-    struct mds_tag* tag, unsigned count, int t)
-{
-  unsigned* ids;
-  double* tmp;
-  int size;
-  unsigned i;
-  mds_id e;
-  double* p;
-  double* q;
-  ids = malloc(count * sizeof(*ids));
-  size = tag->bytes / sizeof(double);
-  tmp = malloc(size * count * sizeof(*tmp));
-  pcu_read_unsigneds(f, ids, count);
-  pcu_read_doubles(f, tmp, size * count);
-  for (i = 0; i < count; ++i) {
-    e = mds_identify(t, ids[i]);
-    mds_give_tag(tag, &m->mds, e);
-    p = mds_get_tag(tag, e);
-    q = tmp + i * size;
-    memcpy(p, q, size * sizeof(double));
-  }
-  free(tmp);
-  free(ids);
-}
-
-static void write_dbl_tag(struct pcu_file* f, struct mds_apf* m,
-                          struct mds_tag* tag, unsigned count, int t)
+static void write_raw_tag(struct pcu_file* f, struct mds_apf* m,
+    struct mds_tag* tag, mds_id count, int t)
 {
-  unsigned* ids;
-  double* tmp;
-  int size;
-  unsigned i;
-  int j;
-  unsigned k;
-  mds_id e;
-  double* p;
-  double* q;
-  ids = malloc(count * sizeof(*ids));
-  size = tag->bytes / sizeof(double);
-  tmp = malloc(size * count * sizeof(*tmp));
-  k = 0;
-  for (i = 0; i < (unsigned)(m->mds.end[t]); ++i) {
-    e = mds_identify(t, i);
-    if (!mds_has_tag(tag, e))
-      continue;
-    ids[k] = i;
-    p = mds_get_tag(tag, e);
-    q = tmp + k * size;
-    for (j = 0; j < size; ++j)
-      q[j] = p[j];
-    ++k;
-  }
-  assert(k == count);
-  pcu_write_unsigneds(f, ids, count);
-  pcu_write_doubles(f, tmp, size * count);
+  mds_id* ids;
+  char* tmp;
+  mds_id i;
+  ids = get_tag_ids(m, tag, count, t);
+  tmp = malloc(tag->bytes * count);
+  for (i = 0; i < count; ++i)
+    memcpy(tmp + i * tag->bytes, mds_get_tag(tag, mds_identify(t, ids[i])),
+        tag->bytes);
+  write_ids(f, ids, count);
+  if (tag->user_type == mds_apf_long)
+    pcu_write_longs(f, (long*)tmp, tag->bytes / sizeof(long) * count);
+  else
+    pcu_write_doubles(f, (double*)tmp, tag->bytes / sizeof(double) * count);
   free(tmp);
   free(ids);
 }
 
-static void read_tags(struct pcu_file* f, struct mds_apf* m)
+static void read_tags(struct pcu_file* f, struct mds_apf* m,
+    unsigned version)
 {
   unsigned n;
-  unsigned* sizes;
+  mds_id* sizes;
   struct mds_tag** tags;
   unsigned i,j;
   int type_mds;
@@ -427,13 +486,13 @@ static void read_tags(struct pcu_file* f, struct mds_apf* m)
   for (i = 0; i < n; ++i)
     tags[i] = read_tag_header(f, m);
   for (i = 0; i < SMB_TYPES; ++i) {
-    pcu_read_unsigneds(f, sizes, n);
+    read_ids(f, sizes, n, version);
     type_mds = smb2mds(i);
     for (j = 0; j < n; ++j) {
       if (tags[j]->user_type == mds_apf_int)
-        read_int_tag(f, m, tags[j], sizes[j], type_mds);
+        read_int_tag(f, m, tags[j], sizes[j], type_mds, version);
       else
-        read_dbl_tag(f, m, tags[j], sizes[j], type_mds);
+        read_raw_tag(f, m, tags[j], sizes[j], type_mds, version);
     }
   }
   free(tags);
@@ -443,43 +502,39 @@ static void read_tags(struct pcu_file* f, struct mds_apf* m)
 static void write_tags(struct pcu_file* f, struct mds_apf* m)
 {
   unsigned n;
-  unsigned* sizes;
+  mds_id* sizes;
   struct mds_tag* t;
   int i,j;
   int type_mds;
   n = 0;
   for (t = m->tags.first; t; t = t->next)
-    if (t->user_type != mds_apf_long)
-      ++n;
+    ++n;
   PCU_WRITE_UNSIGNED(f,n);
   sizes = malloc(n * sizeof(*sizes));
   for (t = m->tags.first; t; t = t->next)
-    if (t->user_type != mds_apf_long)
-      write_tag_header(f, t);
+    write_tag_header(f, t);
   for (i = 0; i < SMB_TYPES; ++i) {
     type_mds = smb2mds(i);
     j = 0;
-    for (t = m->tags.first; t; t = t->next) {
-      if (t->user_type == mds_apf_long)
-        continue;
+    for (t = m->tags.first; t; t = t->next)
       sizes[j++] = count_tagged(m, t, type_mds);
-    }
-    pcu_write_unsigneds(f, sizes, n);
+    write_ids(f, sizes, n);
     j = 0;
     for (t = m->tags.first; t; t = t->next) {
       if (t->user_type == mds_apf_int)
         write_int_tag(f, m, t, sizes[j++], type_mds);
-      else if (t->user_type == mds_apf_double)
-        write_dbl_tag(f, m, t, sizes[j++], type_mds);
+      else
+        write_raw_tag(f, m, t, sizes[j++], type_mds);
     }
   }
   free(sizes);
 }
 
-static void read_type_matches(struct pcu_file* f, struct mds_apf* m, int t)
+static void read_type_matches(struct pcu_file* f, struct mds_apf* m, int t,
+    unsigned version)
 {
   struct mds_links ln = MDS_LINKS_INIT;
-  read_links(f, &ln);
+  read_links(f, &ln, version);
   mds_set_local_matches(&m->matches, &m->mds, t, &ln);
   mds_free_local_links(&ln);
   mds_set_type_links(&m->matches, &m->mds, t, &ln);
@@ -495,18 +550,20 @@ static void write_type_matches(struct pcu_file* f, struct mds_apf* m, int t)
   mds_free_links(&ln);
 }
 
-static void read_matches_old(struct pcu_file* f, struct mds_apf* m)
+static void read_matches_old(struct pcu_file* f, struct mds_apf* m,
+    unsigned version)
 {
   int t;
   for (t = 0; t < MDS_HEXAHEDRON; ++t)
-    read_type_matches(f, m, t);
+    read_type_matches(f, m, t, version);
 }
 
-static void read_matches_new(struct pcu_file* f, struct mds_apf* m)
+static void read_matches_new(struct pcu_file* f, struct mds_apf* m,
+    unsigned version)
 {
   int t;
   for (t = 0; t < SMB_TYPES; ++t)
-    read_type_matches(f, m, smb2mds(t));
+    read_type_matches(f, m, smb2mds(t), version);
 }
 
 static void write_matches(struct pcu_file* f, struct mds_apf* m)
@@ -516,35 +573,31 @@ static void write_matches(struct pcu_file* f, struct mds_apf* m)
     write_type_matches(f, m, smb2mds(t));
 }
 
-static struct mds_apf* read_smb(struct gmi_model* model, const char* filename, int zip)
+static struct mds_apf* read_smb(struct gmi_model* model, struct pcu_file* f)
 {
   struct mds_apf* m;
-  struct pcu_file* f;
   unsigned version;
   unsigned dim;
-  unsigned n[SMB_TYPES];
+  mds_id n[SMB_TYPES];
   mds_id cap[MDS_TYPES];
   int i;
-  f = pcu_fopen(filename, 0, zip);
-  assert(f);
   read_header(f, &version, &dim);
-  pcu_read_unsigneds(f, n, SMB_TYPES);
+  read_ids(f, n, SMB_TYPES, version);
   for (i = 0; i < MDS_TYPES; ++i)
     cap[i] = n[mds2smb(i)];
   m = mds_apf_create(model, dim, cap);
   make_verts(m);
-  read_conn(f, m);
+  read_conn(f, m, version);
   pcu_read_doubles(f, &m->point[0][0], 3 * n[SMB_VERT]);
   if (version >= 2)
     pcu_read_doubles(f, &m->param[0][0], 2 * n[SMB_VERT]);
-  read_remotes(f, m);
+  read_remotes(f, m, version);
   read_class(f, m);
-  read_tags(f, m);
+  read_tags(f, m, version);
   if (version >= 4)
-    read_matches_new(f, m);
+    read_matches_new(f, m, version);
   else if (version >= 3)
-    read_matches_old(f, m);
-  pcu_fclose(f);
+    read_matches_old(f, m, version);
   return m;
 }
 
@@ -557,25 +610,20 @@ static void write_coords(struct pcu_file* f, struct mds_apf* m)
   pcu_write_doubles(f, &m->param[0][0], count);
 }
 
-static void write_smb(struct mds_apf* m, const char* filename,
-                      int zip)
+static void write_smb(struct mds_apf* m, struct pcu_file* f)
 {
-  struct pcu_file* f;
-  unsigned n[SMB_TYPES] = {0};
+  mds_id n[SMB_TYPES] = {0};
   int i;
-  f = pcu_fopen(filename, 1, zip);
-  assert(f);
   write_header(f, m->mds.d);
   for (i = 0; i < MDS_TYPES; ++i)
     n[mds2smb(i)] = m->mds.end[i];
-  pcu_write_unsigneds(f, n, SMB_TYPES);
+  write_ids(f, n, SMB_TYPES);
   write_conn(f, m);
   write_coords(f, m);
   write_remotes(f, m);
   write_class(f, m);
   write_tags(f, m);
   write_matches(f, m);
-  pcu_fclose(f);
 }
 
 static int ends_with(const char* s, const char* w)
@@ -598,7 +646,23 @@ static int starts_with(const char* s, const char* w)
 
 #define SMB_FANOUT 2048
 
-static char* handle_path(const char* in, int is_write, int* zip)
+static int smb_parts_per_file = SMB_FANOUT;
+
+void mds_set_smb_parts_per_file(int n)
+{
+  assert(n > 0);
+  smb_parts_per_file = n;
+}
+
+void mds_set_smb_threads(int n)
+{
+  pcu_set_compress_threads(n);
+}
+
+/* strips the "bz2:", "zst:" and "agg:" prefixes and the ".smb"
+   suffix, returning the prefix to which "<number>.smb" is appended.
+   zip is the pcu_fopen codec the prefixes ask for. */
+static char* handle_path(const char* in, int is_write, int* zip, int* agg)
 {
   size_t n;
   char* tmp;
@@ -611,17 +675,28 @@ static char* handle_path(const char* in, int is_write, int* zip)
   tmp = malloc(n);
   out = malloc(n);
   strcpy(tmp,in);
-  if (starts_with(tmp, "bz2:")) {
-    *zip = 1;
-    memmove(tmp, tmp + 4, li - 3);
-  } else {
-    *zip = 0;
+  *zip = 0;
+  *agg = 0;
+  while (starts_with(tmp, "bz2:") || starts_with(tmp, "zst:") ||
+         starts_with(tmp, "agg:")) {
+    if (starts_with(tmp, "bz2:"))
+      *zip = PCU_CODEC_BZIP2;
+    else if (starts_with(tmp, "zst:"))
+      *zip = PCU_CODEC_ZSTD;
+    else
+      *agg = 1;
+    memmove(tmp, tmp + 4, strlen(tmp) - 3);
+  }
+  if (*zip && *agg) {
+    fprintf(stderr,"smb path %s: compression and agg can't be combined\n",in);
+    abort();
   }
+  li = strlen(tmp);
   if (ends_with(tmp, "/")) {
     if (is_write && (!self))
       mkdir(tmp, dir_perm);
     PCU_Barrier();
-    if (PCU_Comm_Peers() > SMB_FANOUT) {
+    if (PCU_Comm_Peers() > SMB_FANOUT && !*agg) {
       subdir = self / SMB_FANOUT;
       snprintf(out, n, "%s%d/", tmp, subdir);
       if (is_write && (self % SMB_FANOUT == 0))
@@ -635,19 +710,206 @@ static char* handle_path(const char* in, int is_write, int* zip)
     fprintf(stderr,"invalid smb path %s\n",tmp);
     abort();
   }
-  snprintf(out, n, "%s%d.smb", tmp, self);
-  free(tmp);
+  free(out);
+  return tmp;
+}
+
+static char* number_path(const char* prefix, int i)
+{
+  size_t n = strlen(prefix) + 32;
+  char* out = malloc(n);
+  snprintf(out, n, "%s%d.smb", prefix, i);
   return out;
 }
 
+/* In aggregated ("agg:") mode every group of smb_parts_per_file
+   consecutive parts shares one file, which is read and written
+   by the first part of the group.
+   The file starts with a header:
+     unsigned magic (1, plain SMB files start with 0)
+     unsigned first part, part count
+     long size of each part's stream
+   followed by the SMB streams of each part in order.
+   The streams pass through the first part SMB_AGG_CHUNK parts
+   at a time, one communication phase per chunk, so it never
+   holds more than that many of them. */
+
+enum { SMB_AGG_MAGIC = 1 };
+
+#define SMB_AGG_CHUNK 64
+
+static int count_group(int first, int ppf)
+{
+  int count = PCU_Comm_Peers() - first;
+  if (count > ppf)
+    count = ppf;
+  return count;
+}
+
+static int count_chunks(int ppf)
+{
+  return (count_group(0, ppf) + SMB_AGG_CHUNK - 1) / SMB_AGG_CHUNK;
+}
+
+static void write_agg(struct mds_apf* m, const char* prefix)
+{
+  struct pcu_file* mf;
+  struct pcu_file* f = NULL;
+  char* filename;
+  void* data;
+  size_t size, in;
+  int self, first, count, chunks, c, i;
+  long* sizes = NULL;
+  void* streams[SMB_AGG_CHUNK];
+  unsigned header[3];
+  self = PCU_Comm_Self();
+  first = self - self % smb_parts_per_file;
+  count = count_group(first, smb_parts_per_file);
+  mf = pcu_mopen(NULL, 0, 1);
+  write_smb(m, mf);
+  pcu_mdata(mf, &data, &size);
+  PCU_Comm_Begin();
+  PCU_COMM_PACK(first, size);
+  PCU_Comm_Send();
+  if (self == first)
+    sizes = calloc(count, sizeof(long));
+  while (PCU_Comm_Receive()) {
+    PCU_COMM_UNPACK(in);
+    sizes[PCU_Comm_Sender() - first] = in;
+  }
+  if (self == first) {
+    filename = number_path(prefix, self / smb_parts_per_file);
+    f = pcu_fopen(filename, 1, 0);
+    free(filename);
+    header[0] = SMB_AGG_MAGIC;
+    header[1] = first;
+    header[2] = count;
+    pcu_write_unsigneds(f, header, 3);
+    pcu_write_longs(f, sizes, count);
+  }
+  chunks = count_chunks(smb_parts_per_file);
+  for (c = 0; c < chunks; ++c) {
+    PCU_Comm_Begin();
+    if ((self - first) / SMB_AGG_CHUNK == c)
+      PCU_Comm_Pack(first, data, size);
+    PCU_Comm_Send();
+    while (PCU_Comm_Receive()) {
+      i = PCU_Comm_Sender() - first - c * SMB_AGG_CHUNK;
+      in = sizes[i + c * SMB_AGG_CHUNK];
+      streams[i] = malloc(in);
+      memcpy(streams[i], PCU_Comm_Extract(in), in);
+    }
+    if (self != first)
+      continue;
+    for (i = c * SMB_AGG_CHUNK; i < count && i < (c + 1) * SMB_AGG_CHUNK;
+         ++i) {
+      pcu_write(f, streams[i % SMB_AGG_CHUNK], sizes[i]);
+      free(streams[i % SMB_AGG_CHUNK]);
+    }
+  }
+  pcu_fclose(mf);
+  if (self == first) {
+    pcu_fclose(f);
+    free(sizes);
+  }
+}
+
+/* the parts per file are taken from the first file,
+   not from the current setting */
+static int read_parts_per_file(const char* prefix)
+{
+  struct pcu_file* f;
+  char* filename;
+  unsigned header[3];
+  int n = 0;
+  if (!PCU_Comm_Self()) {
+    filename = number_path(prefix, 0);
+    f = pcu_fopen(filename, 0, 0);
+    pcu_read_unsigneds(f, header, 3);
+    pcu_fclose(f);
+    free(filename);
+    if (header[0] != SMB_AGG_MAGIC) {
+      fprintf(stderr,"%s is not an aggregated smb file\n", prefix);
+      abort();
+    }
+    n = header[2];
+  }
+  PCU_Max_Ints(&n, 1);
+  return n;
+}
+
+static struct mds_apf* read_agg(struct gmi_model* model, const char* prefix)
+{
+  struct pcu_file* f = NULL;
+  struct pcu_file* mf = NULL;
+  struct mds_apf* m;
+  char* filename;
+  size_t size;
+  int self, ppf, chunks, c, i;
+  int count = 0;
+  long* sizes = NULL;
+  unsigned header[3];
+  self = PCU_Comm_Self();
+  ppf = read_parts_per_file(prefix);
+  if (self % ppf == 0) {
+    filename = number_path(prefix, self / ppf);
+    f = pcu_fopen(filename, 0, 0);
+    free(filename);
+    pcu_read_unsigneds(f, header, 3);
+    assert(header[0] == SMB_AGG_MAGIC);
+    assert(header[1] == (unsigned)self);
+    count = header[2];
+    assert(self + count <= PCU_Comm_Peers());
+    sizes = malloc(count * sizeof(long));
+    pcu_read_longs(f, sizes, count);
+  }
+  chunks = count_chunks(ppf);
+  for (c = 0; c < chunks; ++c) {
+    PCU_Comm_Begin();
+    if (f)
+      for (i = c * SMB_AGG_CHUNK;
+           i < count && i < (c + 1) * SMB_AGG_CHUNK; ++i) {
+        size = sizes[i];
+        PCU_COMM_PACK(self + i, size);
+        pcu_read(f, PCU_Comm_Reserve(self + i, size), size);
+      }
+    PCU_Comm_Send();
+    while (PCU_Comm_Receive()) {
+      assert(!mf);
+      PCU_COMM_UNPACK(size);
+      mf = pcu_mopen(PCU_Comm_Extract(size), size, 0);
+    }
+  }
+  assert(mf);
+  if (f) {
+    pcu_fclose(f);
+    free(sizes);
+  }
+  /* reading communicates, so it waits until the chunks are done */
+  m = read_smb(model, mf);
+  pcu_fclose(mf);
+  return m;
+}
+
 struct mds_apf* mds_read_smb(struct gmi_model* model, const char* pathname)
 {
+  char* prefix;
   char* filename;
-  int zip;
+  int zip, agg;
+  struct pcu_file* f;
   struct mds_apf* m;
-  filename = handle_path(pathname, 0, &zip);
-  m = read_smb(model, filename, zip);
-  free(filename);
+  prefix = handle_path(pathname, 0, &zip, &agg);
+  if (agg) {
+    m = read_agg(model, prefix);
+  } else {
+    filename = number_path(prefix, PCU_Comm_Self());
+    f = pcu_fopen(filename, 0, zip);
+    assert(f);
+    m = read_smb(model, f);
+    pcu_fclose(f);
+    free(filename);
+  }
+  free(prefix);
   return m;
 }
 
@@ -662,13 +924,23 @@ static int is_compact(struct mds_apf* m)
 
 struct mds_apf* mds_write_smb(struct mds_apf* m, const char* pathname)
 {
+  char* prefix;
   char* filename;
-  int zip;
+  int zip, agg;
+  struct pcu_file* f;
   if (PCU_Or(!is_compact(m)))
-    m = mds_reorder(m);
-  filename = handle_path(pathname, 1, &zip);
-  write_smb(m, filename, zip);
-  free(filename);
+    m = mds_reorder(m, MDS_ORDER_BFS);
+  prefix = handle_path(pathname, 1, &zip, &agg);
+  if (agg) {
+    write_agg(m, prefix);
+  } else {
+    filename = number_path(prefix, PCU_Comm_Self());
+    f = pcu_fopen(filename, 1, zip);
+    assert(f);
+    write_smb(m, f);
+    pcu_fclose(f);
+    free(filename);
+  }
+  free(prefix);
   return m;
 }
-
@@ -118,23 +118,68 @@ int mds_has_tag(struct mds_tag* tag, mds_id e)
   return v != 0;
 }
 
+/* threads applying cavity operators give tags to different
+   entities at the same time, which can share the first
+   allocation of a type's arrays and a byte of the bit array.
+   The data array is allocated first and acts as a lock,
+   and the bit array is published only after it. */
+#if defined(__GNUC__)
+static void alloc_tag(struct mds_tag* tag, struct mds* m, int t)
+{
+  unsigned char* has;
+  char* data;
+  has = calloc((m->cap[t] / 8) + 1, 1);
+  data = malloc(tag->bytes * m->cap[t]);
+  if (__sync_bool_compare_and_swap(&tag->data[t], NULL, data)) {
+    __sync_synchronize();
+    tag->has[t] = has;
+    return;
+  }
+  free(has);
+  free(data);
+  while ( ! *((unsigned char* volatile*)(&tag->has[t])));
+}
+
+static void set_bit(unsigned char* has, int b)
+{
+  __sync_fetch_and_or(has, (unsigned char)(1 << b));
+}
+
+static void clear_bit(unsigned char* has, int b)
+{
+  __sync_fetch_and_and(has, (unsigned char)(~(1 << b)));
+}
+#else
+static void alloc_tag(struct mds_tag* tag, struct mds* m, int t)
+{
+  tag->has[t] = calloc((m->cap[t] / 8) + 1, 1);
+  tag->data[t] = malloc(tag->bytes * m->cap[t]);
+}
+
+static void set_bit(unsigned char* has, int b)
+{
+  *has |= (1 << b);
+}
+
+static void clear_bit(unsigned char* has, int b)
+{
+  *has &= ~(1 << b);
+}
+#endif
+
 void mds_give_tag(struct mds_tag* tag, struct mds* m, mds_id e)
 {
   int t;
   mds_id i;
   mds_id c;
   int b;
-  unsigned char* has;
   t = mds_type(e);
-  if ( ! tag->has[t]) {
-    tag->has[t] = calloc((m->cap[t] / 8) + 1, 1);
-    tag->data[t] = malloc(tag->bytes * m->cap[t]);
-  }
+  if ( ! tag->has[t])
+    alloc_tag(tag, m, t);
   i = mds_index(e);
   c = i / 8;
   b = i % 8;
-  has = tag->has[t] + c;
-  *has |= (1<<b);
+  set_bit(tag->has[t] + c, b);
 }
 
 void mds_take_tag(struct mds_tag* tag, mds_id e)
@@ -143,15 +188,13 @@ void mds_take_tag(struct mds_tag* tag, mds_id e)
   mds_id i;
   mds_id c;
   int b;
-  unsigned char* has;
   t = mds_type(e);
   i = mds_index(e);
   c = i / 8;
   b = i % 8;
   if (!tag->has[t])
     return;
-  has = tag->has[t] + c;
-  *has &= ~(1 << b);
+  clear_bit(tag->has[t] + c, b);
 }
 
 static struct mds_tag** find_prev(struct mds_tags* ts, struct mds_tag* t)
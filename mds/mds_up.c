@@ -0,0 +1,224 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#include "mds_up.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* each upward adjacency is a linked list whose nodes are the
+   slots of the downward adjacency arrays that point back at
+   the entity. mds_freeze_up copies the lists into compressed
+   rows for meshes that stop changing for a while. */
+
+static void* up_realloc(void* p, size_t n)
+{
+  if (!n) {
+    free(p);
+    return NULL;
+  }
+  return realloc(p,n);
+}
+
+#define REALLOC(p,n) ((p)=up_realloc(p,(n)*sizeof(*(p))))
+
+static mds_id* at_id(mds_id* a[MDS_TYPES], mds_id x)
+{
+  return &(a[TYPE(x)][INDEX(x)]);
+}
+
+static void relate_one(struct mds* m, mds_id e, mds_id node)
+{
+  int node_dim;
+  int e_dim;
+  mds_id* head;
+  mds_id* nodep;
+  e_dim = mds_dim[TYPE(e)];
+  node_dim = mds_dim[TYPE(node)];
+  head = at_id(m->first_up[node_dim],e);
+  nodep = at_id(m->up[e_dim],node);
+  *nodep = *head;
+  *head = node;
+}
+
+static void unrelate_one(struct mds* m, mds_id e, mds_id node)
+{
+  int node_dim;
+  int e_dim;
+  mds_id* prev;
+  e_dim = mds_dim[TYPE(e)];
+  node_dim = mds_dim[TYPE(node)];
+  prev = at_id(m->first_up[node_dim],e);
+  while (*prev != node)
+    prev = at_id(m->up[e_dim],*prev);
+  *prev = *at_id(m->up[e_dim],node);
+}
+
+void mds_relate_up(struct mds* m, mds_id* from, mds_id to)
+{
+  int t;
+  mds_id i;
+  int j;
+  int deg;
+  int from_dim;
+  mds_id x;
+  t = TYPE(to);
+  i = INDEX(to);
+  from_dim = mds_dim[TYPE(from[0])];
+  deg = mds_degree[t][from_dim];
+  for (j = 0; j < deg; ++j) {
+    x = ID(t, i * deg + j);
+    relate_one(m,from[j],x);
+  }
+}
+
+void mds_unrelate_up(struct mds* m, mds_id* from, mds_id to)
+{
+  int t;
+  mds_id i;
+  int j;
+  int deg;
+  int from_dim;
+  mds_id x;
+  t = TYPE(to);
+  i = INDEX(to);
+  from_dim = mds_dim[TYPE(from[0])];
+  deg = mds_degree[t][from_dim];
+  for (j = 0; j < deg; ++j) {
+    x = ID(t, i * deg + j);
+    unrelate_one(m,from[j],x);
+  }
+}
+
+static void look_up_frozen(struct mds* m, mds_id e, int d,
+    struct mds_set* s)
+{
+  mds_id* first;
+  mds_id* up;
+  int j;
+  first = m->frozen_first[d][TYPE(e)] + INDEX(e);
+  up = m->frozen_up[d][TYPE(e)] + first[0];
+  s->n = first[1] - first[0];
+  for (j = 0; j < s->n; ++j)
+    s->e[j] = up[j];
+}
+
+void mds_look_up(struct mds* m, mds_id const e, int d, struct mds_set* s)
+{
+  mds_id* n;
+  mds_id nv;
+  int t;
+  mds_id i;
+  int deg;
+  mds_id* es = s->e;
+  mds_id** p;
+  if (m->frozen) {
+    look_up_frozen(m,e,d,s);
+    return;
+  }
+  t = TYPE(e);
+  i = INDEX(e);
+  p = m->first_up[d];
+  n = p[t] + i;
+  nv = *n;
+  d = mds_dim[t];
+  p = m->up[d];
+  while (nv != MDS_NONE) {
+    t = TYPE(nv);
+    i = INDEX(nv);
+    deg = mds_degree[t][d];
+    *es = ID(t, i / deg);
+    ++es;
+    n = p[t] + i;
+    nv = *n;
+  }
+  s->n = es - s->e;
+}
+
+
+int mds_has_up(struct mds* m, mds_id e)
+{
+  int d;
+  d = mds_dim[TYPE(e)];
+  if (d == m->d)
+    return 0;
+  if (m->frozen)
+    return mds_count_up(m,e) != 0;
+  return *at_id(m->first_up[d + 1],e) != MDS_NONE;
+}
+
+int mds_count_up(struct mds* m, mds_id e)
+{
+  int d;
+  mds_id* first;
+  struct mds_set s;
+  d = mds_dim[TYPE(e)];
+  if (d == m->d)
+    return 0;
+  if (m->frozen) {
+    first = at_id(m->frozen_first[d + 1],e);
+    return first[1] - first[0];
+  }
+  mds_look_up(m,e,d + 1,&s);
+  return s.n;
+}
+
+static void freeze_up(struct mds* m, int to_dim, int t)
+{
+  mds_id i;
+  mds_id* first;
+  struct mds_set s;
+  REALLOC(m->frozen_first[to_dim][t],m->end[t] + 1);
+  first = m->frozen_first[to_dim][t];
+  first[0] = 0;
+  for (i = 0; i < m->end[t]; ++i) {
+    s.n = 0;
+    if (m->free[t][i] == MDS_LIVE)
+      mds_look_up(m,ID(t,i),to_dim,&s);
+    first[i + 1] = first[i] + s.n;
+  }
+  REALLOC(m->frozen_up[to_dim][t],first[m->end[t]]);
+  for (i = 0; i < m->end[t]; ++i)
+    if (m->free[t][i] == MDS_LIVE) {
+      mds_look_up(m,ID(t,i),to_dim,&s);
+      memcpy(m->frozen_up[to_dim][t] + first[i],s.e,s.n * sizeof(mds_id));
+    }
+}
+
+/* copies the upward adjacency linked lists into compressed
+   row arrays, which are read instead of the lists until
+   the next modification of the structure thaws them.
+   the order of each upward set is preserved. */
+void mds_freeze_up(struct mds* m)
+{
+  int i,j;
+  int t;
+  mds_thaw_up(m);
+  for (i = 0; i <= 3; ++i)
+  for (j = i + 1; j <= 3; ++j)
+    if (m->mrm[i][j])
+      for (t = 0; t < MDS_TYPES; ++t)
+        if (mds_dim[t] == i)
+          freeze_up(m,j,t);
+  m->frozen = 1;
+}
+
+void mds_thaw_up(struct mds* m)
+{
+  int i;
+  int t;
+  if (!m->frozen)
+    return;
+  for (i = 0; i <= 3; ++i)
+  for (t = 0; t < MDS_TYPES; ++t) {
+    REALLOC(m->frozen_first[i][t],0);
+    REALLOC(m->frozen_up[i][t],0);
+  }
+  m->frozen = 0;
+}
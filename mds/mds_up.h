@@ -0,0 +1,28 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+
+#ifndef MDS_UP_H
+#define MDS_UP_H
+
+#include "mds.h"
+
+/* internals shared by mds.c and mds_up.c */
+
+#define MDS_LIVE -2
+
+#define ID(t,i) ((i)*MDS_TYPES + (t))
+#define TYPE(id) ((id) % MDS_TYPES)
+#define INDEX(id) ((id) / MDS_TYPES)
+
+void mds_relate_up(struct mds* m, mds_id* from, mds_id to);
+void mds_unrelate_up(struct mds* m, mds_id* from, mds_id to);
+void mds_look_up(struct mds* m, mds_id e, int d, struct mds_set* s);
+
+#endif
@@ -38,6 +38,7 @@ void PCU_Comm_Begin(void);
 int PCU_Comm_Pack(int to_rank, const void* data, size_t size);
 #define PCU_COMM_PACK(to_rank,object)\
 PCU_Comm_Pack(to_rank,&(object),sizeof(object))
+void* PCU_Comm_Reserve(int to_rank, size_t size);
 int PCU_Comm_Send(void);
 bool PCU_Comm_Receive(void);
 bool PCU_Comm_Listen(void);
@@ -47,6 +48,12 @@ int PCU_Comm_Unpack(void* data, size_t size);
 #define PCU_COMM_UNPACK(object)\
 PCU_Comm_Unpack(&(object),sizeof(object))
 
+/*persistent neighbor API*/
+void PCU_Comm_Keep_Peers(bool keep);
+void PCU_Comm_Set_Neighbors(int n, int const* ranks);
+void PCU_Comm_Clear_Neighbors(void);
+int PCU_Comm_Get_Neighbors(int const** ranks);
+
 /*collective operations*/
 void PCU_Barrier(void);
 void PCU_Add_Doubles(double* p, size_t n);
@@ -58,6 +65,7 @@ void PCU_Exscan_Ints(int* p, size_t n);
 void PCU_Exscan_Longs(long* p, size_t n);
 void PCU_Min_Ints(int* p, size_t n);
 void PCU_Max_Ints(int* p, size_t n);
+void PCU_Max_Longs(long* p, size_t n);
 int PCU_Or(int c);
 
 /*thread functions*/
@@ -69,6 +77,13 @@ void PCU_Thrd_Barrier(void);
 void PCU_Thrd_Lock(void);
 void PCU_Thrd_Unlock(void);
 
+/*worker threads that do not communicate*/
+typedef void (*PCU_Work_Func)(int thread, void* data);
+void PCU_Work_Run(int nthreads, PCU_Work_Func function, void* data);
+int PCU_Work_Thread(void);
+void PCU_Work_Lock(void);
+void PCU_Work_Unlock(void);
+
 /*process-level self/peers (mpi wrappers)*/
 int PCU_Proc_Self(void);
 int PCU_Proc_Peers(void);
@@ -113,6 +128,9 @@ MPI_Comm PCU_Get_Comm(void);
 void PCU_Trace(void);
 void PCU_Protect(void);
 
+/*heap memory in use by this process, in megabytes*/
+double PCU_GetMem(void);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
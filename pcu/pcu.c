@@ -66,6 +66,8 @@ static pcu_msg global_pmsg;
 static pcu_msg* global_tmsg = NULL;
 static PCU_Thrd_Func global_function = NULL;
 static void** global_args = NULL;
+#else
+static int global_work_thread = 0;
 #endif
 
 static pcu_msg* get_msg()
@@ -169,6 +171,27 @@ int PCU_Comm_Pack(int to_rank, const void* data, size_t size)
   return PCU_SUCCESS;
 }
 
+/** \brief Reserves space for data to be sent to \a to_rank.
+  \details This function appends \a size bytes to the buffer being
+  sent to \a to_rank and returns a pointer to them, which the caller
+  should fill in.
+  This lets users serialize data directly into the send buffer
+  instead of into a temporary array followed by PCU_Comm_Pack.
+  The pointer is only valid until the next call to PCU_Comm_Pack,
+  PCU_Comm_Reserve, or PCU_Comm_Write for the same \a to_rank,
+  since those may reallocate the buffer.
+  On the receiving side, PCU_Comm_Extract is the equivalent of
+  this function for unpacking.
+ */
+void* PCU_Comm_Reserve(int to_rank, size_t size)
+{
+  if (global_state == uninit)
+    pcu_fail("Comm_Reserve called before Comm_Init");
+  if ((to_rank < 0)||(to_rank >= pcu_mpi_size()))
+    pcu_fail("Invalid rank in Comm_Reserve");
+  return pcu_msg_pack(get_msg(),to_rank,size);
+}
+
 /** \brief Sends all buffers for this communication phase.
   \details This function should be called by all threads in the MPI job
   after calls to PCU_Comm_Pack or PCU_Comm_Write and before calls
@@ -240,6 +263,94 @@ int PCU_Comm_Unpack(void* data, size_t size)
   return PCU_SUCCESS;
 }
 
+/** \brief Keeps the set of peers between communication phases.
+  \details By default, the send buffers of a phase are freed when
+  the phase ends.
+  After calling this function with \a keep set to true, the peers
+  this thread packed data for are kept for the next phases,
+  along with the allocated capacity of their buffers.
+  This suits codes that exchange messages with the same neighbors
+  over many phases, since packing no longer allocates or inserts
+  peers after the first phase.
+  In this mode, peers that nothing was packed for in a phase are
+  not sent a message.
+  Calling this function with \a keep set to false frees the kept
+  buffers and restores the default behavior.
+  This function should be called outside of a communication phase.
+ */
+void PCU_Comm_Keep_Peers(bool keep)
+{
+  if (global_state == uninit)
+    pcu_fail("Comm_Keep_Peers called before Comm_Init");
+  pcu_msg_keep_peers(get_msg(),keep);
+}
+
+/** \brief Switches phases to a transport based on a known neighbor graph.
+  \details After this call, a phase only exchanges messages between
+  each rank and the \a n ranks in \a ranks.
+  Instead of detecting termination with a global non-blocking barrier
+  and probing for messages from any rank, each phase exchanges message
+  sizes with the neighbors and then receives exactly the messages
+  announced, which is much cheaper at large rank counts.
+  The rest of the message passing API is unchanged, except that
+  packing for a rank that is not a neighbor is an error and
+  neighbors that were sent nothing receive no message.
+
+  All ranks must call this between the same two phases, and the
+  neighbor graph must be symmetric: if rank a lists rank b,
+  then rank b must list rank a.
+  A typical graph is the output of apf::getPeers.
+  The call itself does not communicate: the transports use separate
+  message tags and MPI keeps the messages between two ranks in order,
+  so ranks do not need to switch at the same time.
+  Inside PCU_Thrd_Run this call has no effect and phases keep
+  the default transport, which delivers the same messages.
+ */
+void PCU_Comm_Set_Neighbors(int n, int const* ranks)
+{
+  if (global_state == uninit)
+    pcu_fail("Comm_Set_Neighbors called before Comm_Init");
+  if (pcu_get_mpi() != &pcu_pmpi)
+    return;
+  for (int i = 0; i < n; ++i)
+    if ((ranks[i] < 0)||(ranks[i] >= pcu_mpi_size()))
+      pcu_fail("Invalid rank in Comm_Set_Neighbors");
+  pcu_msg_set_neighbors(get_msg(),n,ranks);
+}
+
+/** \brief Returns phases to the default transport.
+  \details This undoes PCU_Comm_Set_Neighbors, after which any
+  rank may again send to any other.
+  Like PCU_Comm_Set_Neighbors, all ranks must call this
+  between the same two phases.
+ */
+void PCU_Comm_Clear_Neighbors(void)
+{
+  if (global_state == uninit)
+    pcu_fail("Comm_Clear_Neighbors called before Comm_Init");
+  if (pcu_get_mpi() != &pcu_pmpi)
+    return;
+  pcu_msg_clear_neighbors(get_msg());
+}
+
+/** \brief Returns the neighbors set by PCU_Comm_Set_Neighbors.
+  \details (ranks) is pointed at PCU's copy of them, which stays
+  valid until the neighbors are next set or cleared, so callers
+  that want to restore them later should copy it.
+  Returns -1, with (ranks) set to NULL, when phases use the
+  default transport.
+ */
+int PCU_Comm_Get_Neighbors(int const** ranks)
+{
+  if (global_state == uninit)
+    pcu_fail("Comm_Get_Neighbors called before Comm_Init");
+  if (pcu_get_mpi() != &pcu_pmpi) {
+    *ranks = NULL;
+    return -1;
+  }
+  return pcu_msg_get_neighbors(get_msg(),ranks);
+}
+
 /** \brief Blocking barrier over all threads. */
 void PCU_Barrier(void)
 {
@@ -352,6 +463,15 @@ void PCU_Max_Ints(int* p, size_t n)
   pcu_allreduce(&(get_msg()->coll),pcu_max_ints,p,n*sizeof(int));
 }
 
+/** \brief Performs an Allreduce maximum of long arrays.
+  */
+void PCU_Max_Longs(long* p, size_t n)
+{
+  if (global_state == uninit)
+    pcu_fail("Max_Longs called before Comm_Init");
+  pcu_allreduce(&(get_msg()->coll),pcu_max_longs,p,n*sizeof(long));
+}
+
 /** \brief Performs a parallel logical OR reduction
   */
 int PCU_Or(int c)
@@ -488,6 +608,66 @@ void PCU_Thrd_Unlock(void)
 #endif
 }
 
+/** \brief Runs \a function on \a nthreads worker threads.
+  \details Worker i calls \a function with i as its first argument
+  and \a data as its second, and the caller thread runs worker 0.
+  This returns after all workers have returned.
+  Unlike PCU_Thrd_Run, this does not change the PCU environment:
+  workers are not given ranks and should not call any PCU function
+  other than PCU_Work_Thread, PCU_Work_Lock and PCU_Work_Unlock,
+  so they should only do local work on shared data.
+  This call is not collective.
+  If PCU was built without threads, the workers run one
+  after another in the caller thread.
+ */
+void PCU_Work_Run(int nthreads, PCU_Work_Func function, void* data)
+{
+#if ENABLE_THREADS
+  pcu_run_workers(nthreads,function,data);
+#else
+  for (int i=0; i < nthreads; ++i)
+  {
+    global_work_thread = i;
+    function(i,data);
+  }
+  global_work_thread = 0;
+#endif
+}
+
+/** \brief Returns the index of the calling PCU_Work_Run worker.
+  \details This lets code called deep inside a worker find its
+  per-thread state without passing the index down.
+  Outside of PCU_Work_Run this returns 0.
+ */
+int PCU_Work_Thread(void)
+{
+#if ENABLE_THREADS
+  return pcu_worker_rank();
+#else
+  return global_work_thread;
+#endif
+}
+
+/** \brief Acquire the lock shared by all PCU_Work_Run workers.
+  \details This lets workers build shared caches and the like.
+  It is a plain mutex, so a worker must not take it twice.
+  If PCU was built without threads, this does nothing.
+ */
+void PCU_Work_Lock(void)
+{
+#if ENABLE_THREADS
+  pcu_worker_lock();
+#endif
+}
+
+/** \brief Release the lock taken by PCU_Work_Lock. */
+void PCU_Work_Unlock(void)
+{
+#if ENABLE_THREADS
+  pcu_worker_unlock();
+#endif
+}
+
 /** \brief Returns the unique rank of the calling process.
  */
 int PCU_Proc_Self(void)
@@ -27,6 +27,15 @@ void pcu_add_doubles(void* local, void* incoming, size_t size)
     a[i] += b[i];
 }
 
+void pcu_max_longs(void* local, void* incoming, size_t size)
+{
+  long* a = local;
+  long* b= incoming;
+  size_t n = size/sizeof(long);
+  for (size_t i=0; i < n; ++i)
+    a[i] = MAX(a[i],b[i]);
+}
+
 void pcu_max_doubles(void* local, void* incoming, size_t size)
 {
   double* a = local;
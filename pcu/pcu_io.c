@@ -8,6 +8,7 @@
 
 *******************************************************************************/
 #include "pcu_io.h"
+#include "PCU.h"
 #include "pcu_common.h"
 #include "pcu_memory.h"
 #include "pcu_mpi.h"
@@ -23,21 +24,148 @@ typedef struct pcu_file {
   off_t pos;
   bool write;
   bool compress;
+  int codec;
 } pcu_file;
 
 #ifdef PCU_BZIP
 #include <bzlib.h>
+#ifdef PCU_ZSTD
+#include <zstd.h>
+#endif
 
-static void open_compressed(pcu_file* pf)
+/* Compressed files are split into independently compressed blocks
+   so that several PCU_Work_Run workers can handle them at once.
+   The layout is
+     "PCUB"
+     codec and block count, 32-bit big endian
+     raw and compressed size of each block, 64-bit big endian
+     the compressed blocks
+   Files that do not start with "PCUB" are read as one bzip2
+   stream, which is how compressed files used to be written. */
+
+enum { BLOCK_SIZE = 1 << 22 };
+/* the codec values stored in the files */
+enum { CODEC_BZIP2, CODEC_ZSTD };
+
+static int compress_threads = 1;
+
+void pcu_set_compress_threads(int n)
 {
-  off_t file_size;
-  fseek(pf->f, 0, SEEK_END);
-  file_size = ftello(pf->f);
-  rewind(pf->f);
+  compress_threads = n < 1 ? 1 : n;
+}
 
-  void* buf = malloc(file_size);
-  fread(buf, 1, file_size, pf->f);
+typedef struct
+{
+  char* raw;
+  size_t raw_size;
+  char* zip;
+  size_t zip_size;
+  int codec;
+  bool ok;
+} pcu_block;
+
+typedef struct
+{
+  pcu_block* blocks;
+  size_t n;
+  int nthreads;
+  bool compress;
+} pcu_block_job;
+
+static void compress_block(pcu_block* b)
+{
+  unsigned int len;
+#ifdef PCU_ZSTD
+  if (b->codec == CODEC_ZSTD)
+  {
+    b->zip = malloc(ZSTD_compressBound(b->raw_size));
+    b->zip_size = ZSTD_compress(b->zip, ZSTD_compressBound(b->raw_size),
+        b->raw, b->raw_size, 1);
+    b->ok = !ZSTD_isError(b->zip_size);
+    return;
+  }
+#endif
+  /* the bzip2 manual bounds the output by 1% plus 600 bytes */
+  len = b->raw_size + b->raw_size / 100 + 600;
+  b->zip = malloc(len);
+  b->ok = BZ2_bzBuffToBuffCompress(b->zip, &len,
+      b->raw, b->raw_size, 1, 0, 0) == BZ_OK;
+  b->zip_size = len;
+}
+
+static void decompress_block(pcu_block* b)
+{
+  unsigned int len;
+  if (b->codec == CODEC_ZSTD)
+  {
+#ifdef PCU_ZSTD
+    size_t r = ZSTD_decompress(b->raw, b->raw_size, b->zip, b->zip_size);
+    b->ok = !ZSTD_isError(r) && r == b->raw_size;
+#else
+    b->ok = false;
+#endif
+    return;
+  }
+  len = b->raw_size;
+  b->ok = BZ2_bzBuffToBuffDecompress(b->raw, &len,
+      b->zip, b->zip_size, 0, 0) == BZ_OK && len == b->raw_size;
+}
 
+/* blocks all have the same size but the last,
+   so each worker takes every nthreads-th one */
+static void work_on_blocks(int thread, void* arg)
+{
+  pcu_block_job* job = arg;
+  size_t i;
+  for (i = thread; i < job->n; i += job->nthreads)
+    if (job->compress)
+      compress_block(job->blocks + i);
+    else
+      decompress_block(job->blocks + i);
+}
+
+static void run_blocks(pcu_block* blocks, size_t n, bool compress)
+{
+  pcu_block_job job;
+  size_t j;
+  job.blocks = blocks;
+  job.n = n;
+  job.compress = compress;
+  job.nthreads = compress_threads;
+  if ((size_t)job.nthreads > n)
+    job.nthreads = n;
+  if (job.nthreads)
+    PCU_Work_Run(job.nthreads, work_on_blocks, &job);
+  for (j = 0; j < n; ++j)
+    if (!blocks[j].ok)
+    {
+      if (blocks[j].codec == CODEC_ZSTD)
+        pcu_fail("zstd block failed, zstd needs PCU_ZSTD=ON");
+      pcu_fail("bzip2 block failed");
+    }
+}
+
+static void put_big(unsigned char* p, uint64_t x, int bytes)
+{
+  int i;
+  for (i = bytes - 1; i >= 0; --i)
+  {
+    p[i] = x & 0xff;
+    x >>= 8;
+  }
+}
+
+static uint64_t get_big(unsigned char const* p, int bytes)
+{
+  uint64_t x = 0;
+  int i;
+  for (i = 0; i < bytes; ++i)
+    x = (x << 8) | p[i];
+  return x;
+}
+
+static void open_single_stream(pcu_file* pf, void* buf, off_t file_size)
+{
   unsigned int len = file_size;
   pcu_make_buffer(&pf->buf);
   pcu_push_buffer(&pf->buf, len);
@@ -58,24 +186,108 @@ static void open_compressed(pcu_file* pf)
   }
 
   pcu_resize_buffer (&pf->buf, (size_t) len);
-  free (buf);
+}
 
+static void open_blocks(pcu_file* pf, unsigned char* buf, off_t file_size)
+{
+  unsigned char* p = buf + 4;
+  int codec;
+  size_t n, i;
+  size_t raw_size = 0;
+  pcu_block* blocks;
+  char* raw;
+  char* zip;
+  codec = get_big(p, 4);
+  n = get_big(p + 4, 4);
+  p += 8;
+  if (12 + 16 * (off_t)n > file_size)
+    pcu_fail("compressed file is truncated");
+  blocks = malloc(n * sizeof(pcu_block));
+  for (i = 0; i < n; ++i)
+  {
+    blocks[i].codec = codec;
+    blocks[i].raw_size = get_big(p, 8);
+    blocks[i].zip_size = get_big(p + 8, 8);
+    raw_size += blocks[i].raw_size;
+    p += 16;
+  }
+  pcu_make_buffer(&pf->buf);
+  pcu_push_buffer(&pf->buf, raw_size);
+  raw = pf->buf.start;
+  zip = (char*)p;
+  for (i = 0; i < n; ++i)
+  {
+    blocks[i].raw = raw;
+    blocks[i].zip = zip;
+    raw += blocks[i].raw_size;
+    zip += blocks[i].zip_size;
+  }
+  if (zip > (char*)buf + file_size)
+    pcu_fail("compressed file is truncated");
+  run_blocks(blocks, n, false);
+  free(blocks);
 }
 
-static void close_compressed(pcu_file* pf)
+static void open_compressed(pcu_file* pf)
 {
-  void * buf;
-  unsigned int len;
-  len = pf->buf.size;
-  buf = malloc (len);
-
-  /* May change the last value (workfactor) to get different results.*/
-  BZ2_bzBuffToBuffCompress (buf, &len,
-      pf->buf.start, len,
-      1, 0, 0);
-  fwrite (buf, 1, len, pf->f);
+  off_t file_size;
+  fseek(pf->f, 0, SEEK_END);
+  file_size = ftello(pf->f);
+  rewind(pf->f);
+
+  void* buf = malloc(file_size);
+  if (fread(buf, 1, file_size, pf->f) != (size_t)file_size)
+    pcu_fail("fread failed");
+
+  if (file_size >= 12 && !memcmp(buf, "PCUB", 4))
+    open_blocks(pf, buf, file_size);
+  else
+    open_single_stream(pf, buf, file_size);
   free (buf);
 }
+
+static void close_compressed(pcu_file* pf)
+{
+  size_t n, i;
+  size_t header_size;
+  unsigned char* header;
+  pcu_block* blocks;
+  int codec = CODEC_BZIP2;
+  if (pf->codec == PCU_CODEC_ZSTD)
+    codec = CODEC_ZSTD;
+  n = (pf->buf.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  blocks = malloc(n * sizeof(pcu_block));
+  for (i = 0; i < n; ++i)
+  {
+    blocks[i].codec = codec;
+    blocks[i].raw = pf->buf.start + i * BLOCK_SIZE;
+    blocks[i].raw_size = BLOCK_SIZE;
+  }
+  if (n)
+    blocks[n - 1].raw_size = pf->buf.size - (n - 1) * BLOCK_SIZE;
+  run_blocks(blocks, n, true);
+  header_size = 12 + 16 * n;
+  header = malloc(header_size);
+  memcpy(header, "PCUB", 4);
+  put_big(header + 4, codec, 4);
+  put_big(header + 8, n, 4);
+  for (i = 0; i < n; ++i)
+  {
+    put_big(header + 12 + 16 * i, blocks[i].raw_size, 8);
+    put_big(header + 20 + 16 * i, blocks[i].zip_size, 8);
+  }
+  if (fwrite(header, 1, header_size, pf->f) != header_size)
+    pcu_fail("fwrite failed");
+  for (i = 0; i < n; ++i)
+  {
+    if (fwrite(blocks[i].zip, 1, blocks[i].zip_size, pf->f)
+        != blocks[i].zip_size)
+      pcu_fail("fwrite failed");
+    free(blocks[i].zip);
+  }
+  free(header);
+  free(blocks);
+}
 #else
 static void open_compressed(pcu_file* pf)
 {
@@ -88,10 +300,41 @@ static void close_compressed(pcu_file* pf)
   (void)pf;
   pcu_fail("recompile with bzip2 support");
 }
+
+void pcu_set_compress_threads(int n)
+{
+  (void)n;
+}
 #endif
 
-pcu_file* pcu_fopen(const char* name, bool write, bool compress)
+/* a memory file keeps its contents in pf->buf and has no FILE */
+pcu_file* pcu_mopen(const void* data, size_t size, bool write)
+{
+  pcu_file* pf = (pcu_file*) malloc(sizeof(pcu_file));
+  pf->f = NULL;
+  pcu_make_buffer(&pf->buf);
+  if (!write)
+    memcpy(pcu_push_buffer(&pf->buf, size), data, size);
+  pf->compress = false;
+  pf->codec = PCU_CODEC_NONE;
+  pf->write = write;
+  pf->pos = 0;
+  return pf;
+}
+
+void pcu_mdata(pcu_file* pf, void** data, size_t* size)
 {
+  assert(!pf->f);
+  *data = pf->buf.start;
+  *size = pf->buf.size;
+}
+
+pcu_file* pcu_fopen(const char* name, bool write, int codec)
+{
+#ifndef PCU_ZSTD
+  if (write && codec == PCU_CODEC_ZSTD)
+    pcu_fail("recompile with zstd support");
+#endif
   pcu_file* pf = (pcu_file*) malloc(sizeof(pcu_file));
 
   if (write)
@@ -104,7 +347,7 @@ pcu_file* pcu_fopen(const char* name, bool write, bool compress)
     pcu_fail("fopen failed");
   }
 
-  if (compress)
+  if (codec)
   {
     if (write)
       pcu_make_buffer(&pf->buf);
@@ -112,7 +355,8 @@ pcu_file* pcu_fopen(const char* name, bool write, bool compress)
       open_compressed(pf);
   }
 
-  pf->compress = compress;
+  pf->compress = codec != PCU_CODEC_NONE;
+  pf->codec = codec;
   pf->write = write;
   pf->pos = 0;
 
@@ -121,6 +365,11 @@ pcu_file* pcu_fopen(const char* name, bool write, bool compress)
 
 void pcu_fclose(pcu_file* pf)
 {
+  if (!pf->f) {
+    pcu_free_buffer(&pf->buf);
+    free(pf);
+    return;
+  }
   // Flush the buffer when writing.
   if (pf->compress && pf->write)
     close_compressed(pf);
@@ -135,7 +384,7 @@ void pcu_fwrite(void const* p, size_t size, size_t nmemb, pcu_file * f)
   if (!f->write)
     pcu_fail("file not opened for writing.");
 
-  if (f->compress)
+  if (f->compress || !f->f)
   {
     void* write_me = pcu_push_buffer (&f->buf, size * nmemb);
     memcpy(write_me, p, size * nmemb);
@@ -153,8 +402,10 @@ void pcu_fread(void* p, size_t size, size_t nmemb, pcu_file * f)
   if (f->write)
     pcu_fail("file not opened for reading.");
 
-  if (f->compress)
+  if (f->compress || !f->f)
   {
+    if ((size_t)f->pos + size * nmemb > f->buf.size)
+      pcu_fail("read past end of buffer");
     void * read_me = f->buf.start + f->pos;
     memcpy(p, read_me, size * nmemb);
     f->pos += size * nmemb;
@@ -182,31 +433,28 @@ static const uint16_t pcu_endian_value = 1;
 #define PCU_BIG_ENDIAN 0
 #define PCU_ENCODED_ENDIAN PCU_BIG_ENDIAN //consistent with network byte order
 
-static void pcu_swap_16(uint16_t* p)
-{
-  uint8_t* p2 = (uint8_t*)p;
-  uint8_t temp = p2[0];
-  p2[0] = p2[1];
-  p2[1] = temp;
-}
-
+/* written with shifts so that compilers emit a single
+   byte swap instruction, these run over whole mesh files */
 static void pcu_swap_32(uint32_t* p)
 {
-  uint16_t* p2 = (uint16_t*)p;
-  uint16_t temp = p2[0];
-  p2[0] = p2[1];
-  p2[1] = temp;
-  pcu_swap_16(p2);
-  pcu_swap_16(p2+1);
+  uint32_t x = *p;
+  *p = (x >> 24) | ((x >> 8) & 0xff00) |
+       ((x << 8) & 0xff0000) | (x << 24);
 }
 
 static void pcu_swap_64(uint32_t* p)
 {
-  uint32_t temp = p[0];
-  p[0] = p[1];
-  p[1] = temp;
-  pcu_swap_32(p);
-  pcu_swap_32(p+1);
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  x = ((x >> 56)) |
+      ((x >> 40) & 0xff00ULL) |
+      ((x >> 24) & 0xff0000ULL) |
+      ((x >> 8)  & 0xff000000ULL) |
+      ((x << 8)  & 0xff00000000ULL) |
+      ((x << 24) & 0xff0000000000ULL) |
+      ((x << 40) & 0xff000000000000ULL) |
+      ((x << 56));
+  memcpy(p, &x, sizeof(x));
 }
 
 void pcu_swap_unsigneds(unsigned* p, size_t n)
@@ -223,6 +471,13 @@ void pcu_swap_doubles(double* p, size_t n)
     pcu_swap_64((uint32_t*)(p++));
 }
 
+void pcu_swap_longs(long* p, size_t n)
+{
+  assert(sizeof(long)==8);
+  for (size_t i=0; i < n; ++i)
+    pcu_swap_64((uint32_t*)(p++));
+}
+
 void pcu_write_unsigneds(pcu_file* f, unsigned* p, size_t n)
 {
   unsigned* tmp;
@@ -251,6 +506,20 @@ void pcu_write_doubles(pcu_file* f, double* p, size_t n)
   }
 }
 
+void pcu_write_longs(pcu_file* f, long* p, size_t n)
+{
+  long* tmp;
+  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN) {
+    tmp = malloc(n * sizeof(long));
+    memcpy(tmp, p, n * sizeof(long));
+    pcu_swap_longs(tmp, n);
+    pcu_fwrite(tmp,sizeof(long),n,f);
+    free(tmp);
+  } else {
+    pcu_fwrite(p,sizeof(long),n,f);
+  }
+}
+
 void pcu_read_unsigneds(pcu_file* f, unsigned* p, size_t n)
 {
   pcu_fread(p,sizeof(unsigned),n,f);
@@ -265,6 +534,13 @@ void pcu_read_doubles(pcu_file* f, double* p, size_t n)
     pcu_swap_doubles(p,n);
 }
 
+void pcu_read_longs(pcu_file* f, long* p, size_t n)
+{
+  pcu_fread(p,sizeof(long),n,f);
+  if (PCU_ENDIANNESS != PCU_ENCODED_ENDIAN)
+    pcu_swap_longs(p,n);
+}
+
 void pcu_read_string (pcu_file* f, char ** p)
 {
   pcu_buffer buf;
@@ -21,8 +21,19 @@ extern "C" {
 
 struct pcu_file;
 
-struct pcu_file* pcu_fopen(const char* path, bool write, bool compress);
+/* how pcu_fopen compresses a file it writes.
+   reading finds the codec in the file, so any nonzero value
+   just asks for decompression. */
+enum { PCU_CODEC_NONE, PCU_CODEC_BZIP2, PCU_CODEC_ZSTD };
+struct pcu_file* pcu_fopen(const char* path, bool write, int codec);
+/* number of PCU_Work_Run workers compressing or decompressing
+   the blocks of compressed files, the default is 1 */
+void pcu_set_compress_threads(int n);
 void pcu_fclose (struct pcu_file * pf);
+/* memory files: reading starts from a copy of data,
+   pcu_mdata gives what was written until pcu_fclose */
+struct pcu_file* pcu_mopen(const void* data, size_t size, bool write);
+void pcu_mdata(struct pcu_file* pf, void** data, size_t* size);
 void pcu_read(struct pcu_file* f, char* p, size_t n);
 void pcu_write(struct pcu_file* f, const char* p, size_t n);
 void pcu_read_unsigneds(struct pcu_file* f, unsigned* p, size_t n);
@@ -31,12 +42,15 @@ void pcu_write_unsigneds(struct pcu_file* f, unsigned* p, size_t n);
 #define PCU_WRITE_UNSIGNED(f,p) pcu_write_unsigneds(f,&(p),1);
 void pcu_read_doubles(struct pcu_file* f, double* p, size_t n);
 void pcu_write_doubles(struct pcu_file* f, double* p, size_t n);
+void pcu_read_longs(struct pcu_file* f, long* p, size_t n);
+void pcu_write_longs(struct pcu_file* f, long* p, size_t n);
 void pcu_read_string(struct pcu_file* f, char** p);
 void pcu_write_string(struct pcu_file* f, const char* p);
 
 FILE* pcu_open_parallel(const char* prefix, const char* ext);
 
 void pcu_swap_doubles(double* p, size_t n);
+void pcu_swap_longs(long* p, size_t n);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -8,6 +8,7 @@
 
 *******************************************************************************/
 #include <stdlib.h>
+#include "PCU.h"
 #include "pcu_common.h"
 #include "pcu_memory.h"
 #include "pcu_thread.h"
@@ -91,6 +92,36 @@ size_t pcu_memory(void)
 #endif
 }
 
+#if defined(__bgq__)
+#include <spi/include/kernel/memory.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/** \brief Returns the heap memory in use by this process, in megabytes.
+  \details This is measured from the allocator itself, so it includes
+  memory that is not allocated through PCU.
+  On systems where this is not supported, zero is returned.
+ */
+double PCU_GetMem(void)
+{
+  const double M = 1024*1024;
+#if defined(__bgq__)
+  uint64_t heap;
+  Kernel_GetMemorySize(KERNEL_MEMSIZE_HEAP, &heap);
+  return heap/M;
+#elif defined(__GLIBC__) && \
+  ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+  struct mallinfo2 info = mallinfo2();
+  return (info.uordblks + info.hblkhd)/M;
+#elif defined(__GLIBC__)
+  struct mallinfo info = mallinfo();
+  return ((size_t)info.uordblks + (size_t)info.hblkhd)/M;
+#else
+  return 0;
+#endif
+}
+
 void pcu_make_buffer(pcu_buffer* b)
 {
   b->start = NULL;
@@ -49,6 +49,9 @@
    If another rank is notified first and quickly goes on to
    a new phase, it may be able to send a message that is
    received by the slow rank out-of-phase.
+
+   When the user provides the communication graph, all of
+   this is replaced by the pcu_nbr transport, see pcu_nbr.h
 */
 
 //enumeration for pcu_msg.state
@@ -61,7 +64,7 @@ enum {
 
 static void make_comm(pcu_msg* m)
 {
-  pcu_make_aa(&(m->peers));
+  pcu_make_peers(&(m->peers));
   pcu_make_message(&(m->received));
   m->state = idle_state;
 }
@@ -69,25 +72,19 @@ static void make_comm(pcu_msg* m)
 void pcu_make_msg(pcu_msg* m)
 {
   make_comm(m);
+  m->keep_peers = false;
+  m->nbr = NULL;
   m->file = NULL;
 }
 
-static void free_peers(pcu_aa_tree* t)
-{
-  if (pcu_aa_empty(*t))
-    return;
-  free_peers(&((*t)->left));
-  free_peers(&((*t)->right));
-  pcu_msg_peer* peer;
-  peer = (pcu_msg_peer*) *t;
-  pcu_free_message(&(peer->message));
-  pcu_free(peer);
-  pcu_make_aa(t);
-}
-
 void pcu_msg_start(pcu_msg* m)
 {
   if (m->state != idle_state) pcu_fail("Start called at the wrong time");
+  if (m->nbr)
+  {
+    m->state = pack_state;
+    return;
+  }
   /* this barrier ensures no one starts a new superstep
      while others are receiving in the past superstep.
      It is the only blocking call in the pcu_msg system. */
@@ -95,86 +92,71 @@ void pcu_msg_start(pcu_msg* m)
   m->state = pack_state;
 }
 
-static bool peer_less(pcu_aa_node* a, pcu_aa_node* b)
-{
-  return ((pcu_msg_peer*)a)->message.peer
-       < ((pcu_msg_peer*)b)->message.peer;
-}
-
-static pcu_msg_peer* find_peer(pcu_aa_tree t, int id)
-{
-  pcu_msg_peer key;
-  key.message.peer = id;
-  return (pcu_msg_peer*) pcu_aa_find(&(key.node),t,peer_less);
-}
-
-static pcu_msg_peer* make_peer(int id)
-{
-  pcu_msg_peer* p;
-  PCU_MALLOC(p,1);
-  pcu_make_message(&(p->message));
-  p->message.peer = id;
-  return p;
-}
-
 void* pcu_msg_pack(pcu_msg* m, int id, size_t size)
 {
   if (m->state != pack_state)
     pcu_fail("Pack or Write called at the wrong time");
-  pcu_msg_peer* peer = find_peer(m->peers,id);
+  pcu_message* peer = pcu_find_peer(&(m->peers),id);
   if (!peer)
   {
-    peer = make_peer(id);
-    pcu_aa_insert(&(peer->node),&(m->peers),peer_less);
+    if (m->nbr)
+      pcu_fail("Pack or Write to a rank that is not a neighbor");
+    peer = pcu_add_peer(&(m->peers),id);
   }
-  return pcu_push_buffer(&(peer->message.buffer),size);
+  return pcu_push_buffer(&(peer->buffer),size);
 }
 
 size_t pcu_msg_packed(pcu_msg* m, int id)
 {
   if (m->state != pack_state) pcu_fail("Packed called at the wrong time");
-  pcu_msg_peer* peer = find_peer(m->peers,id);
+  pcu_message* peer = pcu_find_peer(&(m->peers),id);
   if (!peer) pcu_fail("pcu_msg_packed called but nothing was packed");
-  return peer->message.buffer.size;
+  return peer->buffer.size;
 }
 
-static void send_peers(pcu_aa_tree t)
+/* when peers are kept between phases, a peer that
+   packed nothing in this phase is not sent anything */
+static bool is_sending(pcu_msg* m, pcu_message* peer)
 {
-  if (pcu_aa_empty(t))
-    return;
-  pcu_msg_peer* peer;
-  peer = (pcu_msg_peer*)t;
-  pcu_mpi_send(&(peer->message),pcu_user_comm);
-  send_peers(t->left);
-  send_peers(t->right);
+  return ( ! m->keep_peers) || peer->buffer.size;
 }
 
 void pcu_msg_send(pcu_msg* m)
 {
   if (m->state != pack_state)
     pcu_fail("Send called at the wrong time");
-  send_peers(m->peers);
   m->state = send_recv_state;
+  if (m->nbr)
+  {
+    pcu_nbr_send(m->nbr,&(m->peers),pcu_user_comm);
+    return;
+  }
+  for (int i = 0; i < m->peers.n; ++i)
+    if (is_sending(m,m->peers.msgs + i))
+      pcu_mpi_send(m->peers.msgs + i,pcu_user_comm);
+  m->pending = 0;
 }
 
-static bool done_sending_peers(pcu_aa_tree t)
+static bool done_sending_peers(pcu_msg* m)
 {
-  if (pcu_aa_empty(t))
-    return true;
-  pcu_msg_peer* peer;
-  peer = (pcu_msg_peer*)t;
-  return pcu_mpi_done(&(peer->message))
-    && done_sending_peers(t->left)
-    && done_sending_peers(t->right);
+  for (; m->pending < m->peers.n; ++(m->pending))
+  {
+    pcu_message* peer = m->peers.msgs + m->pending;
+    if (is_sending(m,peer) && ( ! pcu_mpi_done(peer)))
+      return false;
+  }
+  return true;
 }
 
 static bool receive_global(pcu_msg* m)
 {
+  if (m->nbr)
+    return pcu_nbr_receive(m->nbr,&(m->received),pcu_user_comm);
   m->received.peer = MPI_ANY_SOURCE;
   while ( ! pcu_mpi_receive(&(m->received),pcu_user_comm))
   {
     if (m->state == send_recv_state)
-      if (done_sending_peers(m->peers))
+      if (done_sending_peers(m))
       {
         pcu_begin_barrier(&(m->coll));
         m->state = recv_state;
@@ -188,10 +170,73 @@ static bool receive_global(pcu_msg* m)
 
 static void free_comm(pcu_msg* m)
 {
-  free_peers(&(m->peers));
+  pcu_free_peers(&(m->peers));
   pcu_free_message(&(m->received));
 }
 
+/* ends a phase, keeping the peer table if requested */
+static void end_comm(pcu_msg* m)
+{
+  m->state = idle_state;
+  if (m->keep_peers || m->nbr)
+  {
+    pcu_empty_peers(&(m->peers));
+    return;
+  }
+  free_comm(m);
+  make_comm(m);
+}
+
+void pcu_msg_keep_peers(pcu_msg* m, bool keep)
+{
+  if (m->state != idle_state)
+    pcu_fail("Keep_Peers called during a phase");
+  m->keep_peers = keep;
+  if (( ! keep) && ( ! m->nbr))
+  {
+    free_comm(m);
+    make_comm(m);
+  }
+}
+
+static void drop_nbr(pcu_msg* m)
+{
+  if (!m->nbr)
+    return;
+  pcu_free_nbr(m->nbr);
+  pcu_free(m->nbr);
+  m->nbr = NULL;
+}
+
+void pcu_msg_clear_neighbors(pcu_msg* m)
+{
+  if (m->state != idle_state)
+    pcu_fail("Neighbors changed during a phase");
+  drop_nbr(m);
+  free_comm(m);
+  make_comm(m);
+}
+
+/* the peer table is kept for as long as the
+   neighbors are, with peer i being neighbor i */
+void pcu_msg_set_neighbors(pcu_msg* m, int n, int const* ranks)
+{
+  pcu_msg_clear_neighbors(m);
+  PCU_MALLOC(m->nbr,1);
+  pcu_make_nbr(m->nbr,n,ranks);
+  pcu_nbr_add_peers(m->nbr,&(m->peers));
+}
+
+int pcu_msg_get_neighbors(pcu_msg* m, int const** ranks)
+{
+  if (!m->nbr) {
+    *ranks = NULL;
+    return -1;
+  }
+  *ranks = m->nbr->ranks;
+  return m->nbr->n;
+}
+
 bool pcu_msg_receive(pcu_msg* m)
 {
   if ((m->state != send_recv_state)&&
@@ -204,9 +249,7 @@ bool pcu_msg_receive(pcu_msg* m)
     pcu_begin_buffer(&(m->received.buffer));
     return true;
   }
-  m->state = idle_state;
-  free_comm(m);
-  make_comm(m);
+  end_comm(m);
   return false;
 }
 
@@ -232,6 +275,7 @@ size_t pcu_msg_received_size(pcu_msg* m)
 
 void pcu_free_msg(pcu_msg* m)
 {
+  drop_nbr(m);
   free_comm(m);
   if (m->file)
     fclose(m->file);
@@ -11,7 +11,7 @@
 #define PCU_MSG_H
 
 #include "pcu_coll.h"
-#include "pcu_aa.h"
+#include "pcu_nbr.h"
 #include "pcu_io.h"
 
 /* the PCU Messenger (pcu_msg for short) system implements
@@ -19,17 +19,12 @@
    it is based on PCU non-blocking Collectives and pcu_mpi,
    so it also works in hybrid mode */
 
-/* a structure containing all data to be sent to a peer during
-   this communication phase. */
-typedef struct
-{
-  pcu_aa_node node; //binary tree node for lookup
-  pcu_message message; //send buffer and peer id
-} pcu_msg_peer;
-
 struct pcu_msg_struct
 {
-  pcu_aa_tree peers; //binary tree of send buffers
+  pcu_peers peers; //table of send buffers, one per peer
+  int pending; //first peer whose send may not be done
+  bool keep_peers; //keep peers and buffer capacity between phases
+  pcu_nbr* nbr; //neighborhood transport, NULL for termination detection
   pcu_message received; //current received buffer
   pcu_coll coll; //collective operation object
   int state; //state within a communication phase
@@ -43,6 +38,10 @@ void* pcu_msg_pack(pcu_msg* m, int id, size_t size);
 #define PCU_MSG_PACK(m,id,o) \
 memcpy(pcu_msg_pack(m,id,sizeof(o)),&(o),sizeof(o))
 size_t pcu_msg_packed(pcu_msg* m, int id);
+void pcu_msg_keep_peers(pcu_msg* m, bool keep);
+void pcu_msg_set_neighbors(pcu_msg* m, int n, int const* ranks);
+void pcu_msg_clear_neighbors(pcu_msg* m);
+int pcu_msg_get_neighbors(pcu_msg* m, int const** ranks);
 void pcu_msg_send(pcu_msg* m);
 bool pcu_msg_receive(pcu_msg* m);
 void* pcu_msg_unpack(pcu_msg* m, size_t size);
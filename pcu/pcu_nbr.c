@@ -0,0 +1,125 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_nbr.h"
+#include "pcu_common.h"
+#include <string.h>
+
+/* tag 0 belongs to pcu_msg, using other tags
+   keeps the two systems from matching each other's messages */
+enum {
+  size_tag = 1,
+  data_tag = 2
+};
+
+void pcu_make_nbr(pcu_nbr* nb, int n, int const* ranks)
+{
+  nb->n = n;
+  PCU_MALLOC(nb->ranks,(size_t)n);
+  memcpy(nb->ranks,ranks,sizeof(int)*n);
+  PCU_MALLOC(nb->sizes,(size_t)(2*n));
+  PCU_MALLOC(nb->requests,(size_t)(3*n));
+  PCU_MALLOC(nb->receives,(size_t)n);
+  PCU_MALLOC(nb->incoming,(size_t)n);
+  for (int i = 0; i < n; ++i)
+  {
+    pcu_make_message(nb->incoming + i);
+    nb->incoming[i].peer = ranks[i];
+  }
+  for (int i = 0; i < 3*n; ++i)
+    nb->requests[i] = MPI_REQUEST_NULL;
+  for (int i = 0; i < n; ++i)
+    nb->receives[i] = MPI_REQUEST_NULL;
+  nb->posted = false;
+}
+
+void pcu_free_nbr(pcu_nbr* nb)
+{
+  for (int i = 0; i < nb->n; ++i)
+    pcu_free_message(nb->incoming + i);
+  pcu_free(nb->incoming);
+  pcu_free(nb->receives);
+  pcu_free(nb->requests);
+  pcu_free(nb->sizes);
+  pcu_free(nb->ranks);
+}
+
+/* puts the neighbors into the peer table in neighbor order,
+   so that peer i is neighbor i */
+void pcu_nbr_add_peers(pcu_nbr* nb, pcu_peers* peers)
+{
+  if (peers->n)
+    pcu_fail("peers were not empty when adding neighbors");
+  for (int i = 0; i < nb->n; ++i)
+  {
+    if (pcu_find_peer(peers,nb->ranks[i]))
+      pcu_fail("neighbor list has duplicates");
+    pcu_add_peer(peers,nb->ranks[i]);
+  }
+}
+
+void pcu_nbr_send(pcu_nbr* nb, pcu_peers* peers, MPI_Comm comm)
+{
+  int n = nb->n;
+  for (int i = 0; i < n; ++i)
+  {
+    MPI_Irecv(nb->sizes + n + i,(int)sizeof(size_t),MPI_BYTE,
+        nb->ranks[i],size_tag,comm,nb->requests + n + i);
+    nb->sizes[i] = peers->msgs[i].buffer.size;
+    MPI_Isend(nb->sizes + i,(int)sizeof(size_t),MPI_BYTE,
+        nb->ranks[i],size_tag,comm,nb->requests + i);
+  }
+  for (int i = 0; i < n; ++i)
+    if (nb->sizes[i])
+      MPI_Isend(peers->msgs[i].buffer.start,(int)nb->sizes[i],MPI_BYTE,
+          nb->ranks[i],data_tag,comm,nb->requests + 2*n + i);
+  nb->posted = false;
+}
+
+static void post_receives(pcu_nbr* nb, MPI_Comm comm)
+{
+  int n = nb->n;
+  MPI_Waitall(n,nb->requests + n,MPI_STATUSES_IGNORE);
+  for (int i = 0; i < n; ++i)
+  {
+    size_t size = nb->sizes[n + i];
+    if (!size)
+      continue;
+    pcu_resize_buffer(&(nb->incoming[i].buffer),size);
+    MPI_Irecv(nb->incoming[i].buffer.start,(int)size,MPI_BYTE,
+        nb->ranks[i],data_tag,comm,nb->receives + i);
+  }
+  nb->posted = true;
+}
+
+static void swap_buffers(pcu_buffer* a, pcu_buffer* b)
+{
+  pcu_buffer tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+/* delivers incoming messages in the order they complete,
+   returns false once all of them have been delivered */
+bool pcu_nbr_receive(pcu_nbr* nb, pcu_message* received, MPI_Comm comm)
+{
+  if (!nb->posted)
+    post_receives(nb,comm);
+  int i = MPI_UNDEFINED;
+  if (nb->n)
+    MPI_Waitany(nb->n,nb->receives,&i,MPI_STATUS_IGNORE);
+  if (i == MPI_UNDEFINED)
+  {
+    MPI_Waitall(3*nb->n,nb->requests,MPI_STATUSES_IGNORE);
+    return false;
+  }
+  swap_buffers(&(received->buffer),&(nb->incoming[i].buffer));
+  received->peer = nb->ranks[i];
+  return true;
+}
@@ -0,0 +1,48 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_NBR_H
+#define PCU_NBR_H
+
+#include "pcu_peers.h"
+
+/* the PCU neighborhood transport (pcu_nbr for short) is an
+   alternative to the termination detection of pcu_msg for
+   codes that know their communication graph ahead of time.
+
+   Given a symmetric list of neighbor ranks, each phase first
+   exchanges message sizes with all neighbors (a sparse all-to-all,
+   zero meaning no message), then posts receives of exactly those
+   sizes from exactly those neighbors.
+   Since each rank knows how many messages it will receive,
+   there is no need for the non-blocking barrier or for probing
+   with MPI_ANY_SOURCE, and no barrier is needed between phases
+   either because MPI preserves message order between two ranks.
+
+   This only works for the MPI process ranks (pcu_pmpi),
+   not for PCU threads. */
+
+typedef struct
+{
+  int n; //number of neighbors
+  int* ranks; //neighbor ranks
+  size_t* sizes; //[0,n) outgoing and [n,2n) incoming sizes
+  MPI_Request* requests; //size sends, size receives, data sends
+  MPI_Request* receives; //data receives
+  pcu_message* incoming; //data receive buffers
+  bool posted; //whether data receives have been posted
+} pcu_nbr;
+
+void pcu_make_nbr(pcu_nbr* nb, int n, int const* ranks);
+void pcu_free_nbr(pcu_nbr* nb);
+void pcu_nbr_add_peers(pcu_nbr* nb, pcu_peers* peers);
+void pcu_nbr_send(pcu_nbr* nb, pcu_peers* peers, MPI_Comm comm);
+bool pcu_nbr_receive(pcu_nbr* nb, pcu_message* received, MPI_Comm comm);
+
+#endif
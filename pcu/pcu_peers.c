@@ -0,0 +1,105 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#include "pcu_peers.h"
+#include "pcu_common.h"
+
+void pcu_make_peers(pcu_peers* p)
+{
+  p->msgs = NULL;
+  p->n = 0;
+  p->capacity = 0;
+  p->slots = NULL;
+  p->slot_count = 0;
+  p->last = -1;
+}
+
+void pcu_free_peers(pcu_peers* p)
+{
+  for (int i = 0; i < p->n; ++i)
+    pcu_free_message(p->msgs + i);
+  pcu_free(p->msgs);
+  pcu_free(p->slots);
+  pcu_make_peers(p);
+}
+
+/* Knuth's multiplicative hash, spreads consecutive ranks */
+static int first_slot(pcu_peers* p, int rank)
+{
+  unsigned h = ((unsigned)rank) * 2654435761u;
+  return (int)(h & (unsigned)(p->slot_count - 1));
+}
+
+static int next_slot(pcu_peers* p, int slot)
+{
+  return (slot + 1) & (p->slot_count - 1);
+}
+
+static void insert_slot(pcu_peers* p, int i)
+{
+  int s = first_slot(p, p->msgs[i].peer);
+  while (p->slots[s] != -1)
+    s = next_slot(p, s);
+  p->slots[s] = i;
+}
+
+/* keeps the table at most half full */
+static void rehash(pcu_peers* p)
+{
+  int count = MAX(16, p->slot_count * 2);
+  pcu_free(p->slots);
+  PCU_MALLOC(p->slots, (size_t)count);
+  p->slot_count = count;
+  for (int s = 0; s < count; ++s)
+    p->slots[s] = -1;
+  for (int i = 0; i < p->n; ++i)
+    insert_slot(p, i);
+}
+
+pcu_message* pcu_find_peer(pcu_peers* p, int rank)
+{
+  if ((p->last != -1) && (p->msgs[p->last].peer == rank))
+    return p->msgs + p->last;
+  if (!p->slot_count)
+    return NULL;
+  for (int s = first_slot(p, rank); p->slots[s] != -1; s = next_slot(p, s))
+    if (p->msgs[p->slots[s]].peer == rank)
+    {
+      p->last = p->slots[s];
+      return p->msgs + p->last;
+    }
+  return NULL;
+}
+
+pcu_message* pcu_add_peer(pcu_peers* p, int rank)
+{
+  if (p->n == p->capacity)
+  {
+    p->capacity = ((p->capacity + 16) * 3) / 2;
+    p->msgs = pcu_realloc(p->msgs, sizeof(pcu_message) * p->capacity);
+  }
+  pcu_message* m = p->msgs + p->n;
+  pcu_make_message(m);
+  m->peer = rank;
+  ++(p->n);
+  if (2 * p->n > p->slot_count)
+    rehash(p);
+  else
+    insert_slot(p, p->n - 1);
+  p->last = p->n - 1;
+  return m;
+}
+
+/* keeps the set of peers and the capacity of their buffers,
+   but marks all buffers as empty */
+void pcu_empty_peers(pcu_peers* p)
+{
+  for (int i = 0; i < p->n; ++i)
+    p->msgs[i].buffer.size = 0;
+}
@@ -0,0 +1,37 @@
+/****************************************************************************** 
+
+  Copyright 2026 Scientific Computation Research Center, 
+      Rensselaer Polytechnic Institute. All rights reserved.
+  
+  This work is open source software, licensed under the terms of the
+  BSD license as described in the LICENSE file in the top-level directory.
+
+*******************************************************************************/
+#ifndef PCU_PEERS_H
+#define PCU_PEERS_H
+
+#include "pcu_mpi.h"
+
+/* the pcu_peers table holds one message per destination rank.
+   messages are stored in a compact array in order of insertion,
+   and an open-addressing hash table maps ranks to array indices,
+   so lookup is O(1) regardless of the number of ranks and
+   iteration only visits active peers. */
+
+typedef struct
+{
+  pcu_message* msgs; //compact array of messages
+  int n; //number of messages in use
+  int capacity; //allocated size of msgs
+  int* slots; //hash table of indices into msgs, -1 if empty
+  int slot_count; //size of slots, a power of two
+  int last; //index of the most recent lookup, -1 if none
+} pcu_peers;
+
+void pcu_make_peers(pcu_peers* p);
+void pcu_free_peers(pcu_peers* p);
+pcu_message* pcu_find_peer(pcu_peers* p, int rank);
+pcu_message* pcu_add_peer(pcu_peers* p, int rank);
+void pcu_empty_peers(pcu_peers* p);
+
+#endif
@@ -98,6 +98,81 @@ void pcu_thread_unlock(void)
   pthread_mutex_unlock(&global_lock);
 }
 
+typedef struct
+{
+  void (*function)(int, void*);
+  void* data;
+  int rank;
+} worker_t;
+
+static pthread_once_t worker_once = PTHREAD_ONCE_INIT;
+static pthread_key_t worker_key;
+
+static void make_worker_key(void)
+{
+  int err = pthread_key_create(&worker_key,NULL);
+  if (err) pcu_fail("pthread_key_create failed");
+}
+
+static void* run_worker(void* in)
+{
+  worker_t* w = in;
+  pthread_setspecific(worker_key,(void*)(ptrdiff_t)(w->rank));
+  w->function(w->rank, w->data);
+  pthread_setspecific(worker_key,0);
+  return NULL;
+}
+
+int pcu_worker_rank(void)
+{
+  pthread_once(&worker_once,make_worker_key);
+  return (int)(ptrdiff_t)(pthread_getspecific(worker_key));
+}
+
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void pcu_worker_lock(void)
+{
+  pthread_mutex_lock(&worker_lock);
+}
+
+void pcu_worker_unlock(void)
+{
+  pthread_mutex_unlock(&worker_lock);
+}
+
+/* unlike pcu_run_threads, this does not set up any PCU
+   thread state, it just forks and joins plain workers */
+void pcu_run_workers(int count, void (*function)(int, void*), void* data)
+{
+  if (count < 1) pcu_fail("thread count must be positive");
+  pthread_once(&worker_once,make_worker_key);
+  pthread_t* threads;
+  worker_t* workers;
+  PCU_MALLOC(threads,(size_t)count);
+  PCU_MALLOC(workers,(size_t)count);
+  int err;
+  for (int i=0; i < count; ++i)
+  {
+    workers[i].function = function;
+    workers[i].data = data;
+    workers[i].rank = i;
+  }
+  for (int i=1; i < count; ++i)
+  {
+    err = pthread_create(threads+i,NULL,run_worker,workers+i);
+    if (err) pcu_fail("pthread_create failed");
+  }
+  run_worker(workers);
+  for (int i=1; i < count; ++i)
+  {
+    err = pthread_join(threads[i],NULL);
+    if (err) pcu_fail("pthread_join failed");
+  }
+  pcu_free(workers);
+  pcu_free(threads);
+}
+
 static void barrier_init(barrier_t *barrier, unsigned int count)
 {
   int err;
@@ -23,4 +23,9 @@ void pcu_thread_barrier(void);
 void pcu_thread_lock(void);
 void pcu_thread_unlock(void);
 
+void pcu_run_workers(int count, void (*function)(int, void*), void* data);
+int pcu_worker_rank(void);
+void pcu_worker_lock(void);
+void pcu_worker_unlock(void);
+
 #endif
@@ -29,6 +29,7 @@ static void afterSplit(apf::Mesh2* m)
       ph::balance(m);
     apf::reorderMdsMesh(m);
   }
+  apf::freezeMdsUpward(m);
   assert(in.phastaIO);
   ph::Output o;
   ph::generateOutput(in, bcs, m, o);
@@ -64,6 +65,7 @@ int main(int argc, char** argv)
   if (in.buildMapping)
     ph::buildMapping(m);
   apf::setMigrationLimit(in.elementsPerMigration);
+  apf::setMigrationMemory(in.memoryPerMigration);
   if (in.adaptFlag) {
     ph::adapt(in, m);
     ph::goToStepDir(in.timeStepNumber);
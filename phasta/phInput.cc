@@ -19,6 +19,7 @@ static void setDefaults(Input& in)
   in.dwalMigration = 0; // Do not migrate dwal field by default
   in.buildMapping = 0; // Do not build the mapping field by default
   in.elementsPerMigration = 1000*1000; // 100k elms per round
+  in.memoryPerMigration = 0; // MB per round, 0 for fixed-size rounds
   in.threaded = 1;
   in.initBubbles = 0;
   in.restartFileName = "restart";
@@ -67,6 +68,7 @@ static void formMaps(Input& in, StringMap& stringMap, IntMap& intMap)
   intMap["dwalMigration"] = &in.dwalMigration;
   intMap["buildMapping"] = &in.buildMapping;
   intMap["elementsPerMigration"] = &in.elementsPerMigration;
+  intMap["memoryPerMigration"] = &in.memoryPerMigration;
   intMap["threaded"] = &in.threaded;
   intMap["initBubbles"] = &in.initBubbles;
 }
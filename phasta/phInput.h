@@ -45,6 +45,7 @@ class Input
     int dwalMigration;
     int buildMapping;
     int elementsPerMigration;
+    int memoryPerMigration;
     int threaded;
     int initBubbles;
 };
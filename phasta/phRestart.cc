@@ -4,6 +4,7 @@
 #include "phIO.h"
 #include "ph.h"
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 
@@ -56,8 +57,22 @@ void detachField(
   apf::Mesh* m = apf::getMesh(f);
   size = apf::countComponents(f);
   size_t n = m->count(0);
-  apf::NewArray<double> c(size);
   data = (double*)malloc(sizeof(double) * size * m->count(0));
+  /* frozen fields keep the vertex values in one block,
+     node-major, so they only need a transpose */
+  long frozenSize;
+  double* frozen = apf::getArrayData(f, 0, frozenSize);
+  if (frozen && static_cast<size_t>(frozenSize) == n * size) {
+    if (size == 1)
+      memcpy(data, frozen, sizeof(double) * n);
+    else
+      for (size_t i = 0; i < n; ++i)
+        for (int j = 0; j < size; ++j)
+          data[j * n + i] = frozen[i * size + j];
+    apf::destroyField(f);
+    return;
+  }
+  apf::NewArray<double> c(size);
   apf::MeshEntity* e;
   size_t i = 0;
   apf::MeshIterator* it = m->begin(0);
@@ -14,6 +14,7 @@
 #include <PCU.h>
 
 #include <limits>
+#include <vector>
 
 namespace spr {
 
@@ -94,34 +95,72 @@ static void setupEstimation(Estimation* e, apf::Field* eps, double tolerance)
   e->size = 0;
 }
 
-/* computes $\|f\|^2$ */
-class SelfProduct : public SInt
+/* common base for scalar block integrators,
+   which keep one partial sum per thread */
+class SBlockInt : public apf::BlockIntegrator
 {
   public:
-    SelfProduct(Estimation* e):
-      SInt(e->integration_order), estimation(e)
+    SBlockInt(int order):
+      apf::BlockIntegrator(order),
+      r(0)
+    {}
+    void inProcess()
     {
-      v.setSize(apf::countComponents(e->eps_star));
+      sums.assign(countThreads(), 0.0);
     }
-    void inElement(apf::MeshElement* meshElement)
+    void parallelReduce()
     {
-      element = apf::createElement(estimation->eps_star, meshElement);
+      r = 0;
+      for (size_t i = 0; i < sums.size(); ++i)
+        r += sums[i];
+      PCU_Add_Doubles(&r,1);
     }
-    void outElement()
+    std::vector<double> sums;
+    double r;
+};
+
+/* computes $\|f\|^2$ */
+class SelfProduct : public SBlockInt
+{
+  public:
+    SelfProduct(Estimation* e):
+      SBlockInt(e->integration_order), estimation(e)
     {
-      apf::destroyElement(element);
     }
-    void atPoint(apf::Vector3 const& p, double w, double dV)
+    void atBlock(apf::IntegrationBlock const& b, int thread)
     {
-      apf::getComponents(element, p, &v[0]);
-      r += (v * v) * w * dV;
+      apf::DynamicVector v(apf::countComponents(estimation->eps_star));
+      double sum = 0;
+      for (int i = 0; i < b.count; ++i)
+      {
+        apf::Element* element =
+          apf::createElement(estimation->eps_star, b.elements[i]);
+        for (int p = 0; p < b.points; ++p)
+        {
+          apf::getComponents(element, b.params[p], &v[0]);
+          sum += (v * v) * b.weights[p] * b.dV[p * b.count + i];
+        }
+        apf::destroyElement(element);
+      }
+      sums[thread] += sum;
     }
   private:
     Estimation* estimation;
-    apf::Element* element;
-    apf::DynamicVector v;
 };
 
+/* the squared difference between the original and recovered
+   fields at integration point ip of an element, where element
+   is the recovered field on entity */
+static double getPointError(Estimation* e, apf::MeshEntity* entity,
+    apf::Element* element, int ip, apf::Vector3 const& xi,
+    apf::DynamicVector& v1, apf::DynamicVector& v2)
+{
+  apf::getComponents(e->eps, entity, ip, &v1[0]);
+  apf::getComponents(element, xi, &v2[0]);
+  v1 -= v2;
+  return v1 * v1;
+}
+
 /* computes the integral over the element of the
    sum of the squared differences between the
    original and recovered fields */
@@ -148,11 +187,8 @@ class ElementError : public SInt
     }
     void atPoint(apf::Vector3 const& xi, double w, double dV)
     {
-      apf::getComponents(estimation->eps, entity, ip, &v1[0]);
-      apf::getComponents(element, xi, &v2[0]);
-      apf::DynamicVector& diff = v1;
-      diff -= v2;
-      sum += (diff * diff) * w * dV;
+      sum += getPointError(estimation, entity, element, ip, xi, v1, v2)
+           * w * dV;
       ++ip;
     }
     Estimation* estimation;
@@ -164,20 +200,38 @@ class ElementError : public SInt
 };
 
 /* computes the $\sum_{i=1}^n \|e_\epsilon\|^{\frac{2d}{2p+d}}$ term. */
-class Error : public ElementError
+class Error : public SBlockInt
 {
   public:
     Error(Estimation* e):
-      ElementError(e)
+      SBlockInt(e->integration_order), estimation(e)
     {
+      double d = e->mesh->getDimension();
+      double p = e->recovered_order;
+      exponent = (2 * d) / (2 * p + d);
     }
-    void outElement()
+    void atBlock(apf::IntegrationBlock const& b, int thread)
     {
-      ElementError::outElement();
-      double d = estimation->mesh->getDimension();
-      double p = estimation->recovered_order;
-      r += pow(sqrt(sum), ((2 * d) / (2 * p + d)));
+      apf::DynamicVector v1(apf::countComponents(estimation->eps));
+      apf::DynamicVector v2(apf::countComponents(estimation->eps_star));
+      double total = 0;
+      for (int i = 0; i < b.count; ++i)
+      {
+        apf::MeshEntity* entity = b.elements[i];
+        apf::Element* element =
+          apf::createElement(estimation->eps_star, entity);
+        double sum = 0;
+        for (int p = 0; p < b.points; ++p)
+          sum += getPointError(estimation, entity, element, p,
+              b.params[p], v1, v2) * b.weights[p] * b.dV[p * b.count + i];
+        apf::destroyElement(element);
+        total += pow(sqrt(sum), exponent);
+      }
+      sums[thread] += total;
     }
+  private:
+    Estimation* estimation;
+    double exponent;
 };
 
 /* computes the $\|e_\epsilon\|^{-\frac{2}{2p+d}}_e$ term
@@ -292,6 +346,10 @@ class AverageOp : public apf::CavityOp
       averageToEntity(estimation->element_size,
           estimation->size, entity);
     }
+    virtual apf::CavityOp* clone()
+    {
+      return new AverageOp(estimation);
+    }
     Estimation* estimation;
     apf::MeshEntity* entity;
 };
@@ -39,6 +39,9 @@ struct Recovery {
      way this is programmed it should handle any nonzero number of points
      per element regardless of output order (by growing bigger patches) */
   int points_per_element;
+  /* the integration order that places the input field's points.
+     this is not the order above, which is that of the output */
+  int integration_order;
   /* input field containing integration point data for all elements */
   apf::Field* f;
   /* output field containing recovered nodal data */
@@ -81,6 +84,7 @@ static void setupRecovery(Recovery* r, apf::Field* f)
   r->order = r->mesh->getShape()->getOrder();
   r->polynomial_terms = countPolynomialTerms(r->dim, r->order);
   r->points_per_element = determinePointsPerElement(f);
+  r->integration_order = apf::getShape(f)->getOrder();
   r->f = f;
   r->f_star = makeRecoveredField(r);
 }
@@ -200,7 +204,7 @@ static void getSamplePoints(Patch* p)
     apf::MeshElement* me = apf::createMeshElement(r->mesh, *it);
     for (int l = 0; l < r->points_per_element; ++l) {
       apf::Vector3 param;
-      apf::getIntPoint(me, r->order, l, param);
+      apf::getIntPoint(me, r->integration_order, l, param);
       apf::mapLocalToGlobal(me, param, s->points[i]);
       ++i;
     }
@@ -409,6 +413,10 @@ public:
   {
     runSpr(&patch);
   }
+  virtual apf::CavityOp* clone()
+  {
+    return new PatchOp(patch.recovery);
+  }
   Patch patch;
 };
 
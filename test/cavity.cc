@@ -0,0 +1,234 @@
+#include <apf.h>
+#include <apfCavityOp.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <spr.h>
+#include <PCU.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+typedef std::vector<apf::MeshEntity*> Entities;
+typedef std::vector<Entities> Colors;
+
+/* a cube of n^3 hexes cut into tets */
+static apf::Mesh2* makeBox(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      apf::buildElement(m, interior, apf::Mesh::TET, tv);
+    }
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+/* a disk of n triangles around one vertex, so every vertex
+   cavity holds the center and each needs a color of its own */
+static apf::Mesh2* makeFan(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 2, false);
+  apf::ModelEntity* interior = m->findModelEntity(2, 0);
+  apf::Vector3 param(0,0,0);
+  apf::MeshEntity* center = m->createVertex(interior,
+      apf::Vector3(0,0,0), param);
+  std::vector<apf::MeshEntity*> rim(n);
+  for (int i = 0; i < n; ++i) {
+    double a = 2 * M_PI * i / n;
+    rim[i] = m->createVertex(interior,
+        apf::Vector3(std::cos(a), std::sin(a), 0), param);
+  }
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* tv[3] = {center, rim[i], rim[(i + 1) % n]};
+    apf::buildElement(m, interior, apf::Mesh::TRIANGLE, tv);
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+static void getEntities(apf::Mesh* m, int d, Entities& entities)
+{
+  entities.clear();
+  apf::MeshIterator* it = m->begin(d);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it)))
+    entities.push_back(e);
+  m->end(it);
+}
+
+static void getVerts(apf::Mesh* m, apf::MeshEntity* e, bool cavity,
+    std::set<apf::MeshEntity*>& verts)
+{
+  verts.clear();
+  apf::Adjacent around;
+  if (cavity)
+    m->getAdjacent(e, m->getDimension(), around);
+  else
+    around.append(e);
+  for (size_t i = 0; i < around.getSize(); ++i) {
+    apf::Downward down;
+    int nd = m->getDownward(around[i], 0, down);
+    verts.insert(down, down + nd);
+  }
+}
+
+/* every entity gets exactly one color, in its original order,
+   and no two entities of one color touch the same vertex */
+static void checkColors(apf::Mesh* m, Entities const& entities,
+    Colors const& colors, bool cavity)
+{
+  std::set<apf::MeshEntity*> colored;
+  size_t total = 0;
+  for (size_t c = 0; c < colors.size(); ++c) {
+    Entities const& color = colors[c];
+    check(!color.empty(), "empty color");
+    std::set<apf::MeshEntity*> used;
+    std::set<apf::MeshEntity*> verts;
+    for (size_t i = 0; i < color.size(); ++i) {
+      getVerts(m, color[i], cavity, verts);
+      for (std::set<apf::MeshEntity*>::iterator v = verts.begin();
+           v != verts.end(); ++v)
+        check(used.insert(*v).second, "one color shares a vertex");
+      colored.insert(color[i]);
+    }
+    total += color.size();
+  }
+  check(total == entities.size(), "wrong colored entity count");
+  check(colored == std::set<apf::MeshEntity*>(entities.begin(),
+        entities.end()), "colored entities differ");
+}
+
+static void testFan()
+{
+  /* past two rounds of 64 colors */
+  int const n = 150;
+  apf::Mesh2* m = makeFan(n);
+  m->verify();
+  Entities entities;
+  Colors colors;
+  getEntities(m, 0, entities);
+  apf::colorCavities(m, entities, colors);
+  checkColors(m, entities, colors, true);
+  check(colors.size() == size_t(n + 1), "wrong vertex cavity colors");
+  getEntities(m, 2, entities);
+  colors.clear();
+  apf::colorByVertices(m, entities, colors);
+  checkColors(m, entities, colors, false);
+  check(colors.size() == size_t(n), "wrong triangle colors");
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+static void testBox(apf::Mesh2* m)
+{
+  Entities entities;
+  Colors colors;
+  for (int d = 0; d <= 3; ++d) {
+    getEntities(m, d, entities);
+    colors.clear();
+    apf::colorCavities(m, entities, colors);
+    checkColors(m, entities, colors, true);
+    colors.clear();
+    apf::colorByVertices(m, entities, colors);
+    checkColors(m, entities, colors, false);
+  }
+}
+
+static double getValue(apf::Vector3 const& x)
+{
+  return x[0] * x[0] + x[1] * x[2] + std::sin(x[2]);
+}
+
+/* threaded recovery computes each vertex the same way,
+   so the results should be identical */
+static void testRecovery(apf::Mesh2* m)
+{
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::SCALAR, 1);
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    apf::setScalar(f, v, 0, getValue(x));
+  }
+  m->end(it);
+  apf::Field* grad = spr::getGradIPField(f, "grad", 2);
+  apf::setCavityThreads(1);
+  apf::Field* recovered = spr::recoverField(grad);
+  apf::Field* serial = apf::createLagrangeField(m, "serial",
+      apf::VECTOR, 1);
+  apf::copyData(serial, recovered);
+  apf::destroyField(recovered);
+  apf::setCavityThreads(4);
+  recovered = spr::recoverField(grad);
+  apf::setCavityThreads(1);
+  it = m->begin(0);
+  while ((v = m->iterate(it))) {
+    apf::Vector3 a;
+    apf::Vector3 b;
+    apf::getVector(serial, v, 0, a);
+    apf::getVector(recovered, v, 0, b);
+    check(a == b, "threaded recovery differs");
+  }
+  m->end(it);
+  apf::destroyField(recovered);
+  apf::destroyField(serial);
+  apf::destroyField(grad);
+  apf::destroyField(f);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  testFan();
+  apf::Mesh2* m = makeBox(4);
+  testBox(m);
+  testRecovery(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
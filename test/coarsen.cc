@@ -0,0 +1,196 @@
+#include <ma.h>
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "rank %d: %s\n", PCU_Comm_Self(), what);
+  abort();
+}
+
+/* the box faces, edges or corner that all the given points
+   lie on. the model tag encodes which sides those are, so each
+   model entity has its own tag */
+static apf::ModelEntity* classify(apf::Mesh2* m, apf::Vector3 const* x,
+    int n)
+{
+  int dim = 3;
+  int tag = 0;
+  for (int c = 0; c < 3; ++c) {
+    int on = -1;
+    for (int side = 0; side < 2; ++side) {
+      bool all = true;
+      for (int i = 0; i < n; ++i)
+        if (x[i][c] != side)
+          all = false;
+      if (all)
+        on = side;
+    }
+    tag = tag * 3 + on + 1;
+    if (on != -1)
+      --dim;
+  }
+  return m->findModelEntity(dim, tag);
+}
+
+static apf::ModelEntity* classify(apf::Mesh2* m, apf::MeshEntity** v,
+    int n)
+{
+  apf::Vector3 x[3];
+  for (int i = 0; i < n; ++i)
+    m->getPoint(v[i], 0, x[i]);
+  return classify(m, x, n);
+}
+
+/* builds a tet with its edges and triangles on the box */
+static void buildTet(apf::Mesh2* m, apf::MeshEntity** tv)
+{
+  for (int i = 0; i < 6; ++i) {
+    apf::MeshEntity* ev[2];
+    for (int j = 0; j < 2; ++j)
+      ev[j] = tv[apf::tet_edge_verts[i][j]];
+    apf::makeOrFind(m, classify(m, ev, 2), apf::Mesh::EDGE, ev);
+  }
+  for (int i = 0; i < 4; ++i) {
+    apf::MeshEntity* fv[3];
+    for (int j = 0; j < 3; ++j)
+      fv[j] = tv[apf::tet_tri_verts[i][j]];
+    apf::buildElement(m, classify(m, fv, 3), apf::Mesh::TRIANGLE, fv);
+  }
+  apf::buildElement(m, m->findModelEntity(3, 0), apf::Mesh::TET, tv);
+}
+
+/* a cube of n^3 hexes cut into tets, classified on the box */
+static void buildBox(apf::Mesh2* m, int n)
+{
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(classify(m, &x, 1), x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      buildTet(m, tv);
+    }
+  }
+}
+
+/* build the box on part zero and cut it into slabs along x,
+   so that most model faces and edges cross part boundaries */
+static apf::Mesh2* makeMesh(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  if (!PCU_Comm_Self())
+    buildBox(m, n);
+  m->acceptChanges();
+  apf::Migration* plan = new apf::Migration(m);
+  if (!PCU_Comm_Self()) {
+    apf::MeshIterator* it = m->begin(3);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      apf::Vector3 c = apf::getLinearCentroid(m, e);
+      plan->send(e, int(c[0] * PCU_Comm_Peers()));
+    }
+    m->end(it);
+  }
+  m->migrate(plan);
+  return m;
+}
+
+class Coarse : public ma::IsotropicFunction
+{
+  public:
+    Coarse(double h):size(h) {}
+    virtual double getValue(ma::Entity*)
+    {
+      return size;
+    }
+  private:
+    double size;
+};
+
+/* counts the vertices on each model dimension after coarsening
+   with the CavityOp sweeps alone, before the queue. runs on more
+   parts depend on the order of migration messages. */
+static long const expected[2][4] = {
+  {8, 36, 150, 171},
+  {8, 33, 136, 168}};
+
+static void checkResult(apf::Mesh2* m)
+{
+  long counts[4] = {0,0,0,0};
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it)))
+    if (m->isOwned(v))
+      ++counts[m->getModelType(m->toModel(v))];
+  m->end(it);
+  PCU_Add_Longs(counts, 4);
+  int peers = PCU_Comm_Peers();
+  if (peers <= 2)
+    for (int d = 0; d < 4; ++d)
+      check(counts[d] == expected[peers - 1][d],
+          "coarsening result changed");
+  double volume = 0;
+  it = m->begin(3);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    volume += apf::measure(me);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  PCU_Add_Doubles(&volume, 1);
+  check(std::fabs(volume - 1) < 1e-10, "coarsening changed the volume");
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  int const n = 8;
+  apf::Mesh2* m = makeMesh(n);
+  Coarse f(2.5 / n);
+  ma::Input* in = ma::configure(m, &f);
+  in->shouldSnap = false;
+  in->shouldTransferParametric = false;
+  in->shouldFixShape = false;
+  in->maximumIterations = 1;
+  ma::adapt(in);
+  m->verify();
+  checkResult(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,127 @@
+#include <apfFlatSet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+typedef apf::FlatSet<int> Set;
+typedef apf::FlatMap<int, double> Map;
+
+static void checkSame(Set const& s, std::set<int> const& r)
+{
+  check(s.size() == r.size(), "wrong set size");
+  check(s.empty() == r.empty(), "wrong set emptiness");
+  std::set<int>::const_iterator it = r.begin();
+  for (Set::iterator i = s.begin(); i != s.end(); ++i, ++it)
+    check(*i == *it, "set out of order");
+}
+
+static void checkSame(Map const& m, std::map<int, double> const& r)
+{
+  check(m.size() == r.size(), "wrong map size");
+  std::map<int, double>::const_iterator it = r.begin();
+  for (Map::const_iterator i = m.begin(); i != m.end(); ++i, ++it) {
+    check(i->first == it->first, "map out of order");
+    check(i->second == it->second, "wrong map value");
+  }
+}
+
+static void testSetBasics()
+{
+  Set s;
+  check(s.empty(), "new set is not empty");
+  check(s.insert(5).second, "first insert failed");
+  check(s.insert(1).second, "front insert failed");
+  check(s.insert(9).second, "back insert failed");
+  check(s.insert(3).second, "middle insert failed");
+  check(!s.insert(5).second, "duplicate was inserted");
+  check(*s.insert(5).first == 5, "duplicate insert points elsewhere");
+  check(s.size() == 4, "duplicate changed the size");
+  int expected[4] = {1, 3, 5, 9};
+  for (int i = 0; i < 4; ++i)
+    check(s.begin()[i] == expected[i], "set is not sorted");
+  check(s.find(3) != s.end() && *s.find(3) == 3, "find missed a value");
+  check(s.find(4) == s.end(), "find found a missing value");
+  check(s.count(9) == 1 && s.count(0) == 0, "wrong count");
+  check(s.erase(3) == 1, "erase missed a value");
+  check(s.erase(3) == 0, "erase removed a missing value");
+  s.erase(s.begin());
+  check(s.size() == 2 && *s.begin() == 5, "erase by iterator failed");
+  s.clear();
+  check(s.empty(), "clear left values");
+}
+
+/* more values than the inline storage, in a scrambled order,
+   checked against std::set along the way */
+static void testSetSpill()
+{
+  Set s;
+  std::set<int> r;
+  for (int i = 0; i < 40; ++i) {
+    int v = (i * 17) % 23;
+    check(s.insert(v).second == r.insert(v).second, "insert differs");
+    checkSame(s, r);
+  }
+  Set copy(s);
+  checkSame(copy, r);
+  check(copy == s, "spilled copy differs");
+  check(copy.begin() != s.begin(), "spilled copy shares storage");
+  copy.erase(7);
+  check(copy != s, "copy is not independent");
+  checkSame(s, r);
+  Set assigned;
+  assigned.insert(100);
+  assigned = s;
+  checkSame(assigned, r);
+  for (int v = 0; v < 23; v += 2) {
+    check(s.erase(v) == r.erase(v), "erase differs");
+    checkSame(s, r);
+  }
+  /* shrinking back under the inline size keeps working */
+  Set small(s.begin(), s.begin() + 3);
+  check(small.size() == 3, "range constructor failed");
+  Set smallCopy;
+  smallCopy = small;
+  check(smallCopy == small, "small copy differs");
+  check(small < s || s < small || small == s, "sets are not ordered");
+}
+
+static void testMap()
+{
+  Map m;
+  std::map<int, double> r;
+  for (int i = 0; i < 30; ++i) {
+    int k = (i * 7) % 19;
+    m[k] += i;
+    r[k] += i;
+    checkSame(m, r);
+  }
+  check(m.find(20) == m.end(), "map found a missing key");
+  check(m.find(7) != m.end() && m.find(7)->second == r[7], "map find failed");
+  check(!m.insert(std::make_pair(7, -1.0)).second, "map took a duplicate");
+  check(m[7] == r[7], "duplicate insert changed a value");
+  Map copy(m);
+  checkSame(copy, r);
+  copy[100] = 1;
+  check(copy != m, "map copy is not independent");
+  for (int k = 0; k < 19; k += 3) {
+    check(m.erase(k) == r.erase(k), "map erase differs");
+    checkSame(m, r);
+  }
+}
+
+int main()
+{
+  testSetBasics();
+  testSetSpill();
+  testMap();
+  return 0;
+}
@@ -0,0 +1,152 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <apfNumbering.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+/* a prism with a tetrahedron on top. second order integration
+   has four points on the tetrahedron and none on the prism,
+   so a field on them varies in size within one dimension */
+static apf::Mesh2* makeMixedMesh(apf::MeshEntity** extra)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  /* created first and destroyed later,
+     this leaves a hole in the vertex indices */
+  *extra = m->createVertex(interior, apf::Vector3(-1,-1,-1), param);
+  apf::Vector3 points[7] = {
+    apf::Vector3(0,0,0),
+    apf::Vector3(1,0,0),
+    apf::Vector3(0,1,0),
+    apf::Vector3(0,0,1),
+    apf::Vector3(1,0,1),
+    apf::Vector3(0,1,1),
+    apf::Vector3(0.3,0.3,2)
+  };
+  apf::MeshEntity* v[7];
+  for (int i = 0; i < 7; ++i)
+    v[i] = m->createVertex(interior, points[i], param);
+  apf::buildElement(m, interior, apf::Mesh::PRISM, v);
+  apf::buildElement(m, interior, apf::Mesh::TET, v + 3);
+  m->acceptChanges();
+  return m;
+}
+
+static void fillField(apf::Field* f)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::FieldShape* s = apf::getShape(f);
+  int nc = apf::countComponents(f);
+  double value = 0;
+  double components[9];
+  for (int d = 0; d <= m->getDimension(); ++d) {
+    apf::MeshIterator* it = m->begin(d);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      int nodes = s->countNodesOn(m->getType(e));
+      for (int n = 0; n < nodes; ++n) {
+        for (int c = 0; c < nc; ++c)
+          components[c] = ++value;
+        apf::setComponents(f, e, n, components);
+      }
+    }
+    m->end(it);
+  }
+}
+
+/* the array holds one block per dimension with entities in
+   iteration order, the same layout numberOverlapNodes gives */
+static void checkLayout(apf::Field* f)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::FieldShape* s = apf::getShape(f);
+  int nc = apf::countComponents(f);
+  apf::Numbering* overlap = apf::numberOverlapNodes(m, "frozen_check", s);
+  double* base = apf::getArrayData(f);
+  check(base != 0, "frozen field has no array");
+  long first = 0;
+  double components[9];
+  for (int d = 0; d <= m->getDimension(); ++d) {
+    long dimSize;
+    double* block = apf::getArrayData(f, d, dimSize);
+    check(block == base + first, "wrong dimension block start");
+    long expected = 0;
+    apf::MeshIterator* it = m->begin(d);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      int nodes = s->countNodesOn(m->getType(e));
+      int size;
+      double* values = apf::getArrayData(f, e, size);
+      check(size == nodes * nc, "wrong entity value count");
+      if (nodes) {
+        check(values == block + expected, "wrong entity offset");
+        check(values == base + apf::getNumber(overlap, e, 0, 0) * nc,
+            "entity offset differs from the overlap numbering");
+      }
+      for (int n = 0; n < nodes; ++n) {
+        apf::getComponents(f, e, n, components);
+        for (int c = 0; c < nc; ++c)
+          check(values[n * nc + c] == components[c], "wrong entity value");
+      }
+      expected += size;
+    }
+    m->end(it);
+    check(dimSize == expected, "wrong dimension block size");
+    first += dimSize;
+  }
+  apf::destroyNumbering(overlap);
+}
+
+static void checkShape(apf::Mesh2* m, apf::FieldShape* s, int type)
+{
+  apf::Field* f = apf::createField(m, "f", type, s);
+  fillField(f);
+  long size;
+  check(!apf::getArrayData(f, 0, size) && !size, "tag field has an array");
+  apf::freeze(f);
+  checkLayout(f);
+  apf::unfreeze(f);
+  apf::destroyField(f);
+}
+
+static void checkShapes(apf::Mesh2* m)
+{
+  /* uniform counts per dimension, addressed by stride */
+  checkShape(m, apf::getLagrange(2), apf::VECTOR);
+  /* counts that vary between element types,
+     addressed through the offset table */
+  checkShape(m, apf::getIPShape(3, 2), apf::SCALAR);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  apf::MeshEntity* extra;
+  apf::Mesh2* m = makeMixedMesh(&extra);
+  check(m->hasDenseIndices(), "new mesh has sparse indices");
+  checkShapes(m);
+  m->destroy(extra);
+  m->acceptChanges();
+  check(!m->hasDenseIndices(), "mesh with a hole has dense indices");
+  checkShapes(m);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,296 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <gmi_null.h>
+#include <spr.h>
+#include <PCU.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+static bool close(double a, double b)
+{
+  return std::fabs(a - b) <= 1e-12 * std::max(std::fabs(a), std::fabs(b));
+}
+
+enum { TETS, MIXED };
+
+/* a cube of n^3 hexes. TETS cuts each into six tets, MIXED cuts
+   the hexes with x < 1/2 into two prisms and the others into six
+   pyramids around their centers */
+static apf::Mesh2* makeBox(int n, int kind)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  static int const prisms[2][6] = {{0,1,3,4,5,7},{0,3,2,4,7,6}};
+  static int const bases[6][4] = {
+    {0,1,3,2},{4,6,7,5},{0,2,6,4},
+    {1,5,7,3},{0,4,5,1},{2,3,7,6}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    apf::MeshEntity* ev[6];
+    if (kind == TETS) {
+      for (int t = 0; t < 6; ++t) {
+        for (int x = 0; x < 4; ++x)
+          ev[x] = c[tets[t][x]];
+        apf::buildElement(m, interior, apf::Mesh::TET, ev);
+      }
+    } else if (2 * i < n) {
+      for (int t = 0; t < 2; ++t) {
+        for (int x = 0; x < 6; ++x)
+          ev[x] = c[prisms[t][x]];
+        apf::buildElement(m, interior, apf::Mesh::PRISM, ev);
+      }
+    } else {
+      apf::Vector3 center((i + 0.5) / n, (j + 0.5) / n, (k + 0.5) / n);
+      ev[4] = m->createVertex(interior, center, param);
+      for (int t = 0; t < 6; ++t) {
+        for (int x = 0; x < 4; ++x)
+          ev[x] = c[bases[t][x]];
+        apf::buildElement(m, interior, apf::Mesh::PYRAMID, ev);
+      }
+    }
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+class Volume : public apf::BlockIntegrator
+{
+  public:
+    Volume(int order):
+      apf::BlockIntegrator(order),
+      r(0)
+    {}
+    void inProcess()
+    {
+      sums.assign(countThreads(), 0.0);
+    }
+    void atBlock(apf::IntegrationBlock const& b, int thread)
+    {
+      for (int p = 0; p < b.points; ++p)
+        for (int i = 0; i < b.count; ++i)
+          sums[thread] += b.weights[p] * b.dV[p * b.count + i];
+    }
+    void parallelReduce()
+    {
+      r = 0;
+      for (size_t i = 0; i < sums.size(); ++i)
+        r += sums[i];
+      PCU_Add_Doubles(&r, 1);
+    }
+    std::vector<double> sums;
+    double r;
+};
+
+static void testVolume(int kind)
+{
+  apf::Mesh2* m = makeBox(4, kind);
+  double measured = 0;
+  apf::MeshIterator* it = m->begin(3);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    measured += apf::measure(me);
+    apf::destroyMeshElement(me);
+  }
+  m->end(it);
+  check(close(measured, 1), "measured volume is not one");
+  for (int threads = 1; threads <= 4; threads += 3) {
+    Volume v(1);
+    v.setThreads(threads);
+    v.process(m);
+    check(close(v.r, measured), "block volume differs from measure");
+  }
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+/* the size field of spr::getSPRSizeField computed the old way,
+   with one apf::Integrator pass over each element */
+
+class ElementSums : public apf::Integrator
+{
+  public:
+    ElementSums(apf::Field* eps, apf::Field* star):
+      apf::Integrator(apf::getShape(eps)->getOrder()),
+      eps(eps), star(star),
+      v1(apf::countComponents(eps)), v2(apf::countComponents(star))
+    {}
+    void inElement(apf::MeshElement* me)
+    {
+      entity = apf::getMeshEntity(me);
+      element = apf::createElement(star, me);
+      norm = 0;
+      error = 0;
+      ip = 0;
+    }
+    void outElement()
+    {
+      apf::destroyElement(element);
+    }
+    void atPoint(apf::Vector3 const& xi, double w, double dV)
+    {
+      apf::getComponents(eps, entity, ip, &v1[0]);
+      apf::getComponents(element, xi, &v2[0]);
+      norm += (v2 * v2) * w * dV;
+      v1 -= v2;
+      error += (v1 * v1) * w * dV;
+      ++ip;
+    }
+    apf::Field* eps;
+    apf::Field* star;
+    apf::DynamicVector v1, v2;
+    apf::MeshEntity* entity;
+    apf::Element* element;
+    double norm;
+    double error;
+    int ip;
+};
+
+static double getCurrentSize(apf::Mesh* m, apf::MeshEntity* e)
+{
+  double h = 0;
+  apf::Downward edges;
+  int ne = m->getDownward(e, 1, edges);
+  for (int i = 0; i < ne; ++i) {
+    apf::MeshElement* me = apf::createMeshElement(m, edges[i]);
+    h = std::max(h, apf::measure(me));
+    apf::destroyMeshElement(me);
+  }
+  return h;
+}
+
+static void getSerialSizes(apf::Field* eps, double tolerance,
+    std::vector<double>& sizes)
+{
+  apf::Mesh* m = apf::getMesh(eps);
+  apf::Field* star = spr::recoverField(eps);
+  double d = m->getDimension();
+  double p = m->getShape()->getOrder();
+  std::vector<apf::MeshEntity*> elements;
+  std::vector<double> errors;
+  double norm = 0;
+  double total = 0;
+  ElementSums sums(eps, star);
+  apf::MeshIterator* it = m->begin(3);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it))) {
+    apf::MeshElement* me = apf::createMeshElement(m, e);
+    sums.process(me);
+    apf::destroyMeshElement(me);
+    elements.push_back(e);
+    errors.push_back(sums.error);
+    norm += sums.norm;
+    total += pow(sqrt(sums.error), (2 * d) / (2 * p + d));
+  }
+  m->end(it);
+  apf::destroyField(star);
+  double factor = pow(tolerance * tolerance * norm / total, 1 / (2 * p));
+  apf::MeshTag* tag = m->createDoubleTag("esize", 1);
+  for (size_t i = 0; i < elements.size(); ++i) {
+    double h = getCurrentSize(m, elements[i])
+             * pow(sqrt(errors[i]), -(2 / (2 * p + d))) * factor;
+    m->setDoubleTag(elements[i], tag, &h);
+  }
+  sizes.clear();
+  it = m->begin(0);
+  while ((e = m->iterate(it))) {
+    apf::Adjacent around;
+    m->getAdjacent(e, 3, around);
+    double s = 0;
+    for (size_t i = 0; i < around.getSize(); ++i) {
+      double h;
+      m->getDoubleTag(around[i], tag, &h);
+      s += h;
+    }
+    sizes.push_back(s / around.getSize());
+  }
+  m->end(it);
+  apf::removeTagFromDimension(m, tag, 3);
+  m->destroyTag(tag);
+}
+
+static double getValue(apf::Vector3 const& x)
+{
+  return x[0] * x[0] * x[1] + std::sin(3 * x[1]) * x[2] + x[2] * x[2];
+}
+
+static void testEstimate()
+{
+  apf::Mesh2* m = makeBox(4, TETS);
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::SCALAR, 1);
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    apf::setScalar(f, v, 0, getValue(x));
+  }
+  m->end(it);
+  apf::Field* eps = spr::getGradIPField(f, "eps", 2);
+  double const tolerance = 0.1;
+  std::vector<double> expected;
+  getSerialSizes(eps, tolerance, expected);
+  for (int threads = 1; threads <= 4; threads += 3) {
+    apf::setIntegrationThreads(threads);
+    apf::Field* size = spr::getSPRSizeField(eps, tolerance);
+    size_t i = 0;
+    it = m->begin(0);
+    while ((v = m->iterate(it)))
+      check(close(apf::getScalar(size, v, 0), expected[i++]),
+          "block error estimate differs from the serial one");
+    m->end(it);
+    apf::destroyField(size);
+  }
+  apf::setIntegrationThreads(1);
+  apf::destroyField(eps);
+  apf::destroyField(f);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  testVolume(TETS);
+  testVolume(MIXED);
+  testEstimate();
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
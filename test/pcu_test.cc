@@ -0,0 +1,95 @@
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "rank %d: %s\n", PCU_Comm_Self(), what);
+  abort();
+}
+
+static std::vector<int> getRing()
+{
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  std::vector<int> ring;
+  ring.push_back((self + peers - 1) % peers);
+  int next = (self + 1) % peers;
+  if (next != ring[0])
+    ring.push_back(next);
+  return ring;
+}
+
+static int countValues(int round, int from, int to)
+{
+  return (round + from + to) % 4;
+}
+
+/* in each round every rank sends its ring neighbors a
+   message whose length depends on the round, skipping
+   them when that length is zero */
+static void exchangeRound(std::vector<int> const& ring, int round)
+{
+  int self = PCU_Comm_Self();
+  PCU_Comm_Begin();
+  for (size_t i = 0; i < ring.size(); ++i) {
+    int n = countValues(round, self, ring[i]);
+    for (int j = 0; j < n; ++j) {
+      int value = round * 1000 + self * 10 + j;
+      PCU_COMM_PACK(ring[i], value);
+    }
+  }
+  PCU_Comm_Send();
+  int messages = 0;
+  while (PCU_Comm_Listen()) {
+    int from = PCU_Comm_Sender();
+    int n = 0;
+    while ( ! PCU_Comm_Unpacked()) {
+      int value;
+      PCU_COMM_UNPACK(value);
+      check(value == round * 1000 + from * 10 + n, "wrong value");
+      ++n;
+    }
+    check(n == countValues(round, from, self), "wrong message size");
+    check(n > 0, "received an empty message");
+    ++messages;
+  }
+  int expected = 0;
+  for (size_t i = 0; i < ring.size(); ++i)
+    if (countValues(round, ring[i], self))
+      ++expected;
+  check(messages == expected, "wrong number of messages");
+}
+
+static void runRounds(std::vector<int> const& ring)
+{
+  for (int round = 0; round < 8; ++round)
+    exchangeRound(ring, round);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  std::vector<int> ring = getRing();
+  runRounds(ring);
+  PCU_Comm_Keep_Peers(true);
+  runRounds(ring);
+  PCU_Comm_Keep_Peers(false);
+  runRounds(ring);
+  PCU_Comm_Set_Neighbors(ring.size(), &ring[0]);
+  runRounds(ring);
+  PCU_Comm_Clear_Neighbors();
+  exchangeRound(ring, 0);
+  PCU_Comm_Set_Neighbors(ring.size(), &ring[0]);
+  exchangeRound(ring, 1);
+  PCU_Comm_Clear_Neighbors();
+  runRounds(ring);
+  if (!PCU_Comm_Self())
+    printf("pcu phases ok\n");
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
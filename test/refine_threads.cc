@@ -0,0 +1,146 @@
+#include <ma.h>
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+/* a cube of n^3 hexes cut into tets */
+static apf::Mesh2* makeBox(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      apf::buildElement(m, interior, apf::Mesh::TET, tv);
+    }
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+/* a field that linear interpolation does not reproduce,
+   so every transferred value depends on its parent edge */
+static apf::Field* makeField(apf::Mesh* m)
+{
+  apf::Field* f = apf::createLagrangeField(m, "f", apf::SCALAR, 1);
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    apf::setScalar(f, v, 0, x[0] * x[0] + std::sin(x[1]) * x[2]);
+  }
+  m->end(it);
+  return f;
+}
+
+struct Point
+{
+  double x[4];
+  bool operator<(Point const& other) const
+  {
+    return std::lexicographical_compare(x, x + 4, other.x, other.x + 4);
+  }
+  bool operator==(Point const& other) const
+  {
+    return std::equal(x, x + 4, other.x);
+  }
+};
+
+struct Result
+{
+  long counts[4];
+  std::vector<Point> points;
+};
+
+/* the threads split in a different order, so entities are
+   compared by counts and vertices by position and value */
+static void refine(int threads, Result& r)
+{
+  apf::Mesh2* m = makeBox(3);
+  apf::Field* f = makeField(m);
+  ma::Input* in = ma::configureUniformRefine(m, 1);
+  in->shouldSnap = false;
+  in->shouldTransferParametric = false;
+  in->shouldFixShape = false;
+  in->threads = threads;
+  ma::adapt(in);
+  m->verify();
+  for (int d = 0; d < 4; ++d)
+    r.counts[d] = m->count(d);
+  r.points.clear();
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    Point p;
+    x.toArray(p.x);
+    p.x[3] = apf::getScalar(f, v, 0);
+    r.points.push_back(p);
+  }
+  m->end(it);
+  std::sort(r.points.begin(), r.points.end());
+  apf::destroyField(f);
+  m->destroyNative();
+  apf::destroyMesh(m);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  Result serial;
+  refine(1, serial);
+  check(serial.counts[3] == 8 * 6 * 27, "uniform refinement missed tets");
+  Result threaded;
+  refine(4, threaded);
+  for (int d = 0; d < 4; ++d)
+    check(serial.counts[d] == threaded.counts[d],
+        "threaded refinement made different entities");
+  check(serial.points == threaded.points,
+      "threaded refinement moved or transferred differently");
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,93 @@
+#include <gmi_mesh.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "rank %d: %s\n", PCU_Comm_Self(), what);
+  abort();
+}
+
+/* counts by iteration, which also catches lost or repeated entities */
+static void countEntities(apf::Mesh* m, size_t counts[4])
+{
+  for (int d = 0; d <= 3; ++d) {
+    counts[d] = 0;
+    apf::MeshIterator* it = m->begin(d);
+    while (m->iterate(it))
+      ++counts[d];
+    m->end(it);
+    check(counts[d] == m->count(d), "iteration and count differ");
+  }
+}
+
+static apf::MdsOrdering getOrdering(const char* name)
+{
+  if (!strcmp(name, "bfs"))
+    return apf::MDS_BREADTH_FIRST;
+  if (!strcmp(name, "hilbert"))
+    return apf::MDS_HILBERT;
+  if (!strcmp(name, "morton"))
+    return apf::MDS_MORTON;
+  if (!PCU_Comm_Self())
+    fprintf(stderr, "unknown ordering \"%s\"\n", name);
+  abort();
+}
+
+static void printLocality(apf::Mesh2* m, const char* when)
+{
+  apf::MdsLocality l = apf::measureMdsLocality(m);
+  double v[4] = {l.edgeDistance, l.elementDistance,
+    l.elementSpread, l.missRate};
+  PCU_Add_Doubles(v, 4);
+  for (int i = 0; i < 4; ++i)
+    v[i] /= PCU_Comm_Peers();
+  if (!PCU_Comm_Self())
+    printf("%s: edge distance %f, element distance %f, "
+           "element spread %f, miss rate %f\n",
+           when, v[0], v[1], v[2], v[3]);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  if (argc < 4 || argc > 5) {
+    if (!PCU_Comm_Self())
+      printf("Usage: %s <model> <mesh> <bfs|hilbert|morton> [out mesh]\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  gmi_register_mesh();
+  apf::Mesh2* m = apf::loadMdsMesh(argv[1],argv[2]);
+  apf::MdsOrdering ordering = getOrdering(argv[3]);
+  printLocality(m, "before");
+  size_t before[4];
+  countEntities(m, before);
+  double t0 = MPI_Wtime();
+  apf::reorderMdsMesh(m, ordering);
+  double t = MPI_Wtime() - t0;
+  PCU_Max_Doubles(&t, 1);
+  if (!PCU_Comm_Self())
+    printf("reordered by %s in %f seconds\n", argv[3], t);
+  m->verify();
+  size_t after[4];
+  countEntities(m, after);
+  for (int d = 0; d <= 3; ++d)
+    check(after[d] == before[d], "reordering changed entity counts");
+  printLocality(m, "after");
+  if (argc == 5)
+    m->writeNative(argv[4]);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,181 @@
+#include <apf.h>
+#include <apfCavityOp.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+/* a cube of n^3 hexes cut into tets */
+static apf::Mesh2* makeBox(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      apf::buildElement(m, interior, apf::Mesh::TET, tv);
+    }
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+/* splitting a tet at its centroid destroys the tet and creates
+   one vertex, four edges, six triangles and four tets. the first
+   new tet reuses the slot of the old one, so three tet slots
+   are taken from the reservation */
+static int const splitCounts[apf::Mesh::TYPES] = {1,4,6,0,3,0,0,0};
+static int const splitDelta[4] = {1,4,6,3};
+
+static void splitTet(apf::Mesh2* m, apf::MeshEntity* tet)
+{
+  apf::ModelEntity* c = m->toModel(tet);
+  apf::MeshEntity* v[4];
+  m->getDownward(tet, 0, v);
+  apf::Vector3 x = apf::getLinearCentroid(m, tet);
+  m->destroy(tet);
+  apf::MeshEntity* center = m->createVertex(c, x, apf::Vector3(0,0,0));
+  for (int i = 0; i < 4; ++i) {
+    apf::MeshEntity* tv[4];
+    for (int j = 0; j < 4; ++j)
+      tv[j] = v[j];
+    tv[i] = center;
+    apf::buildElement(m, c, apf::Mesh::TET, tv);
+  }
+}
+
+struct Work
+{
+  apf::Mesh2* mesh;
+  std::vector<apf::MeshEntity*>* tets;
+  int threads;
+};
+
+static void splitInThread(int thread, void* data)
+{
+  Work* w = static_cast<Work*>(data);
+  std::vector<apf::MeshEntity*>& tets = *(w->tets);
+  for (size_t i = thread; i < tets.size(); i += w->threads)
+    splitTet(w->mesh, tets[i]);
+}
+
+/* (perThread) tets of one color for each thread */
+static void getTets(apf::Mesh2* m, int threads, int perThread,
+    std::vector<apf::MeshEntity*>& tets)
+{
+  std::vector<apf::MeshEntity*> all;
+  apf::MeshIterator* it = m->begin(3);
+  apf::MeshEntity* e;
+  while ((e = m->iterate(it)))
+    all.push_back(e);
+  m->end(it);
+  std::vector<std::vector<apf::MeshEntity*> > colors;
+  apf::colorByVertices(m, all, colors);
+  size_t n = threads * perThread;
+  check(colors[0].size() >= n, "first color is too small");
+  tets.assign(colors[0].begin(), colors[0].begin() + n);
+}
+
+static void countEntities(apf::Mesh* m, long counts[4])
+{
+  for (int d = 0; d < 4; ++d) {
+    counts[d] = 0;
+    apf::MeshIterator* it = m->begin(d);
+    while (m->iterate(it))
+      ++counts[d];
+    m->end(it);
+    check(counts[d] == long(m->count(d)),
+        "iteration and count differ");
+  }
+}
+
+/* each thread splits (perThread) tets of one color, with room
+   for (spare) more splits than it makes */
+static void splitInThreads(apf::Mesh2* m, int threads, int perThread,
+    int spare)
+{
+  long before[4];
+  countEntities(m, before);
+  std::vector<apf::MeshEntity*> tets;
+  getTets(m, threads, perThread, tets);
+  int counts[apf::Mesh::TYPES];
+  for (int t = 0; t < apf::Mesh::TYPES; ++t)
+    counts[t] = splitCounts[t] * (perThread + spare);
+  check(m->reserveThreads(threads, counts), "MDS refused threads");
+  Work w;
+  w.mesh = m;
+  w.tets = &tets;
+  w.threads = threads;
+  PCU_Work_Run(threads, splitInThread, &w);
+  m->commitThreads();
+  long after[4];
+  countEntities(m, after);
+  long splits = long(tets.size());
+  for (int d = 0; d < 4; ++d)
+    check(after[d] == before[d] + splitDelta[d] * splits,
+        "wrong entity count after commit");
+  m->verify();
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  int const threads = 4;
+  apf::Mesh2* m = makeBox(4);
+  check(m->hasDenseIndices(), "new mesh has holes");
+  /* the spare room goes back to the mesh as holes */
+  splitInThreads(m, threads, 2, 1);
+  check(!m->hasDenseIndices(), "unused room left no holes");
+  /* reserving again takes exactly those holes,
+     so the mesh is dense after using them */
+  splitInThreads(m, threads, 1, 0);
+  check(m->hasDenseIndices(), "reserved holes were not reused");
+  /* serial modification still works afterwards */
+  std::vector<apf::MeshEntity*> tets;
+  getTets(m, 1, 1, tets);
+  splitTet(m, tets[0]);
+  m->acceptChanges();
+  m->verify();
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
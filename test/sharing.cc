@@ -0,0 +1,223 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "rank %d: %s\n", PCU_Comm_Self(), what);
+  abort();
+}
+
+/* a cube of n^3 hexes cut into tets, with the vertices
+   of its x=0 and x=1 faces matched to each other */
+static void buildBox(apf::Mesh2* m, int n)
+{
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      apf::buildElement(m, interior, apf::Mesh::TET, tv);
+    }
+  }
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j) {
+    apf::MeshEntity* a = v[(k * (n + 1) + j) * (n + 1)];
+    apf::MeshEntity* b = v[(k * (n + 1) + j) * (n + 1) + n];
+    m->addMatch(a, 0, b);
+    m->addMatch(b, 0, a);
+  }
+}
+
+/* build the box on part zero and spread it by quadrants */
+static apf::Mesh2* makeMesh(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, true);
+  if (!PCU_Comm_Self())
+    buildBox(m, n);
+  m->acceptChanges();
+  apf::Migration* plan = new apf::Migration(m);
+  if (!PCU_Comm_Self()) {
+    apf::MeshIterator* it = m->begin(3);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      apf::Vector3 c = apf::getLinearCentroid(m, e);
+      int to = int(c[0] * 2) * 2 + int(c[1] * 2);
+      plan->send(e, to % PCU_Comm_Peers());
+    }
+    m->end(it);
+  }
+  m->migrate(plan);
+  return m;
+}
+
+/* owners get values from their location, copies get different
+   ones unless (all) is set, so a missed exchange shows up */
+static void fill(apf::Field* f, bool all, int round)
+{
+  apf::Mesh* m = apf::getMesh(f);
+  apf::FieldShape* s = apf::getShape(f);
+  int nc = apf::countComponents(f);
+  double values[3];
+  for (int d = 0; d < 4; ++d) {
+    if (!s->hasNodesIn(d))
+      continue;
+    apf::MeshIterator* it = m->begin(d);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      apf::Vector3 x = apf::getLinearCentroid(m, e);
+      bool owned = m->isOwned(e);
+      int nodes = s->countNodesOn(m->getType(e));
+      for (int node = 0; node < nodes; ++node) {
+        for (int c = 0; c < nc; ++c) {
+          values[c] = x[0] * 100 + x[1] * 10 + x[2] + c * 1000 + round;
+          if (!owned)
+            values[c] = all ? values[c] + PCU_Comm_Self() : -1;
+        }
+        apf::setComponents(f, e, node, values);
+      }
+    }
+    m->end(it);
+  }
+}
+
+static void fill(apf::Field** fields, int count, bool all, int round)
+{
+  for (int i = 0; i < count; ++i)
+    fill(fields[i], all, round);
+}
+
+static void checkSame(apf::Field* a, apf::Field* b, const char* what)
+{
+  apf::Mesh* m = apf::getMesh(a);
+  apf::FieldShape* s = apf::getShape(a);
+  int nc = apf::countComponents(a);
+  double x[3];
+  double y[3];
+  long bad = 0;
+  for (int d = 0; d < 4; ++d) {
+    if (!s->hasNodesIn(d))
+      continue;
+    apf::MeshIterator* it = m->begin(d);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      int nodes = s->countNodesOn(m->getType(e));
+      for (int node = 0; node < nodes; ++node) {
+        apf::getComponents(a, e, node, x);
+        apf::getComponents(b, e, node, y);
+        for (int c = 0; c < nc; ++c)
+          if (std::fabs(x[c] - y[c]) > 1e-9)
+            ++bad;
+      }
+    }
+    m->end(it);
+  }
+  PCU_Add_Longs(&bad, 1);
+  check(!bad, what);
+}
+
+/* (plain) fields go through apf::synchronize and apf::accumulate,
+   (planned) ones through the plan, which every round reuses */
+static void runRound(apf::SharingPlan* plan, apf::Field** plain,
+    apf::Field** planned, int count, int round)
+{
+  fill(plain, count, false, round);
+  fill(planned, count, false, round);
+  for (int i = 0; i < count; ++i)
+    apf::synchronize(plain[i]);
+  apf::synchronize(plan, planned, count);
+  for (int i = 0; i < count; ++i)
+    checkSame(plain[i], planned[i], "synchronize differs");
+  fill(plain, count, true, round);
+  fill(planned, count, true, round);
+  for (int i = 0; i < count; ++i)
+    apf::accumulate(plain[i]);
+  apf::accumulate(plan, planned, count);
+  for (int i = 0; i < count; ++i)
+    checkSame(plain[i], planned[i], "accumulate differs");
+}
+
+/* a plan puts back the neighbors its caller had set */
+static void runWithNeighbors(apf::SharingPlan* plan, apf::Field** plain,
+    apf::Field** planned)
+{
+  std::vector<int> all;
+  for (int i = 0; i < PCU_Comm_Peers(); ++i)
+    all.push_back(i);
+  PCU_Comm_Set_Neighbors(all.size(), &all[0]);
+  runRound(plan, plain, planned, 2, 4);
+  int const* ranks;
+  int count = PCU_Comm_Get_Neighbors(&ranks);
+  check(count == int(all.size()), "plan changed the neighbor count");
+  for (int i = 0; i < count; ++i)
+    check(ranks[i] == all[i], "plan changed the neighbors");
+  PCU_Comm_Clear_Neighbors();
+  check(PCU_Comm_Get_Neighbors(&ranks) == -1, "neighbors were not cleared");
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  apf::Mesh2* m = makeMesh(4);
+  check(m->hasMatching(), "mesh lost its matching");
+  apf::FieldShape* s = apf::getLagrange(2);
+  apf::Field* plain[2];
+  apf::Field* planned[2];
+  plain[0] = apf::createField(m, "a", apf::VECTOR, s);
+  plain[1] = apf::createField(m, "b", apf::SCALAR, s);
+  planned[0] = apf::createField(m, "c", apf::VECTOR, s);
+  planned[1] = apf::createField(m, "d", apf::SCALAR, s);
+  apf::SharingPlan* plan = apf::makeSharingPlan(m, s);
+  for (int round = 0; round < 3; ++round)
+    runRound(plan, plain, planned, 2, round);
+  /* one field at a time, with frozen storage */
+  apf::freeze(planned[0]);
+  runRound(plan, plain, planned, 1, 3);
+  apf::unfreeze(planned[0]);
+  runWithNeighbors(plan, plain, planned);
+  apf::destroySharingPlan(plan);
+  for (int i = 0; i < 2; ++i) {
+    apf::destroyField(plain[i]);
+    apf::destroyField(planned[i]);
+  }
+  if (!PCU_Comm_Self())
+    printf("sharing plans ok\n");
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,85 @@
+#include <gmi_mesh.h>
+#include <gmi_null.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apf.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/* compares writing and reading a mesh with one SMB file per part
+   against the aggregated "agg:" mode on the local file system.
+   given a thread count, it also times compressed "bz2:" files
+   with that many threads per part. */
+
+static double timeWrite(apf::Mesh2* m, std::string const& path, int reps)
+{
+  PCU_Barrier();
+  double t0 = MPI_Wtime();
+  for (int i = 0; i < reps; ++i)
+    m->writeNative(path.c_str());
+  PCU_Barrier();
+  return (MPI_Wtime() - t0) / reps;
+}
+
+static double timeRead(const char* model, apf::Mesh2* m,
+    std::string const& path, int reps)
+{
+  PCU_Barrier();
+  double t0 = MPI_Wtime();
+  for (int i = 0; i < reps; ++i) {
+    apf::Mesh2* m2 = apf::loadMdsMesh(model, path.c_str());
+    for (int d = 0; d <= m->getDimension(); ++d)
+      if (m2->count(d) != m->count(d)) {
+        fprintf(stderr, "%s: entity counts differ\n", path.c_str());
+        abort();
+      }
+    m2->destroyNative();
+    apf::destroyMesh(m2);
+  }
+  PCU_Barrier();
+  return (MPI_Wtime() - t0) / reps;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 4 || argc > 7) {
+    printf("usage: %s <model> <mesh> <out dir/> [reps] [parts per file]"
+        " [compress threads]\n", argv[0]);
+    return 0;
+  }
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_mesh();
+  gmi_register_null();
+  apf::Mesh2* m = apf::loadMdsMesh(argv[1],argv[2]);
+  std::string dir(argv[3]);
+  int reps = argc > 4 ? atoi(argv[4]) : 3;
+  if (argc > 5)
+    apf::setSmbPartsPerFile(atoi(argv[5]));
+  std::string perPart = dir + "part.smb";
+  std::string agg = "agg:" + dir + "agg.smb";
+  double wp = timeWrite(m, perPart, reps);
+  double wa = timeWrite(m, agg, reps);
+  double rp = timeRead(argv[1], m, perPart, reps);
+  double ra = timeRead(argv[1], m, agg, reps);
+  if (!PCU_Comm_Self()) {
+    printf("%d parts, average of %d runs\n", PCU_Comm_Peers(), reps);
+    printf("file per part: write %f read %f seconds\n", wp, rp);
+    printf("aggregated:    write %f read %f seconds\n", wa, ra);
+  }
+  if (argc > 6) {
+    int threads = atoi(argv[6]);
+    apf::setSmbThreads(threads);
+    std::string zip = "bz2:" + dir + "zip.smb";
+    double wz = timeWrite(m, zip, reps);
+    double rz = timeRead(argv[1], m, zip, reps);
+    if (!PCU_Comm_Self())
+      printf("bz2, %d threads: write %f read %f seconds\n", threads, wz, rz);
+  }
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
@@ -0,0 +1,213 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* writes a mesh spread over all ranks to the given SMB path,
+   which may have "agg:", "bz2:" or "zst:" prefixes, reads it back
+   and checks that nothing changed, including a long tag with
+   values beyond 32 bits. */
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "rank %d: %s\n", PCU_Comm_Self(), what);
+  abort();
+}
+
+/* the box faces, edges or corner that all the given points lie on */
+static apf::ModelEntity* classify(apf::Mesh2* m, apf::Vector3 const* x,
+    int n)
+{
+  int dim = 3;
+  int tag = 0;
+  for (int c = 0; c < 3; ++c) {
+    int on = -1;
+    for (int side = 0; side < 2; ++side) {
+      bool all = true;
+      for (int i = 0; i < n; ++i)
+        if (x[i][c] != side)
+          all = false;
+      if (all)
+        on = side;
+    }
+    tag = tag * 3 + on + 1;
+    if (on != -1)
+      --dim;
+  }
+  return m->findModelEntity(dim, tag);
+}
+
+static apf::ModelEntity* classify(apf::Mesh2* m, apf::MeshEntity** v,
+    int n)
+{
+  apf::Vector3 x[3];
+  for (int i = 0; i < n; ++i)
+    m->getPoint(v[i], 0, x[i]);
+  return classify(m, x, n);
+}
+
+static void buildTet(apf::Mesh2* m, apf::MeshEntity** tv)
+{
+  for (int i = 0; i < 6; ++i) {
+    apf::MeshEntity* ev[2];
+    for (int j = 0; j < 2; ++j)
+      ev[j] = tv[apf::tet_edge_verts[i][j]];
+    apf::makeOrFind(m, classify(m, ev, 2), apf::Mesh::EDGE, ev);
+  }
+  for (int i = 0; i < 4; ++i) {
+    apf::MeshEntity* fv[3];
+    for (int j = 0; j < 3; ++j)
+      fv[j] = tv[apf::tet_tri_verts[i][j]];
+    apf::buildElement(m, classify(m, fv, 3), apf::Mesh::TRIANGLE, fv);
+  }
+  apf::buildElement(m, m->findModelEntity(3, 0), apf::Mesh::TET, tv);
+}
+
+/* a cube of n^3 hexes cut into tets, classified on the box */
+static void buildBox(apf::Mesh2* m, int n)
+{
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(classify(m, &x, 1), x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      buildTet(m, tv);
+    }
+  }
+}
+
+/* build the box on part zero and cut it into slabs along x */
+static apf::Mesh2* makeMesh(gmi_model* model, int n)
+{
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  if (!PCU_Comm_Self())
+    buildBox(m, n);
+  m->acceptChanges();
+  apf::Migration* plan = new apf::Migration(m);
+  if (!PCU_Comm_Self()) {
+    apf::MeshIterator* it = m->begin(3);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      apf::Vector3 c = apf::getLinearCentroid(m, e);
+      plan->send(e, int(c[0] * PCU_Comm_Peers()));
+    }
+    m->end(it);
+  }
+  m->migrate(plan);
+  return m;
+}
+
+/* two values per vertex that do not fit in 32 bits */
+static void getValues(apf::Vector3 const& x, long* values)
+{
+  long id = long(x[0] * 1000) * 1000000 + long(x[1] * 1000) * 1000
+          + long(x[2] * 1000);
+  values[0] = (1L << 40) + id;
+  values[1] = -(3L << 33) - id;
+}
+
+static void tagVertices(apf::Mesh2* m)
+{
+  apf::MeshTag* tag = m->createLongTag("big", 2);
+  apf::MeshIterator* it = m->begin(0);
+  apf::MeshEntity* v;
+  while ((v = m->iterate(it))) {
+    apf::Vector3 x;
+    m->getPoint(v, 0, x);
+    long values[2];
+    getValues(x, values);
+    m->setLongTag(v, tag, values);
+  }
+  m->end(it);
+}
+
+static void checkSame(apf::Mesh2* a, apf::Mesh2* b)
+{
+  for (int d = 0; d <= 3; ++d)
+    check(a->count(d) == b->count(d), "entity counts differ");
+  apf::MeshTag* tag = b->findTag("big");
+  check(tag != 0, "long tag is missing");
+  check(b->getTagType(tag) == apf::Mesh::LONG, "tag is not long");
+  check(b->getTagSize(tag) == 2, "wrong long tag size");
+  apf::MeshIterator* ia = a->begin(0);
+  apf::MeshIterator* ib = b->begin(0);
+  apf::MeshEntity* va;
+  apf::MeshEntity* vb;
+  while ((va = a->iterate(ia))) {
+    vb = b->iterate(ib);
+    apf::Vector3 xa;
+    apf::Vector3 xb;
+    a->getPoint(va, 0, xa);
+    b->getPoint(vb, 0, xb);
+    check(xa == xb, "vertex moved");
+    check(a->isShared(va) == b->isShared(vb), "sharing differs");
+    long expected[2];
+    long values[2];
+    getValues(xa, expected);
+    b->getLongTag(vb, tag, values);
+    check(values[0] == expected[0] && values[1] == expected[1],
+        "long tag value differs");
+  }
+  a->end(ia);
+  b->end(ib);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  if (argc < 2 || argc > 4) {
+    if (!PCU_Comm_Self())
+      printf("usage: %s <out.smb> [parts per file] [codec threads]\n",
+          argv[0]);
+    MPI_Finalize();
+    exit(EXIT_FAILURE);
+  }
+  gmi_register_null();
+  /* zero keeps the default */
+  if (argc > 2 && atoi(argv[2]))
+    apf::setSmbPartsPerFile(atoi(argv[2]));
+  if (argc > 3)
+    apf::setSmbThreads(atoi(argv[3]));
+  apf::Mesh2* m = makeMesh(gmi_load(".null"), 4);
+  tagVertices(m);
+  m->writeNative(argv[1]);
+  apf::Mesh2* m2 = apf::loadMdsMesh(gmi_load(".null"), argv[1]);
+  m2->verify();
+  checkSame(m, m2);
+  m2->destroyNative();
+  apf::destroyMesh(m2);
+  m->destroyNative();
+  apf::destroyMesh(m);
+  if (!PCU_Comm_Self())
+    printf("%s ok\n", argv[1]);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}
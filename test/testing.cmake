@@ -4,6 +4,13 @@ set(MESHES "/lore/dibanez/meshes"
 add_test(shapefun shapefun)
 add_test(eigen_test eigen_test)
 add_test(qr_test qr_test)
+add_test(flatset flatset)
+add_test(pcu_test
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 4
+  ./pcu_test)
+add_test(sharing_plan
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 4
+  ./sharing)
 set(MDIR ${MESHES}/pipe)
 add_test(verify_serial
   verify
@@ -23,6 +30,16 @@ add_test(tet_serial
   "${MDIR}/pipe.dmg"
   "pipe.smb"
   "tet.smb")
+add_test(reorder_hilbert
+  reorder
+  "${MDIR}/pipe.dmg"
+  "pipe.smb"
+  hilbert)
+add_test(reorder_morton
+  reorder
+  "${MDIR}/pipe.dmg"
+  "pipe.smb"
+  morton)
 if (PCU_COMPRESS)
   set(MESHFILE "bz2:pipe_2_.smb")
 else()
@@ -41,6 +58,13 @@ add_test(refineX
   ${MESHFILE}
   0
   "refXpipe/")
+add_test(smb_bench
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 2
+  ./smbBench
+  "${MDIR}/pipe.dmg"
+  ${MESHFILE}
+  "./"
+  1)
 add_test(split_4
   ${MPIRUN} ${MPIRUN_PROCFLAG} 2
   ./zsplit
@@ -206,6 +230,49 @@ add_test(adapt_fusion
 add_test(fusion_field
   ${MPIRUN} ${MPIRUN_PROCFLAG} 2
   ./fusion2)
+add_test(frozen_layout
+  ./frozen)
+add_test(frozen_upward
+  ./upward)
+add_test(cavity_colors
+  ./cavity)
+add_test(thread_reserve
+  ./reserve)
+add_test(refine_threads
+  ./refine_threads)
+add_test(coarsen_serial
+  ./coarsen)
+add_test(coarsen_parallel
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 2
+  ./coarsen)
+add_test(block_integrate
+  ./integrate)
+# three parts in files of two
+add_test(smb_agg
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 3
+  ./smb_roundtrip
+  "agg:roundtrip_agg_.smb"
+  2)
+add_test(smb_long_tag
+  ${MPIRUN} ${MPIRUN_PROCFLAG} 2
+  ./smb_roundtrip
+  "roundtrip_.smb")
+if (PCU_COMPRESS)
+  add_test(smb_bz2
+    ${MPIRUN} ${MPIRUN_PROCFLAG} 2
+    ./smb_roundtrip
+    "bz2:roundtrip_bz2_.smb"
+    0
+    2)
+  if (PCU_ZSTD)
+    add_test(smb_zst
+      ${MPIRUN} ${MPIRUN_PROCFLAG} 2
+      ./smb_roundtrip
+      "zst:roundtrip_zst_.smb"
+      0
+      2)
+  endif()
+endif()
 add_test(change_dim
   ./newdim)
 add_test(ma_insphere
@@ -0,0 +1,127 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <gmi_null.h>
+#include <PCU.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+static void check(bool ok, const char* what)
+{
+  if (ok)
+    return;
+  fprintf(stderr, "%s\n", what);
+  abort();
+}
+
+/* a cube of n^3 hexes cut into tets */
+static apf::Mesh2* makeBox(int n)
+{
+  gmi_model* model = gmi_load(".null");
+  apf::Mesh2* m = apf::makeEmptyMdsMesh(model, 3, false);
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::Vector3 param(0,0,0);
+  std::vector<apf::MeshEntity*> v((n + 1) * (n + 1) * (n + 1));
+  for (int k = 0; k <= n; ++k)
+  for (int j = 0; j <= n; ++j)
+  for (int i = 0; i <= n; ++i) {
+    apf::Vector3 x(double(i) / n, double(j) / n, double(k) / n);
+    v[(k * (n + 1) + j) * (n + 1) + i] =
+      m->createVertex(interior, x, param);
+  }
+  static int const tets[6][4] = {
+    {0,1,3,7},{0,1,7,5},{0,5,7,4},
+    {0,3,2,7},{0,2,6,7},{0,6,4,7}};
+  for (int k = 0; k < n; ++k)
+  for (int j = 0; j < n; ++j)
+  for (int i = 0; i < n; ++i) {
+    apf::MeshEntity* c[8];
+    for (int b = 0; b < 8; ++b) {
+      int ii = i + (b & 1);
+      int jj = j + ((b >> 1) & 1);
+      int kk = k + ((b >> 2) & 1);
+      c[b] = v[(kk * (n + 1) + jj) * (n + 1) + ii];
+    }
+    for (int t = 0; t < 6; ++t) {
+      apf::MeshEntity* tv[4];
+      for (int x = 0; x < 4; ++x)
+        tv[x] = c[tets[t][x]];
+      apf::buildElement(m, interior, apf::Mesh::TET, tv);
+    }
+  }
+  m->acceptChanges();
+  apf::deriveMdsModel(m);
+  return m;
+}
+
+typedef std::map<apf::MeshEntity*, std::vector<apf::MeshEntity*> > UpMap;
+
+/* records the upward entities of every non-element entity,
+   checking that all the upward queries agree with each other */
+static void getUpMap(apf::Mesh2* m, UpMap& ups)
+{
+  ups.clear();
+  for (int d = 0; d < m->getDimension(); ++d) {
+    apf::MeshIterator* it = m->begin(d);
+    apf::MeshEntity* e;
+    while ((e = m->iterate(it))) {
+      apf::Up up;
+      m->getUp(e, up);
+      check(up.n == m->countUpward(e), "getUp and countUpward differ");
+      check(m->hasUp(e) == (up.n > 0), "hasUp and getUp differ");
+      std::vector<apf::MeshEntity*>& l = ups[e];
+      for (int i = 0; i < up.n; ++i) {
+        check(up.e[i] == m->getUpward(e, i), "getUp and getUpward differ");
+        l.push_back(up.e[i]);
+      }
+    }
+    m->end(it);
+  }
+}
+
+static void checkSameUp(apf::Mesh2* m, UpMap& expected)
+{
+  UpMap ups;
+  getUpMap(m, ups);
+  check(ups == expected, "upward adjacencies changed");
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  PCU_Comm_Init();
+  gmi_register_null();
+  apf::Mesh2* m = makeBox(3);
+  UpMap lists;
+  getUpMap(m, lists);
+  check(!apf::isMdsUpwardFrozen(m), "new mesh is frozen");
+  apf::freezeMdsUpward(m);
+  check(apf::isMdsUpwardFrozen(m), "freeze did nothing");
+  checkSameUp(m, lists);
+  /* any creation or destruction falls back to the lists */
+  apf::ModelEntity* interior = m->findModelEntity(3, 0);
+  apf::MeshEntity* v = m->createVertex(interior, apf::Vector3(2,2,2),
+      apf::Vector3(0,0,0));
+  check(!apf::isMdsUpwardFrozen(m), "creation did not thaw");
+  apf::freezeMdsUpward(m);
+  m->destroy(v);
+  check(!apf::isMdsUpwardFrozen(m), "destruction did not thaw");
+  checkSameUp(m, lists);
+  /* reordering renumbers everything and freezes again */
+  apf::freezeMdsUpward(m);
+  apf::reorderMdsMesh(m);
+  check(apf::isMdsUpwardFrozen(m), "reordering did not refreeze");
+  UpMap frozen;
+  getUpMap(m, frozen);
+  v = m->createVertex(interior, apf::Vector3(2,2,2), apf::Vector3(0,0,0));
+  m->destroy(v);
+  check(!apf::isMdsUpwardFrozen(m), "modification did not thaw");
+  checkSameUp(m, frozen);
+  m->verify();
+  m->destroyNative();
+  apf::destroyMesh(m);
+  PCU_Comm_Free();
+  MPI_Finalize();
+}